@@ -0,0 +1,375 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/**
+ * Wrapper benchmarks, run from the directory holding the Awesomium runtime.
+ *
+ * usage: awesomniumc-bench [-json] [output file]
+ *
+ * Prints one row per benchmark as CSV (or a JSON array with -json) to stdout
+ * or the output file. All times are in milliseconds.
+ */
+#include "awesomiumc.h"
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define LOAD_ITERATIONS 20
+#define RENDER_ITERATIONS 60
+#define JS_ITERATIONS 200
+#define CALLBACK_COUNT 10000
+#define INPUT_COUNT 10000
+#define WAIT_TIMEOUT_MS 10000
+
+// animates a box of the given size, the page background stays static
+static const char* animatedPage =
+	"<html><body style='margin:0;background:#336'>"
+	"<div id='box' style='position:absolute;left:0;top:0;width:%dpx;height:%dpx;background:#fff'></div>"
+	"<script>var i = 0; setInterval(function() { i++; document.getElementById('box').style.background = (i & 1)?'#f80':'#08f'; }, 1);</script>"
+	"</body></html>";
+
+struct Result {
+	std::string name;
+	int iterations;
+	double totalMs;
+	double minMs;
+	double maxMs;
+	double throughput;
+	const char* unit;
+};
+
+static std::vector<Result> results;
+static LARGE_INTEGER frequency;
+static WebCoreC webCore;
+
+static volatile int finishedLoading = 0;
+static volatile int callbacksReceived = 0;
+static volatile int scriptsResolved = 0;
+
+static double now() {
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart * 1000.0 / frequency.QuadPart;
+}
+
+static void addResult(const char* name, const std::vector<double>& samples, double throughput, const char* unit) {
+	Result result;
+	result.name = name;
+	result.iterations = (int)samples.size();
+	result.totalMs = 0;
+	result.minMs = samples.empty()?0:samples[0];
+	result.maxMs = 0;
+	for(size_t i = 0; i < samples.size(); i++) {
+		result.totalMs += samples[i];
+		if(samples[i] < result.minMs)
+			result.minMs = samples[i];
+		if(samples[i] > result.maxMs)
+			result.maxMs = samples[i];
+	}
+	result.throughput = throughput;
+	result.unit = unit;
+	results.push_back(result);
+	fprintf(stderr, "%s: %.3f ms mean\n", name, samples.empty()?0:result.totalMs / samples.size());
+}
+
+static void AWE_CALLBACK onFinishLoading(WebViewC webView) {
+	finishedLoading = 1;
+}
+
+static void AWE_CALLBACK onCallback(WebViewC webView, const wchar_t* objectName, const wchar_t* callbackName, const JSArgumentsC args) {
+	callbacksReceived++;
+}
+
+static void AWE_CALLBACK onScriptResult(WebViewC webView, int requestId, int succeeded, const JSValueC result, void* userData) {
+	scriptsResolved++;
+}
+
+// pumps the core until the flag reaches the expected value, false on timeout
+static bool waitFor(volatile int* flag, int expected) {
+	double start = now();
+	while(*flag < expected) {
+		awe_WebCore_update(webCore);
+		if(now() - start > WAIT_TIMEOUT_MS)
+			return false;
+		Sleep(0);
+	}
+	return true;
+}
+
+static WebViewC createView(int width, int height, WebViewListenerC* listener) {
+	WebViewC webView = awe_WebCore_createWebView(webCore, width, height);
+	memset(listener, 0, sizeof(WebViewListenerC));
+	listener->onFinishLoading = onFinishLoading;
+	listener->onCallback = onCallback;
+	awe_WebView_setListener(webView, listener);
+	return webView;
+}
+
+static bool loadHTML(WebViewC webView, const char* html) {
+	finishedLoading = 0;
+	awe_WebView_loadHTML(webView, html, L"");
+	return waitFor(&finishedLoading, 1);
+}
+
+// pumps the core until the page has repainted, false on timeout. Render
+// samples start after this so they don't include the page's repaint interval.
+static bool waitForDirty(WebViewC webView) {
+	double start = now();
+	while(!awe_WebView_isDirty(webView)) {
+		awe_WebCore_update(webCore);
+		if(now() - start > WAIT_TIMEOUT_MS)
+			return false;
+		Sleep(0);
+	}
+	return true;
+}
+
+static void benchLoad() {
+	WebViewListenerC listener;
+	WebViewC webView = createView(512, 512, &listener);
+	std::vector<double> samples;
+	for(int i = 0; i < LOAD_ITERATIONS; i++) {
+		double start = now();
+		if(!loadHTML(webView, "<html><body><h1>benchmark</h1><p>static content</p></body></html>"))
+			break;
+		samples.push_back(now() - start);
+	}
+	addResult("load_html_string", samples, 0, "");
+
+	FILE* file = fopen("bench_page.html", "wb");
+	if(file) {
+		fputs("<html><body><h1>benchmark</h1><p>local file content</p></body></html>", file);
+		fclose(file);
+		char directory[MAX_PATH];
+		GetCurrentDirectoryA(MAX_PATH, directory);
+		awe_WebCore_setBaseDirectory(webCore, directory);
+		samples.clear();
+		for(int i = 0; i < LOAD_ITERATIONS; i++) {
+			double start = now();
+			finishedLoading = 0;
+			awe_WebView_loadFile(webView, "bench_page.html", L"");
+			if(!waitFor(&finishedLoading, 1))
+				break;
+			samples.push_back(now() - start);
+		}
+		addResult("load_local_file", samples, 0, "");
+		DeleteFileA("bench_page.html");
+	}
+	awe_WebView_destroy(webView);
+}
+
+static void benchRender(const char* name, int width, int height) {
+	WebViewListenerC listener;
+	WebViewC webView = createView(width, height, &listener);
+	char html[1024];
+	sprintf(html, animatedPage, width, height);
+	loadHTML(webView, html);
+
+	int rowSpan = width * 4;
+	std::vector<unsigned char> dest(rowSpan * height);
+	std::vector<double> samples;
+	for(int i = 0; i < RENDER_ITERATIONS; i++) {
+		if(!waitForDirty(webView))
+			break;
+		double start = now();
+		RenderBufferC renderBuffer = awe_WebView_render(webView);
+		if(!renderBuffer)
+			break;
+		awe_RenderBuffer_copyTo(renderBuffer, &dest[0], rowSpan, 4, 0);
+		samples.push_back(now() - start);
+	}
+	double total = 0;
+	for(size_t i = 0; i < samples.size(); i++)
+		total += samples[i];
+	addResult(name, samples, total > 0?samples.size() * (double)dest.size() / (1024 * 1024) / (total / 1000):0, "MB/s");
+	awe_WebView_destroy(webView);
+}
+
+// a small changing box on a static 1080p page, uploads only the dirty region vs the whole frame
+static void benchDirtyUpload() {
+	WebViewListenerC listener;
+	int width = 1920, height = 1080;
+	WebViewC webView = createView(width, height, &listener);
+	char html[1024];
+	sprintf(html, animatedPage, 64, 64);
+	loadHTML(webView, html);
+
+	int rowSpan = width * 4;
+	std::vector<unsigned char> dest(rowSpan * height);
+	std::vector<double> full, dirty;
+	for(int i = 0; i < RENDER_ITERATIONS; i++) {
+		if(!waitForDirty(webView))
+			break;
+		double start = now();
+		RenderBufferC renderBuffer = awe_WebView_render(webView);
+		if(!renderBuffer)
+			break;
+		awe_RenderBuffer_copyTo(renderBuffer, &dest[0], rowSpan, 4, 0);
+		full.push_back(now() - start);
+	}
+	for(int i = 0; i < RENDER_ITERATIONS; i++) {
+		if(!waitForDirty(webView))
+			break;
+		double start = now();
+		RectC rect;
+		unsigned char* pixels;
+		int srcRowSpan;
+		if(!awe_WebView_renderDirtyRegion(webView, &rect, &pixels, &srcRowSpan))
+			break;
+		for(int y = 0; pixels && y < rect.height; y++)
+			memcpy(&dest[(rect.y + y) * rowSpan + rect.x * 4], pixels + y * srcRowSpan, rect.width * 4);
+		dirty.push_back(now() - start);
+	}
+	addResult("upload_full_1080p", full, 0, "");
+	addResult("upload_dirty_1080p", dirty, 0, "");
+	awe_WebView_destroy(webView);
+}
+
+static void benchJavascript() {
+	WebViewListenerC listener;
+	WebViewC webView = createView(512, 512, &listener);
+	loadHTML(webView, "<html><body></body></html>");
+
+	std::vector<double> samples;
+	for(int i = 0; i < JS_ITERATIONS; i++) {
+		double start = now();
+		awe_WebView_executeJavascriptWithResult(webView, "1 + 1", L"");
+		samples.push_back(now() - start);
+	}
+	addResult("js_roundtrip_sync", samples, 0, "");
+
+	samples.clear();
+	for(int i = 0; i < JS_ITERATIONS; i++) {
+		scriptsResolved = 0;
+		double start = now();
+		awe_WebView_executeJavascriptAsync(webView, "1 + 1", L"", onScriptResult, 0);
+		if(!waitFor(&scriptsResolved, 1))
+			break;
+		samples.push_back(now() - start);
+	}
+	addResult("js_roundtrip_async", samples, 0, "");
+
+	// all scripts in flight at once
+	scriptsResolved = 0;
+	double start = now();
+	for(int i = 0; i < JS_ITERATIONS; i++)
+		awe_WebView_executeJavascriptAsync(webView, "1 + 1", L"", onScriptResult, 0);
+	waitFor(&scriptsResolved, JS_ITERATIONS);
+	samples.clear();
+	samples.push_back(now() - start);
+	addResult("js_async_pipelined", samples, samples[0] > 0?scriptsResolved / (samples[0] / 1000):0, "scripts/s");
+	awe_WebView_destroy(webView);
+}
+
+static void benchCallbacks() {
+	WebViewListenerC listener;
+	WebViewC webView = createView(512, 512, &listener);
+	loadHTML(webView, "<html><body></body></html>");
+	awe_WebView_createObject(webView, L"bench");
+	awe_WebView_setObjectCallback(webView, L"bench", L"ping");
+
+	char script[256];
+	sprintf(script, "for(var i = 0; i < %d; i++) bench.ping(i);", CALLBACK_COUNT);
+	callbacksReceived = 0;
+	double start = now();
+	awe_WebView_executeJavascript(webView, script, L"");
+	waitFor(&callbacksReceived, CALLBACK_COUNT);
+	std::vector<double> samples;
+	samples.push_back(now() - start);
+	addResult("callback_dispatch", samples, samples[0] > 0?callbacksReceived / (samples[0] / 1000):0, "callbacks/s");
+	awe_WebView_destroy(webView);
+}
+
+static void benchInput() {
+	WebViewListenerC listener;
+	WebViewC webView = createView(512, 512, &listener);
+	loadHTML(webView, "<html><body><textarea autofocus></textarea></body></html>");
+
+	double start = now();
+	for(int i = 0; i < INPUT_COUNT; i++)
+		awe_WebView_injectMouseMove(webView, i % 512, (i / 512) % 512);
+	std::vector<double> samples;
+	samples.push_back(now() - start);
+	addResult("inject_mouse_move", samples, samples[0] > 0?INPUT_COUNT / (samples[0] / 1000):0, "events/s");
+
+	start = now();
+	for(int i = 0; i < INPUT_COUNT; i++)
+		awe_WebView_injectKeyboardEventCharacter(webView, 'a' + i % 26);
+	samples.clear();
+	samples.push_back(now() - start);
+	addResult("inject_keyboard_char", samples, samples[0] > 0?INPUT_COUNT / (samples[0] / 1000):0, "events/s");
+	awe_WebCore_update(webCore);
+	awe_WebView_destroy(webView);
+}
+
+static void writeCSV(FILE* out) {
+	fprintf(out, "name,iterations,total_ms,mean_ms,min_ms,max_ms,throughput,unit\n");
+	for(size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		fprintf(out, "%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%s\n", r.name.c_str(), r.iterations, r.totalMs, 
+			r.iterations?r.totalMs / r.iterations:0, r.minMs, r.maxMs, r.throughput, r.unit);
+	}
+}
+
+static void writeJSON(FILE* out) {
+	fprintf(out, "[\n");
+	for(size_t i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		fprintf(out, "  {\"name\": \"%s\", \"iterations\": %d, \"totalMs\": %.3f, \"meanMs\": %.3f, \"minMs\": %.3f, \"maxMs\": %.3f, \"throughput\": %.3f, \"unit\": \"%s\"}%s\n",
+			r.name.c_str(), r.iterations, r.totalMs, r.iterations?r.totalMs / r.iterations:0, r.minMs, r.maxMs, r.throughput, r.unit,
+			i + 1 < results.size()?",":"");
+	}
+	fprintf(out, "]\n");
+}
+
+int main(int argc, char** argv) {
+	bool json = false;
+	const char* outputPath = 0;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-json") == 0)
+			json = true;
+		else
+			outputPath = argv[i];
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	webCore = awe_WebCore_new();
+	benchLoad();
+	benchRender("render_copy_512", 512, 512);
+	benchRender("render_copy_1080p", 1920, 1080);
+	benchRender("render_copy_4k", 3840, 2160);
+	benchDirtyUpload();
+	benchJavascript();
+	benchCallbacks();
+	benchInput();
+	awe_WebCore_delete(webCore);
+
+	FILE* out = outputPath?fopen(outputPath, "w"):stdout;
+	if(!out) {
+		fprintf(stderr, "can't open %s\n", outputPath);
+		return 1;
+	}
+	if(json)
+		writeJSON(out);
+	else
+		writeCSV(out);
+	if(out != stdout)
+		fclose(out);
+	return 0;
+}
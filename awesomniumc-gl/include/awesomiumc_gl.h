@@ -0,0 +1,63 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_gl_h_
+#define __awesomnium_gl_h_
+#include "awesomiumc.h"
+
+#ifdef AWE_GL_EXPORTS
+#define AWE_GL_EXPORT __declspec(dllexport)
+#else
+#define AWE_GL_EXPORT __declspec(dllimport)
+#endif
+
+/**
+ * OpenGL texture kept up to date with a WebView. Each update renders the
+ * WebView and uploads only its dirty rectangles, straight from the BGRA render
+ * buffer, through a ring of pixel buffer objects guarded by fences so the CPU
+ * never waits for a transfer that is still in flight. Storage is only
+ * reallocated when the WebView changes size.
+ *
+ * The fastest path the context supports is used, up to the one asked for:
+ *
+ *   AWE_GL_UPLOAD_PERSISTENT  buffers mapped once (GL 4.4 / ARB_buffer_storage)
+ *   AWE_GL_UPLOAD_PBO         buffers mapped per upload (GL 3.2 / ARB_sync)
+ *   AWE_GL_UPLOAD_DIRECT      glTexSubImage2D from the render buffer
+ *
+ * Every function must be called with the context the texture was created
+ * with current on the calling thread.
+ */
+#define GLTextureC void*
+
+#define AWE_GL_UPLOAD_DIRECT 0
+#define AWE_GL_UPLOAD_PBO 1
+#define AWE_GL_UPLOAD_PERSISTENT 2
+
+#define AWE_GL_DEFAULT_RING_SIZE 3
+
+extern "C" {
+	extern AWE_GL_EXPORT GLTextureC    awe_GLTexture_new(WebViewC webView, int ringSize, int uploadPath);
+	extern AWE_GL_EXPORT void          awe_GLTexture_delete(GLTextureC texture);
+	extern AWE_GL_EXPORT int           awe_GLTexture_update(GLTextureC texture);
+	extern AWE_GL_EXPORT unsigned int  awe_GLTexture_getTexture(GLTextureC texture);
+	extern AWE_GL_EXPORT int           awe_GLTexture_getWidth(GLTextureC texture);
+	extern AWE_GL_EXPORT int           awe_GLTexture_getHeight(GLTextureC texture);
+	extern AWE_GL_EXPORT int           awe_GLTexture_getUploadPath(GLTextureC texture);
+}
+
+#endif
@@ -0,0 +1,349 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#define AWE_GL_EXPORTS
+#include "awesomiumc_gl.h"
+#include <GL/gl.h>
+#include <string.h>
+#include <vector>
+#include <new>
+
+/*-----------------------------------------------------------------------------
+  Entry points past OpenGL 1.1 are not in the Windows SDK headers and have to
+  be fetched from the driver, once per texture since wglGetProcAddress results
+  are only valid for the context they were fetched with.
+-----------------------------------------------------------------------------*/
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+#ifndef GL_UNSIGNED_INT_8_8_8_8_REV
+#define GL_UNSIGNED_INT_8_8_8_8_REV 0x8367
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#define GL_STREAM_DRAW 0x88E0
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x0001
+#define GL_WAIT_FAILED 0x911D
+
+// one second, a fence still pending after that means the context was lost
+#define AWE_GL_FENCE_TIMEOUT 1000000000ULL
+
+typedef ptrdiff_t GLsizeiptrC;
+typedef ptrdiff_t GLintptrC;
+typedef unsigned long long GLuint64C;
+typedef struct __GLsync* GLsyncC;
+
+typedef void (APIENTRY* PFNGLGENBUFFERS)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY* PFNGLDELETEBUFFERS)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY* PFNGLBINDBUFFER)(GLenum target, GLuint buffer);
+typedef void (APIENTRY* PFNGLBUFFERDATA)(GLenum target, GLsizeiptrC size, const void* data, GLenum usage);
+typedef void (APIENTRY* PFNGLBUFFERSTORAGE)(GLenum target, GLsizeiptrC size, const void* data, GLbitfield flags);
+typedef void* (APIENTRY* PFNGLMAPBUFFERRANGE)(GLenum target, GLintptrC offset, GLsizeiptrC length, GLbitfield access);
+typedef GLboolean (APIENTRY* PFNGLUNMAPBUFFER)(GLenum target);
+typedef GLsyncC (APIENTRY* PFNGLFENCESYNC)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY* PFNGLCLIENTWAITSYNC)(GLsyncC sync, GLbitfield flags, GLuint64C timeout);
+typedef void (APIENTRY* PFNGLDELETESYNC)(GLsyncC sync);
+
+struct GLFunctions {
+	PFNGLGENBUFFERS genBuffers;
+	PFNGLDELETEBUFFERS deleteBuffers;
+	PFNGLBINDBUFFER bindBuffer;
+	PFNGLBUFFERDATA bufferData;
+	PFNGLBUFFERSTORAGE bufferStorage;
+	PFNGLMAPBUFFERRANGE mapBufferRange;
+	PFNGLUNMAPBUFFER unmapBuffer;
+	PFNGLFENCESYNC fenceSync;
+	PFNGLCLIENTWAITSYNC clientWaitSync;
+	PFNGLDELETESYNC deleteSync;
+};
+
+static void* getProc(const char* name) {
+	// some drivers return small integers instead of 0 for unknown names
+	void* proc = (void*)wglGetProcAddress(name);
+	if(proc == (void*)1 || proc == (void*)2 || proc == (void*)3 || proc == (void*)-1)
+		return 0;
+	return proc;
+}
+
+// returns the fastest upload path up to maxPath that the current context supports
+static int loadFunctions(GLFunctions* gl, int maxPath) {
+	memset(gl, 0, sizeof(GLFunctions));
+	if(maxPath <= AWE_GL_UPLOAD_DIRECT)
+		return AWE_GL_UPLOAD_DIRECT;
+
+	gl->genBuffers = (PFNGLGENBUFFERS)getProc("glGenBuffers");
+	gl->deleteBuffers = (PFNGLDELETEBUFFERS)getProc("glDeleteBuffers");
+	gl->bindBuffer = (PFNGLBINDBUFFER)getProc("glBindBuffer");
+	gl->bufferData = (PFNGLBUFFERDATA)getProc("glBufferData");
+	gl->mapBufferRange = (PFNGLMAPBUFFERRANGE)getProc("glMapBufferRange");
+	gl->unmapBuffer = (PFNGLUNMAPBUFFER)getProc("glUnmapBuffer");
+	gl->fenceSync = (PFNGLFENCESYNC)getProc("glFenceSync");
+	gl->clientWaitSync = (PFNGLCLIENTWAITSYNC)getProc("glClientWaitSync");
+	gl->deleteSync = (PFNGLDELETESYNC)getProc("glDeleteSync");
+	if(!gl->genBuffers || !gl->deleteBuffers || !gl->bindBuffer || !gl->bufferData || !gl->mapBufferRange ||
+		!gl->unmapBuffer || !gl->fenceSync || !gl->clientWaitSync || !gl->deleteSync)
+		return AWE_GL_UPLOAD_DIRECT;
+
+	if(maxPath >= AWE_GL_UPLOAD_PERSISTENT) {
+		gl->bufferStorage = (PFNGLBUFFERSTORAGE)getProc("glBufferStorage");
+		if(gl->bufferStorage)
+			return AWE_GL_UPLOAD_PERSISTENT;
+	}
+	return AWE_GL_UPLOAD_PBO;
+}
+
+/*-----------------------------------------------------------------------------
+  GLTexture
+-----------------------------------------------------------------------------*/
+struct UploadSlot {
+	GLuint buffer;
+	GLsyncC fence;
+	unsigned char* mapped; // persistent mappings only
+};
+
+struct GLTexture {
+	WebViewC webView;
+	GLFunctions gl;
+	int uploadPath;
+	GLuint texture;
+	int width;
+	int height;
+	// every slot can take a whole frame, so a resize is the only reason to reallocate them
+	std::vector<UploadSlot> slots;
+	int slotSize;
+	int nextSlot;
+	std::vector<RectC> rects;
+
+	GLTexture(WebViewC webView, int ringSize, int uploadPath) : webView(webView), texture(0), width(0), height(0), slotSize(0), nextSlot(0) {
+		this->uploadPath = loadFunctions(&gl, uploadPath);
+		if(this->uploadPath != AWE_GL_UPLOAD_DIRECT)
+			slots.resize(ringSize > 0?ringSize:AWE_GL_DEFAULT_RING_SIZE);
+		for(size_t i = 0; i < slots.size(); i++) {
+			slots[i].buffer = 0;
+			slots[i].fence = 0;
+			slots[i].mapped = 0;
+		}
+
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	~GLTexture() {
+		releaseSlots();
+		glDeleteTextures(1, &texture);
+	}
+
+	void waitForSlot(UploadSlot& slot) {
+		if(!slot.fence)
+			return;
+		gl.clientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, AWE_GL_FENCE_TIMEOUT);
+		gl.deleteSync(slot.fence);
+		slot.fence = 0;
+	}
+
+	void releaseSlots() {
+		for(size_t i = 0; i < slots.size(); i++) {
+			UploadSlot& slot = slots[i];
+			waitForSlot(slot);
+			if(!slot.buffer)
+				continue;
+			if(slot.mapped) {
+				gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+				gl.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				slot.mapped = 0;
+			}
+			gl.deleteBuffers(1, &slot.buffer);
+			slot.buffer = 0;
+		}
+		if(!slots.empty() && gl.bindBuffer)
+			gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		slotSize = 0;
+	}
+
+	void allocateSlots(int size) {
+		releaseSlots();
+		for(size_t i = 0; i < slots.size(); i++) {
+			UploadSlot& slot = slots[i];
+			gl.genBuffers(1, &slot.buffer);
+			gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+			if(uploadPath == AWE_GL_UPLOAD_PERSISTENT) {
+				GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+				gl.bufferStorage(GL_PIXEL_UNPACK_BUFFER, size, 0, flags);
+				slot.mapped = (unsigned char*)gl.mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+			} else {
+				gl.bufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
+			}
+		}
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		slotSize = size;
+		nextSlot = 0;
+	}
+
+	void resize(int newWidth, int newHeight) {
+		width = newWidth;
+		height = newHeight;
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, 0);
+		if(!slots.empty())
+			allocateSlots(width * height * 4);
+	}
+
+	void uploadDirect(const unsigned char* pixels, int rowSpan) {
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, rowSpan / 4);
+		for(size_t i = 0; i < rects.size(); i++) {
+			const RectC& rect = rects[i];
+			glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+				pixels + rect.y * rowSpan + rect.x * 4);
+		}
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	}
+
+	void uploadBuffered(const unsigned char* pixels, int rowSpan) {
+		UploadSlot& slot = slots[nextSlot];
+		nextSlot = (nextSlot + 1) % (int)slots.size();
+		// the slot was last used ringSize uploads ago, this only blocks when the GPU is that far behind
+		waitForSlot(slot);
+
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+		unsigned char* dest = slot.mapped;
+		if(!dest)
+			dest = (unsigned char*)gl.mapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotSize, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+		if(!dest) {
+			gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			uploadDirect(pixels, rowSpan);
+			return;
+		}
+
+		// rects are packed tightly one after another
+		size_t offset = 0;
+		std::vector<size_t> offsets(rects.size());
+		for(size_t i = 0; i < rects.size(); i++) {
+			const RectC& rect = rects[i];
+			const unsigned char* src = pixels + rect.y * rowSpan + rect.x * 4;
+			offsets[i] = offset;
+			if(rect.width * 4 == rowSpan) {
+				memcpy(dest + offset, src, rect.height * rowSpan);
+				offset += rect.height * rowSpan;
+				continue;
+			}
+			for(int y = 0; y < rect.height; y++) {
+				memcpy(dest + offset, src, rect.width * 4);
+				src += rowSpan;
+				offset += rect.width * 4;
+			}
+		}
+		if(!slot.mapped)
+			gl.unmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		for(size_t i = 0; i < rects.size(); i++) {
+			const RectC& rect = rects[i];
+			glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV,
+				(const void*)offsets[i]);
+		}
+		slot.fence = gl.fenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	}
+
+	bool update() {
+		RectC dirty;
+		unsigned char* dirtyPixels;
+		int rowSpan;
+		RenderBufferC renderBuffer = awe_WebView_renderDirtyRegion(webView, &dirty, &dirtyPixels, &rowSpan);
+		if(!renderBuffer)
+			return false;
+
+		const unsigned char* pixels = awe_RenderBuffer_buffer(renderBuffer);
+		int bufferWidth = awe_RenderBuffer_width(renderBuffer);
+		int bufferHeight = awe_RenderBuffer_height(renderBuffer);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		rects.clear();
+		if(bufferWidth != width || bufferHeight != height) {
+			resize(bufferWidth, bufferHeight);
+			RectC all = { 0, 0, width, height };
+			rects.push_back(all);
+		} else if(dirty.width > 0 && dirty.height > 0) {
+			int count = awe_WebView_getDirtyRects(webView, 0, 0);
+			rects.resize(count);
+			if(count > 0)
+				awe_WebView_getDirtyRects(webView, &rects[0], count);
+
+			// overlapping damage rects could add up to more than a slot holds
+			int bytes = 0;
+			for(size_t i = 0; i < rects.size(); i++)
+				bytes += rects[i].width * rects[i].height * 4;
+			if(rects.empty() || bytes > width * height * 4) {
+				rects.clear();
+				rects.push_back(dirty);
+			}
+		}
+
+		bool changed = !rects.empty();
+		if(changed) {
+			if(slots.empty())
+				uploadDirect(pixels, rowSpan);
+			else
+				uploadBuffered(pixels, rowSpan);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return changed;
+	}
+};
+
+AWE_GL_EXPORT GLTextureC awe_GLTexture_new(WebViewC webView, int ringSize, int uploadPath) {
+	return new (std::nothrow) GLTexture(webView, ringSize, uploadPath);
+}
+
+AWE_GL_EXPORT void awe_GLTexture_delete(GLTextureC texture) {
+	GLTexture* ptr = static_cast<GLTexture*> (texture);
+	delete ptr;
+}
+
+AWE_GL_EXPORT int awe_GLTexture_update(GLTextureC texture) {
+	GLTexture* ptr = static_cast<GLTexture*> (texture);
+	return ptr->update()?-1:0;
+}
+
+AWE_GL_EXPORT unsigned int awe_GLTexture_getTexture(GLTextureC texture) {
+	GLTexture* ptr = static_cast<GLTexture*> (texture);
+	return ptr->texture;
+}
+
+AWE_GL_EXPORT int awe_GLTexture_getWidth(GLTextureC texture) {
+	GLTexture* ptr = static_cast<GLTexture*> (texture);
+	return ptr->width;
+}
+
+AWE_GL_EXPORT int awe_GLTexture_getHeight(GLTextureC texture) {
+	GLTexture* ptr = static_cast<GLTexture*> (texture);
+	return ptr->height;
+}
+
+AWE_GL_EXPORT int awe_GLTexture_getUploadPath(GLTextureC texture) {
+	GLTexture* ptr = static_cast<GLTexture*> (texture);
+	return ptr->uploadPath;
+}
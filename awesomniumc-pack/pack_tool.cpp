@@ -0,0 +1,154 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/**
+ * Packs a directory tree into a resource pack for awe_ResourcePack_open.
+ *
+ * usage: awesomniumc-pack <directory> <pack file>
+ */
+#include <windows.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "awesomiumc_pack.h"
+
+struct PackFile {
+	std::string path;
+	std::wstring fullPath;
+	unsigned int size;
+	unsigned int dataOffset;
+};
+
+static bool comparePath(const PackFile& a, const PackFile& b) {
+	return strcmp(a.path.c_str(), b.path.c_str()) < 0;
+}
+
+static std::string toUTF8(const std::wstring& str) {
+	int length = WideCharToMultiByte(CP_UTF8, 0, str.c_str(), -1, 0, 0, 0, 0);
+	if(length <= 1)
+		return std::string();
+	std::string result(length, 0);
+	WideCharToMultiByte(CP_UTF8, 0, str.c_str(), -1, &result[0], length, 0, 0);
+	result.resize(length - 1);
+	return result;
+}
+
+static void collectFiles(const std::wstring& directory, const std::string& prefix, std::vector<PackFile>& files) {
+	WIN32_FIND_DATAW data;
+	HANDLE find = FindFirstFileW((directory + L"\\*").c_str(), &data);
+	if(find == INVALID_HANDLE_VALUE)
+		return;
+	do {
+		std::wstring name = data.cFileName;
+		if(name == L"." || name == L"..")
+			continue;
+		if(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			collectFiles(directory + L"\\" + name, prefix + toUTF8(name) + "/", files);
+		} else {
+			PackFile file;
+			file.path = prefix + toUTF8(name);
+			file.fullPath = directory + L"\\" + name;
+			file.size = 0;
+			file.dataOffset = 0;
+			files.push_back(file);
+		}
+	} while(FindNextFileW(find, &data));
+	FindClose(find);
+}
+
+static bool readFile(const std::wstring& path, std::vector<unsigned char>& data) {
+	FILE* file = _wfopen(path.c_str(), L"rb");
+	if(!file)
+		return false;
+	data.clear();
+	unsigned char chunk[64 * 1024];
+	size_t read;
+	while((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		data.insert(data.end(), chunk, chunk + read);
+	fclose(file);
+	return true;
+}
+
+static unsigned int align(unsigned int offset) {
+	return (offset + AWE_PACK_ALIGNMENT - 1) & ~(AWE_PACK_ALIGNMENT - 1);
+}
+
+int wmain(int argc, wchar_t* argv[]) {
+	if(argc != 3) {
+		printf("usage: awesomniumc-pack <directory> <pack file>\n");
+		return 1;
+	}
+
+	std::vector<PackFile> files;
+	collectFiles(argv[1], "", files);
+	std::sort(files.begin(), files.end(), comparePath);
+
+	// index and string table
+	std::vector<ResourcePackEntryC> entries(files.size());
+	std::string strings;
+	unsigned int stringsStart = sizeof(ResourcePackHeaderC) + (unsigned int)(entries.size() * sizeof(ResourcePackEntryC));
+	for(size_t i = 0; i < files.size(); i++) {
+		entries[i].pathOffset = stringsStart + (unsigned int)strings.size();
+		strings += files[i].path;
+		strings += '\0';
+		entries[i].mimeTypeOffset = stringsStart + (unsigned int)strings.size();
+		strings += awe_guessMimeType(files[i].path.c_str());
+		strings += '\0';
+	}
+
+	FILE* out = _wfopen(argv[2], L"wb");
+	if(!out) {
+		wprintf(L"couldn't create %s\n", argv[2]);
+		return 1;
+	}
+
+	// contents are written first so sizes are known, the index is written last
+	unsigned int offset = align(stringsStart + (unsigned int)strings.size());
+	fseek(out, offset, SEEK_SET);
+	std::vector<unsigned char> data;
+	static const unsigned char padding[AWE_PACK_ALIGNMENT] = { 0 };
+	for(size_t i = 0; i < files.size(); i++) {
+		if(!readFile(files[i].fullPath, data)) {
+			wprintf(L"couldn't read %s\n", files[i].fullPath.c_str());
+			fclose(out);
+			return 1;
+		}
+		entries[i].dataOffset = offset;
+		entries[i].dataSize = (unsigned int)data.size();
+		if(!data.empty())
+			fwrite(&data[0], 1, data.size(), out);
+		unsigned int end = offset + (unsigned int)data.size();
+		offset = align(end);
+		fwrite(padding, 1, offset - end, out);
+	}
+
+	ResourcePackHeaderC header;
+	header.magic = AWE_PACK_MAGIC;
+	header.version = AWE_PACK_VERSION;
+	header.entryCount = (unsigned int)entries.size();
+	header.reserved = 0;
+	fseek(out, 0, SEEK_SET);
+	fwrite(&header, sizeof(header), 1, out);
+	if(!entries.empty())
+		fwrite(&entries[0], sizeof(ResourcePackEntryC), entries.size(), out);
+	fwrite(strings.data(), 1, strings.size(), out);
+	fclose(out);
+
+	printf("packed %d files, %u bytes\n", (int)files.size(), offset);
+	return 0;
+}
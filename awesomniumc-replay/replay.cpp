@@ -0,0 +1,399 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/**
+ * Replays a trace written with awe_Trace_start against a fresh WebCore, run
+ * from the directory holding the Awesomium runtime.
+ *
+ * usage: awesomniumc-replay [-fast] [-json] trace [output file]
+ *
+ * Calls are issued at their recorded times, or back to back with -fast. Each
+ * recorded awe_WebCore_update is timed together with rendering every dirty
+ * view, the result is printed as CSV (or JSON with -json) to stdout or the
+ * output file. All times are in milliseconds. Recorded callbacks are not
+ * replayed, the replayed pages raise their own and both counts are reported.
+ */
+#include "awesomiumc.h"
+#include "awesomiumc_trace.h"
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+// views that existed before recording started have no recorded size
+#define DEFAULT_WIDTH 512
+#define DEFAULT_HEIGHT 512
+
+struct Result {
+	int frames;
+	double totalMs;
+	double meanMs;
+	double p50Ms;
+	double p95Ms;
+	double p99Ms;
+	double maxMs;
+	double traceMs;
+	double replayMs;
+	int callbacksRecorded;
+	int callbacksReplayed;
+};
+
+static LARGE_INTEGER frequency;
+static WebCoreC webCore;
+static WebViewListenerC listener;
+static std::map<int, WebViewC> views;
+static volatile int callbacksReplayed = 0;
+
+static double now() {
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart * 1000.0 / frequency.QuadPart;
+}
+
+static void AWE_CALLBACK onCallback(WebViewC webView, const wchar_t* objectName, const wchar_t* callbackName, const JSArgumentsC args) {
+	callbacksReplayed++;
+}
+
+// the results of replayed asynchronous scripts are not compared with anything
+static void AWE_CALLBACK onJavascriptResult(WebViewC webView, int requestId, int succeeded, const JSValueC result, void* userData) {
+}
+
+static bool readTrace(const char* path, std::vector<char>& trace) {
+	FILE* file = fopen(path, "rb");
+	if(!file)
+		return false;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	trace.resize(size);
+	bool read = size > 0 && fread(&trace[0], 1, size, file) == (size_t)size;
+	fclose(file);
+	return read;
+}
+
+// payloads are not aligned within the trace, wide strings are copied out
+static std::wstring toWideString(const char* data, size_t size) {
+	std::wstring str(size / sizeof(wchar_t), 0);
+	if(!str.empty())
+		memcpy(&str[0], data, str.size() * sizeof(wchar_t));
+	return str;
+}
+
+static WebViewC getView(int viewId) {
+	std::map<int, WebViewC>::iterator it = views.find(viewId);
+	return it != views.end()?it->second:0;
+}
+
+static double updateFrame() {
+	double start = now();
+	awe_WebCore_update(webCore);
+	for(std::map<int, WebViewC>::iterator it = views.begin(); it != views.end(); it++) {
+		if(awe_WebView_isDirty(it->second))
+			awe_WebView_render(it->second);
+	}
+	return now() - start;
+}
+
+static void replayRecord(const TraceRecordC& record, const char* payload, std::vector<double>& frameTimes, Result& result) {
+	if(record.type == AWE_TRACE_CREATE_VIEW) {
+		WebViewC webView = awe_WebCore_createWebView(webCore, record.a?record.a:DEFAULT_WIDTH, record.b?record.b:DEFAULT_HEIGHT);
+		awe_WebView_setListener(webView, &listener);
+		views[record.viewId] = webView;
+		return;
+	}
+	if(record.type == AWE_TRACE_UPDATE) {
+		frameTimes.push_back(updateFrame());
+		return;
+	}
+	if(record.type == AWE_TRACE_CALLBACK) {
+		result.callbacksRecorded++;
+		return;
+	}
+
+	WebViewC webView = getView(record.viewId);
+	if(!webView)
+		return;
+	size_t textSize = std::min((size_t)record.a, (size_t)record.payloadSize);
+	std::wstring frameName;
+	std::wstring names;
+	switch(record.type) {
+		case AWE_TRACE_LOAD_URL:
+		case AWE_TRACE_LOAD_URL_W:
+		case AWE_TRACE_LOAD_HTML:
+		case AWE_TRACE_LOAD_HTML_W:
+		case AWE_TRACE_EXECUTE_JAVASCRIPT:
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_W:
+		case AWE_TRACE_LOAD_FILE:
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT:
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT_W:
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC:
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC_W:
+		case AWE_TRACE_CALL_JAVASCRIPT_FUNCTION:
+		case AWE_TRACE_BATCH_JAVASCRIPT:
+			frameName = toWideString(payload + textSize, record.payloadSize - textSize);
+			break;
+		case AWE_TRACE_CREATE_OBJECT:
+		case AWE_TRACE_SET_OBJECT_CALLBACK:
+			names = toWideString(payload, record.payloadSize);
+			break;
+	}
+
+	switch(record.type) {
+		case AWE_TRACE_DESTROY_VIEW:
+			awe_WebView_destroy(webView);
+			views.erase(record.viewId);
+			break;
+		case AWE_TRACE_LOAD_URL: {
+			std::string url(payload, textSize);
+			awe_WebView_loadURL(webView, url.c_str(), frameName.c_str(), "", "");
+			break;
+		}
+		case AWE_TRACE_LOAD_URL_W:
+			awe_WebView_loadURLW(webView, toWideString(payload, textSize).c_str(), frameName.c_str(), "", "");
+			break;
+		case AWE_TRACE_LOAD_HTML:
+			awe_WebView_loadHTML_n(webView, payload, (int)textSize, frameName.c_str());
+			break;
+		case AWE_TRACE_LOAD_HTML_W: {
+			std::wstring html = toWideString(payload, textSize);
+			awe_WebView_loadHTMLW_n(webView, html.c_str(), (int)html.size(), frameName.c_str());
+			break;
+		}
+		case AWE_TRACE_EXECUTE_JAVASCRIPT:
+			awe_WebView_executeJavascript_n(webView, payload, (int)textSize, frameName.c_str());
+			break;
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_W: {
+			std::wstring javascript = toWideString(payload, textSize);
+			awe_WebView_executeJavascriptW_n(webView, javascript.c_str(), (int)javascript.size(), frameName.c_str());
+			break;
+		}
+		case AWE_TRACE_RESIZE:
+			awe_WebView_resize(webView, record.a, record.b, 0, 0);
+			break;
+		case AWE_TRACE_MOUSE_MOVE:
+			awe_WebView_injectMouseMove(webView, record.a, record.b);
+			break;
+		case AWE_TRACE_MOUSE_DOWN:
+			awe_WebView_injectMouseDown(webView, record.a);
+			break;
+		case AWE_TRACE_MOUSE_UP:
+			awe_WebView_injectMouseUp(webView, record.a);
+			break;
+		case AWE_TRACE_MOUSE_WHEEL:
+			awe_WebView_injectMouseWheel(webView, record.a);
+			break;
+		case AWE_TRACE_KEYBOARD:
+			if(record.payloadSize == sizeof(WebKeyboardEventC)) {
+				WebKeyboardEventC keyboardEvent;
+				memcpy(&keyboardEvent, payload, sizeof(WebKeyboardEventC));
+				awe_WebView_injectKeyboardEvent(webView, &keyboardEvent);
+			}
+			break;
+		case AWE_TRACE_KEYBOARD_WINDOWS:
+			if(record.payloadSize == sizeof(LPARAM)) {
+				LPARAM lparam;
+				memcpy(&lparam, payload, sizeof(LPARAM));
+				awe_WebView_injectKeyboardEventWindows(webView, record.a, (WPARAM)record.b, lparam);
+			}
+			break;
+		case AWE_TRACE_CHARACTER:
+			awe_WebView_injectKeyboardEventCharacter(webView, (unsigned int)record.a);
+			break;
+		case AWE_TRACE_INPUT:
+			if(record.a > 0 && record.payloadSize == record.a * sizeof(InputEventC)) {
+				std::vector<InputEventC> events(record.a);
+				memcpy(&events[0], payload, record.payloadSize);
+				awe_WebView_injectEvents(webView, &events[0], record.a);
+			}
+			break;
+		case AWE_TRACE_CREATE_OBJECT:
+			awe_WebView_createObject(webView, names.c_str());
+			break;
+		case AWE_TRACE_SET_OBJECT_CALLBACK: {
+			size_t separator = names.find(L'\0');
+			if(separator != std::wstring::npos)
+				awe_WebView_setObjectCallback(webView, names.substr(0, separator).c_str(), names.c_str() + separator + 1);
+			break;
+		}
+		case AWE_TRACE_LOAD_FILE: {
+			std::string file(payload, textSize);
+			awe_WebView_loadFile(webView, file.c_str(), frameName.c_str());
+			break;
+		}
+		case AWE_TRACE_GO_TO_HISTORY_OFFSET:
+			awe_WebView_goToHistoryOffset(webView, record.a);
+			break;
+		case AWE_TRACE_STOP:
+			awe_WebView_stop(webView);
+			break;
+		case AWE_TRACE_RELOAD:
+			awe_WebView_reload(webView);
+			break;
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT: {
+			std::string javascript(payload, textSize);
+			if(record.b < 0)
+				awe_WebView_executeJavascriptWithResult(webView, javascript.c_str(), frameName.c_str());
+			else
+				awe_WebView_executeJavascriptWithResultTimeout(webView, javascript.c_str(), frameName.c_str(), record.b);
+			break;
+		}
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT_W: {
+			std::wstring javascript = toWideString(payload, textSize);
+			if(record.b < 0)
+				awe_WebView_executeJavascriptWithResultW(webView, javascript.c_str(), frameName.c_str());
+			else
+				awe_WebView_executeJavascriptWithResultTimeoutW(webView, javascript.c_str(), frameName.c_str(), record.b);
+			break;
+		}
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC: {
+			std::string javascript(payload, textSize);
+			awe_WebView_executeJavascriptAsync(webView, javascript.c_str(), frameName.c_str(), onJavascriptResult, 0);
+			break;
+		}
+		case AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC_W: {
+			std::wstring javascript = toWideString(payload, textSize);
+			awe_WebView_executeJavascriptAsyncW(webView, javascript.c_str(), frameName.c_str(), onJavascriptResult, 0);
+			break;
+		}
+		case AWE_TRACE_CALL_JAVASCRIPT_FUNCTION: {
+			std::wstring javascript = toWideString(payload, textSize);
+			awe_WebView_executeJavascriptW_n(webView, javascript.c_str(), (int)javascript.size(), frameName.c_str());
+			break;
+		}
+		case AWE_TRACE_BATCH_JAVASCRIPT:
+			awe_WebView_batchJavascriptW(webView, toWideString(payload, textSize).c_str(), frameName.c_str());
+			break;
+		case AWE_TRACE_FLUSH_BATCH:
+			awe_WebView_flushJavascriptBatch(webView);
+			break;
+	}
+}
+
+// replays every record, false if the trace is not readable
+static bool replay(const std::vector<char>& trace, bool fast, Result& result) {
+	if(trace.size() < sizeof(TraceHeaderC))
+		return false;
+	TraceHeaderC header;
+	memcpy(&header, &trace[0], sizeof(TraceHeaderC));
+	if(header.magic != AWE_TRACE_MAGIC || header.version != AWE_TRACE_VERSION)
+		return false;
+
+	std::vector<double> frameTimes;
+	double traceMicros = 0;
+	double start = now();
+	size_t offset = sizeof(TraceHeaderC);
+	while(offset + sizeof(TraceRecordC) <= trace.size()) {
+		TraceRecordC record;
+		memcpy(&record, &trace[offset], sizeof(TraceRecordC));
+		offset += sizeof(TraceRecordC);
+		if(record.payloadSize > trace.size() - offset)
+			break;
+		traceMicros += record.delta;
+		if(!fast) {
+			double wait;
+			while((wait = traceMicros / 1000 - (now() - start)) > 0)
+				Sleep(wait > 2?(int)wait - 1:0);
+		}
+		replayRecord(record, &trace[0] + offset, frameTimes, result);
+		offset += record.payloadSize;
+	}
+	result.replayMs = now() - start;
+	result.traceMs = traceMicros / 1000;
+
+	result.frames = (int)frameTimes.size();
+	result.totalMs = 0;
+	for(size_t i = 0; i < frameTimes.size(); i++)
+		result.totalMs += frameTimes[i];
+	std::sort(frameTimes.begin(), frameTimes.end());
+	result.meanMs = frameTimes.empty()?0:result.totalMs / frameTimes.size();
+	result.p50Ms = frameTimes.empty()?0:frameTimes[frameTimes.size() * 50 / 100];
+	result.p95Ms = frameTimes.empty()?0:frameTimes[frameTimes.size() * 95 / 100];
+	result.p99Ms = frameTimes.empty()?0:frameTimes[frameTimes.size() * 99 / 100];
+	result.maxMs = frameTimes.empty()?0:frameTimes.back();
+	result.callbacksReplayed = callbacksReplayed;
+	return true;
+}
+
+static void writeCSV(FILE* out, const Result& r) {
+	fprintf(out, "frames,total_ms,mean_ms,p50_ms,p95_ms,p99_ms,max_ms,trace_ms,replay_ms,callbacks_recorded,callbacks_replayed\n");
+	fprintf(out, "%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%d\n", r.frames, r.totalMs, r.meanMs, r.p50Ms, r.p95Ms, r.p99Ms, r.maxMs,
+		r.traceMs, r.replayMs, r.callbacksRecorded, r.callbacksReplayed);
+}
+
+static void writeJSON(FILE* out, const Result& r) {
+	fprintf(out, "{\"frames\": %d, \"totalMs\": %.3f, \"meanMs\": %.3f, \"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f, "
+		"\"traceMs\": %.3f, \"replayMs\": %.3f, \"callbacksRecorded\": %d, \"callbacksReplayed\": %d}\n",
+		r.frames, r.totalMs, r.meanMs, r.p50Ms, r.p95Ms, r.p99Ms, r.maxMs, r.traceMs, r.replayMs, r.callbacksRecorded, r.callbacksReplayed);
+}
+
+int main(int argc, char** argv) {
+	bool fast = false;
+	bool json = false;
+	const char* tracePath = 0;
+	const char* outputPath = 0;
+	for(int i = 1; i < argc; i++) {
+		if(strcmp(argv[i], "-fast") == 0)
+			fast = true;
+		else if(strcmp(argv[i], "-json") == 0)
+			json = true;
+		else if(!tracePath)
+			tracePath = argv[i];
+		else
+			outputPath = argv[i];
+	}
+	if(!tracePath) {
+		fprintf(stderr, "usage: awesomniumc-replay [-fast] [-json] trace [output file]\n");
+		return 1;
+	}
+	std::vector<char> trace;
+	if(!readTrace(tracePath, trace)) {
+		fprintf(stderr, "can't read %s\n", tracePath);
+		return 1;
+	}
+
+	QueryPerformanceFrequency(&frequency);
+	memset(&listener, 0, sizeof(WebViewListenerC));
+	listener.onCallback = onCallback;
+	webCore = awe_WebCore_new();
+	Result result;
+	memset(&result, 0, sizeof(Result));
+	bool replayed = replay(trace, fast, result);
+	for(std::map<int, WebViewC>::iterator it = views.begin(); it != views.end(); it++)
+		awe_WebView_destroy(it->second);
+	views.clear();
+	awe_WebCore_delete(webCore);
+	if(!replayed) {
+		fprintf(stderr, "%s is not a version %d trace\n", tracePath, AWE_TRACE_VERSION);
+		return 1;
+	}
+
+	FILE* out = outputPath?fopen(outputPath, "w"):stdout;
+	if(!out) {
+		fprintf(stderr, "can't open %s\n", outputPath);
+		return 1;
+	}
+	if(json)
+		writeJSON(out, result);
+	else
+		writeCSV(out, result);
+	if(out != stdout)
+		fclose(out);
+	return 0;
+}
@@ -0,0 +1,187 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "awesomiumc.h"
+#include "awesomiumc_trace.h"
+#include "unit_tests.h"
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define TRACE_PATH L"unit_test.trace"
+#define THREAD_TASKS 1000
+
+static std::vector<int> executed;
+
+static void AWE_CALLBACK recordTask(WebCoreC webCore, void* userData) {
+	executed.push_back((int)(size_t)userData);
+}
+
+static void AWE_CALLBACK repostTask(WebCoreC webCore, void* userData) {
+	executed.push_back(-1);
+	awe_WebCore_postTask(recordTask, userData);
+}
+
+static bool isSequence(const std::vector<int>& values, int first, int count) {
+	if(values.size() != (size_t)count)
+		return false;
+	for(int i = 0; i < count; i++) {
+		if(values[i] != first + i)
+			return false;
+	}
+	return true;
+}
+
+static void testTaskOrder(WebCoreC webCore) {
+	executed.clear();
+	for(int i = 1; i <= 100; i++)
+		awe_WebCore_postTask(recordTask, (void*)(size_t)i);
+	CHECK(executed.empty());
+	awe_WebCore_update(webCore);
+	CHECK(isSequence(executed, 1, 100));
+	executed.clear();
+	awe_WebCore_update(webCore);
+	CHECK(executed.empty());
+
+	// a task posted by a task waits for the next update
+	awe_WebCore_postTask(repostTask, (void*)7);
+	awe_WebCore_postTask(recordTask, (void*)8);
+	awe_WebCore_update(webCore);
+	CHECK(executed.size() == 2 && executed[0] == -1 && executed[1] == 8);
+	executed.clear();
+	awe_WebCore_update(webCore);
+	CHECK(executed.size() == 1 && executed[0] == 7);
+
+	executed.clear();
+	awe_WebCore_postTask(0, 0);
+	awe_WebCore_update(webCore);
+	CHECK(executed.empty());
+}
+
+static DWORD WINAPI postTasks(LPVOID param) {
+	int first = (int)(size_t)param;
+	for(int i = 0; i < THREAD_TASKS; i++)
+		awe_WebCore_postTask(recordTask, (void*)(size_t)(first + i));
+	return 0;
+}
+
+// posts from other threads all arrive, each thread's in the order they were posted
+static void testConcurrentPosts(WebCoreC webCore) {
+	executed.clear();
+	HANDLE threads[2];
+	threads[0] = CreateThread(0, 0, postTasks, (LPVOID)(size_t)0, 0, 0);
+	threads[1] = CreateThread(0, 0, postTasks, (LPVOID)(size_t)THREAD_TASKS, 0, 0);
+	WaitForMultipleObjects(2, threads, TRUE, INFINITE);
+	CloseHandle(threads[0]);
+	CloseHandle(threads[1]);
+	awe_WebCore_update(webCore);
+
+	CHECK(executed.size() == THREAD_TASKS * 2);
+	std::vector<int> fromFirst, fromSecond;
+	for(size_t i = 0; i < executed.size(); i++)
+		(executed[i] < THREAD_TASKS?fromFirst:fromSecond).push_back(executed[i]);
+	CHECK(isSequence(fromFirst, 0, THREAD_TASKS));
+	CHECK(isSequence(fromSecond, THREAD_TASKS, THREAD_TASKS));
+}
+
+// the urls of the load records the trace holds, posted calls are recorded when they execute
+static std::vector<std::string> readTracedLoads() {
+	std::vector<std::string> urls;
+	FILE* file = _wfopen(TRACE_PATH, L"rb");
+	if(!file)
+		return urls;
+	TraceHeaderC header;
+	if(fread(&header, sizeof(header), 1, file) == 1 && header.magic == AWE_TRACE_MAGIC) {
+		TraceRecordC record;
+		std::vector<char> payload;
+		while(fread(&record, sizeof(record), 1, file) == 1) {
+			payload.resize(record.payloadSize + 1);
+			if(record.payloadSize && fread(&payload[0], 1, record.payloadSize, file) != record.payloadSize)
+				break;
+			if(record.type == AWE_TRACE_LOAD_URL)
+				urls.push_back(std::string(&payload[0], record.a));
+		}
+	}
+	fclose(file);
+	return urls;
+}
+
+static int countLoads(const std::vector<std::string>& urls, const char* url) {
+	int count = 0;
+	for(size_t i = 0; i < urls.size(); i++) {
+		if(urls[i] == url)
+			count++;
+	}
+	return count;
+}
+
+// commands for a view that was destroyed or handed back to its pool before
+// the update are dropped, the view's own commands still run
+static void testViewCommands(WebCoreC webCore) {
+	WebViewC live = awe_WebCore_createWebView(webCore, 64, 64);
+	WebViewC destroyed = awe_WebCore_createWebView(webCore, 64, 64);
+	WebViewPoolC pool = awe_WebViewPool_new(webCore, 64, 64, 1);
+	WebViewC pooled = awe_WebViewPool_acquire(pool, 64, 64);
+	CHECK(pooled != 0);
+	awe_WebCore_update(webCore);
+
+	CHECK(awe_Trace_start(TRACE_PATH) == -1);
+	awe_WebView_postLoadURL(live, "about:blank#live", L"", 0, 0);
+	awe_WebView_postLoadURL(destroyed, "about:blank#destroyed", L"", 0, 0);
+	awe_WebView_destroy(destroyed);
+	awe_WebView_postLoadURL(destroyed, "about:blank#after-destroy", L"", 0, 0);
+	if(pooled) {
+		awe_WebView_postLoadURL(pooled, "about:blank#released", L"", 0, 0);
+		awe_WebViewPool_release(pool, pooled);
+	}
+	awe_WebCore_update(webCore);
+	awe_WebCore_update(webCore);
+	awe_Trace_stop();
+
+	std::vector<std::string> urls = readTracedLoads();
+	CHECK(countLoads(urls, "about:blank#live") == 1);
+	CHECK(countLoads(urls, "about:blank#destroyed") == 0);
+	CHECK(countLoads(urls, "about:blank#after-destroy") == 0);
+	CHECK(countLoads(urls, "about:blank#released") == 0);
+	DeleteFileW(TRACE_PATH);
+
+	// a view acquired again keeps working with the new generation
+	pooled = awe_WebViewPool_acquire(pool, 64, 64);
+	CHECK(pooled != 0);
+	if(pooled) {
+		CHECK(awe_Trace_start(TRACE_PATH) == -1);
+		awe_WebView_postLoadURL(pooled, "about:blank#reacquired", L"", 0, 0);
+		awe_WebCore_update(webCore);
+		awe_Trace_stop();
+		urls = readTracedLoads();
+		CHECK(countLoads(urls, "about:blank#reacquired") == 1);
+		DeleteFileW(TRACE_PATH);
+		awe_WebViewPool_release(pool, pooled);
+	}
+	awe_WebViewPool_delete(pool);
+	awe_WebView_destroy(live);
+}
+
+void testCommandQueue() {
+	WebCoreC webCore = awe_WebCore_new();
+	testTaskOrder(webCore);
+	testConcurrentPosts(webCore);
+	testViewCommands(webCore);
+	awe_WebCore_delete(webCore);
+}
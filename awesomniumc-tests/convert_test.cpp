@@ -0,0 +1,114 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "awesomiumc.h"
+#include "unit_tests.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define GUARD 0xCD
+
+// deterministic across runs and platforms, unlike rand()
+static unsigned char nextByte(unsigned int* seed) {
+	*seed = *seed * 1103515245 + 12345;
+	return (unsigned char)(*seed >> 16);
+}
+
+// transparent and opaque pixels take their own paths in unpremultiply, so they are made common
+static void fillPixels(std::vector<unsigned char>& pixels, unsigned int* seed) {
+	for(size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = nextByte(seed);
+	for(size_t i = 3; i < pixels.size(); i += 4) {
+		unsigned char choice = nextByte(seed) & 3;
+		if(choice == 0)
+			pixels[i] = 0;
+		else if(choice == 1)
+			pixels[i] = 255;
+	}
+}
+
+static void testKnownPixels() {
+	const unsigned char src[8] = { 10, 20, 30, 40, 200, 100, 50, 0 };
+	unsigned char dest[8];
+
+	awe_convertPixels(src, 8, dest, 8, 2, 1, AWE_CONVERT_BGRA_TO_RGBA);
+	CHECK(dest[0] == 30 && dest[1] == 20 && dest[2] == 10 && dest[3] == 40);
+	CHECK(dest[4] == 50 && dest[5] == 100 && dest[6] == 200 && dest[7] == 0);
+
+	memset(dest, GUARD, sizeof(dest));
+	awe_convertPixels(src, 8, dest, 6, 2, 1, AWE_CONVERT_BGRA_TO_RGB);
+	CHECK(dest[0] == 30 && dest[1] == 20 && dest[2] == 10 && dest[3] == 50 && dest[4] == 100 && dest[5] == 200);
+	CHECK(dest[6] == GUARD && dest[7] == GUARD);
+
+	// (c * a + 127) / 255
+	awe_convertPixels(src, 8, dest, 8, 2, 1, AWE_CONVERT_PREMULTIPLY);
+	CHECK(dest[0] == 2 && dest[1] == 3 && dest[2] == 5 && dest[3] == 40);
+	CHECK(dest[4] == 0 && dest[5] == 0 && dest[6] == 0 && dest[7] == 0);
+
+	const unsigned char premultiplied[8] = { 2, 3, 5, 40, 128, 64, 0, 128 };
+	awe_convertPixels(premultiplied, 8, dest, 8, 2, 1, AWE_CONVERT_UNPREMULTIPLY);
+	CHECK(dest[0] == 13 && dest[1] == 19 && dest[2] == 32 && dest[3] == 40);
+	CHECK(dest[4] == 255 && dest[5] == 128 && dest[6] == 0 && dest[7] == 128);
+
+	awe_convertPixels(src, 8, dest, 8, 2, 1, AWE_CONVERT_FORCE_OPAQUE);
+	CHECK(dest[0] == 10 && dest[1] == 20 && dest[2] == 30 && dest[3] == 255 && dest[7] == 255);
+}
+
+// every SIMD level has to match the scalar kernels byte for byte, the widths
+// cover the block sizes of all kernels and every tail length. Rows are padded
+// and start at odd addresses, the padding must not be written to.
+static void testLevelsMatchScalar(int maxLevel) {
+	unsigned int seed = 1;
+	for(int conversion = AWE_CONVERT_BGRA_TO_RGBA; conversion <= AWE_CONVERT_FORCE_OPAQUE; conversion++) {
+		for(int width = 1; width < 70; width++) {
+			int height = 3;
+			int srcRowSpan = width * 4 + 12;
+			int destRowSpan = width * 4 + 8;
+			std::vector<unsigned char> src(srcRowSpan * height + 1);
+			fillPixels(src, &seed);
+
+			std::vector<unsigned char> expected(destRowSpan * height + 1, GUARD);
+			awe_setSIMDLevel(AWE_SIMD_NONE);
+			awe_convertPixels(&src[1], srcRowSpan, &expected[1], destRowSpan, width, height, conversion);
+
+			for(int level = AWE_SIMD_SSE2; level <= maxLevel; level++) {
+				std::vector<unsigned char> dest(destRowSpan * height + 1, GUARD);
+				awe_setSIMDLevel(level);
+				awe_convertPixels(&src[1], srcRowSpan, &dest[1], destRowSpan, width, height, conversion);
+				if(dest != expected)
+					printf("conversion %d, width %d, SIMD level %d\n", conversion, width, level);
+				CHECK(dest == expected);
+			}
+		}
+	}
+}
+
+void testConvert() {
+	// what the CPU supports, nothing has lowered it yet
+	int maxLevel = awe_getSIMDLevel();
+	awe_setSIMDLevel(AWE_SIMD_NONE);
+	CHECK(awe_getSIMDLevel() == AWE_SIMD_NONE);
+	testKnownPixels();
+	for(int level = AWE_SIMD_SSE2; level <= maxLevel; level++) {
+		awe_setSIMDLevel(level);
+		testKnownPixels();
+	}
+	testLevelsMatchScalar(maxLevel);
+	awe_setSIMDLevel(maxLevel);
+	CHECK(awe_getSIMDLevel() == maxLevel);
+}
@@ -0,0 +1,147 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "internal.h"
+#include "unit_tests.h"
+#include <string.h>
+#include <vector>
+
+// three full tile columns and a partial one, two full tile rows and a partial one
+#define WIDTH (AWE_DAMAGE_TILE_SIZE * 3 + 10)
+#define HEIGHT (AWE_DAMAGE_TILE_SIZE * 2 + 22)
+#define ROW_SPAN (WIDTH * 4 + 16)
+
+static bool equalRect(const RectC& rect, int x, int y, int width, int height) {
+	return rect.x == x && rect.y == y && rect.width == width && rect.height == height;
+}
+
+static void touchTile(std::vector<unsigned char>& pixels, int tx, int ty) {
+	pixels[(ty * AWE_DAMAGE_TILE_SIZE + 5) * ROW_SPAN + (tx * AWE_DAMAGE_TILE_SIZE + 3) * 4]++;
+}
+
+static void track(DamageShadow& shadow, const std::vector<unsigned char>& pixels, const RectC& dirty, std::vector<RectC>& dirtyRects) {
+	trackDamage(shadow, &pixels[0], WIDTH, HEIGHT, ROW_SPAN, dirty, dirtyRects);
+}
+
+static void testTrackDamage() {
+	std::vector<unsigned char> pixels(ROW_SPAN * HEIGHT, 0x40);
+	const RectC all = makeRect(0, 0, WIDTH, HEIGHT);
+	DamageShadow shadow;
+	std::vector<RectC> dirtyRects;
+
+	// the first frame has nothing to compare against
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.size() == 1 && equalRect(dirtyRects[0], 0, 0, WIDTH, HEIGHT));
+
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.empty());
+
+	track(shadow, pixels, makeRect(0, 0, 0, 0), dirtyRects);
+	CHECK(dirtyRects.empty());
+
+	// adjacent tiles in a row are merged into a run
+	touchTile(pixels, 0, 0);
+	touchTile(pixels, 1, 0);
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.size() == 1 && equalRect(dirtyRects[0], 0, 0, AWE_DAMAGE_TILE_SIZE * 2, AWE_DAMAGE_TILE_SIZE));
+
+	// the shadow took the change, so the same frame is clean
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.empty());
+
+	// runs with the same extent in consecutive rows are merged vertically
+	touchTile(pixels, 1, 0);
+	touchTile(pixels, 2, 0);
+	touchTile(pixels, 1, 1);
+	touchTile(pixels, 2, 1);
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.size() == 1 && equalRect(dirtyRects[0], AWE_DAMAGE_TILE_SIZE, 0, AWE_DAMAGE_TILE_SIZE * 2, AWE_DAMAGE_TILE_SIZE * 2));
+
+	// runs of different extent stay apart, as do tiles with a clean one between them
+	touchTile(pixels, 0, 0);
+	touchTile(pixels, 2, 0);
+	touchTile(pixels, 0, 1);
+	touchTile(pixels, 1, 1);
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.size() == 3);
+	if(dirtyRects.size() == 3) {
+		CHECK(equalRect(dirtyRects[0], 0, 0, AWE_DAMAGE_TILE_SIZE, AWE_DAMAGE_TILE_SIZE));
+		CHECK(equalRect(dirtyRects[1], AWE_DAMAGE_TILE_SIZE * 2, 0, AWE_DAMAGE_TILE_SIZE, AWE_DAMAGE_TILE_SIZE));
+		CHECK(equalRect(dirtyRects[2], 0, AWE_DAMAGE_TILE_SIZE, AWE_DAMAGE_TILE_SIZE * 2, AWE_DAMAGE_TILE_SIZE));
+	}
+
+	// tiles at the right and bottom edge are clipped to the frame
+	touchTile(pixels, 3, 2);
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.size() == 1 && equalRect(dirtyRects[0], AWE_DAMAGE_TILE_SIZE * 3, AWE_DAMAGE_TILE_SIZE * 2, 10, 22));
+
+	// only the tiles under the dirty bounds are compared, a change elsewhere
+	// is found once the bounds cover it
+	touchTile(pixels, 0, 0);
+	track(shadow, pixels, makeRect(AWE_DAMAGE_TILE_SIZE * 2 + 1, AWE_DAMAGE_TILE_SIZE + 1, 2, 2), dirtyRects);
+	CHECK(dirtyRects.empty());
+	track(shadow, pixels, makeRect(10, 10, 1, 1), dirtyRects);
+	CHECK(dirtyRects.size() == 1 && equalRect(dirtyRects[0], 0, 0, AWE_DAMAGE_TILE_SIZE, AWE_DAMAGE_TILE_SIZE));
+
+	// bytes past the row's pixels aren't part of the frame
+	pixels[ROW_SPAN - 1]++;
+	track(shadow, pixels, all, dirtyRects);
+	CHECK(dirtyRects.empty());
+
+	// a new size starts over with the whole frame
+	std::vector<unsigned char> smaller(ROW_SPAN * HEIGHT, 0x40);
+	trackDamage(shadow, &smaller[0], WIDTH - 1, HEIGHT, ROW_SPAN, all, dirtyRects);
+	CHECK(dirtyRects.size() == 1 && equalRect(dirtyRects[0], 0, 0, WIDTH - 1, HEIGHT));
+	CHECK(shadow.width == WIDTH - 1 && shadow.height == HEIGHT);
+}
+
+static void testCopyDirtyRects() {
+	std::vector<RectC> dirtyRects;
+	dirtyRects.push_back(makeRect(0, 0, 64, 64));
+	dirtyRects.push_back(makeRect(128, 0, 64, 64));
+	dirtyRects.push_back(makeRect(64, 128, 64, 32));
+	dirtyRects.push_back(makeRect(256, 64, 10, 10));
+	RectC rects[5];
+
+	CHECK(copyDirtyRects(dirtyRects, 0, 0) == 4);
+	CHECK(copyDirtyRects(dirtyRects, rects, 0) == 0);
+	CHECK(copyDirtyRects(std::vector<RectC>(), rects, 5) == 0);
+
+	memset(rects, 0, sizeof(rects));
+	CHECK(copyDirtyRects(dirtyRects, rects, 5) == 4);
+	for(int i = 0; i < 4; i++)
+		CHECK(equalRect(rects[i], dirtyRects[i].x, dirtyRects[i].y, dirtyRects[i].width, dirtyRects[i].height));
+	CHECK(equalRect(rects[4], 0, 0, 0, 0));
+
+	CHECK(copyDirtyRects(dirtyRects, rects, 4) == 4);
+	CHECK(equalRect(rects[3], 256, 64, 10, 10));
+
+	// what doesn't fit is collapsed into the last slot
+	memset(rects, 0, sizeof(rects));
+	CHECK(copyDirtyRects(dirtyRects, rects, 2) == 2);
+	CHECK(equalRect(rects[0], 0, 0, 64, 64));
+	CHECK(equalRect(rects[1], 64, 0, 202, 160));
+	CHECK(equalRect(rects[2], 0, 0, 0, 0));
+
+	CHECK(copyDirtyRects(dirtyRects, rects, 1) == 1);
+	CHECK(equalRect(rects[0], 0, 0, 266, 160));
+}
+
+void testDamageTracking() {
+	testTrackDamage();
+	testCopyDirtyRects();
+}
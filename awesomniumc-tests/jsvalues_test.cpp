@@ -0,0 +1,122 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "internal.h"
+#include "unit_tests.h"
+
+using namespace Awesomium;
+
+static bool isUnchanged(const JSValue& a, const JSValue& b) {
+	// equality has to hold both ways round
+	return equalJSValues(a, b) && equalJSValues(b, a);
+}
+
+static bool isChanged(const JSValue& a, const JSValue& b) {
+	return !equalJSValues(a, b) && !equalJSValues(b, a);
+}
+
+static void testScalars() {
+	CHECK(isUnchanged(JSValue(), JSValue()));
+	CHECK(isChanged(JSValue(), JSValue(0)));
+	CHECK(isChanged(JSValue(), JSValue(false)));
+	CHECK(isChanged(JSValue(), JSValue(L"")));
+
+	CHECK(isUnchanged(JSValue(true), JSValue(true)));
+	CHECK(isChanged(JSValue(true), JSValue(false)));
+	CHECK(isChanged(JSValue(true), JSValue(1)));
+	CHECK(isChanged(JSValue(false), JSValue(0.0)));
+
+	CHECK(isUnchanged(JSValue(42), JSValue(42)));
+	CHECK(isChanged(JSValue(42), JSValue(43)));
+	CHECK(isUnchanged(JSValue(0.5), JSValue(0.5)));
+	CHECK(isChanged(JSValue(0.5), JSValue(0.25)));
+
+	CHECK(isUnchanged(JSValue(L"text"), JSValue(L"text")));
+	CHECK(isChanged(JSValue(L"text"), JSValue(L"Text")));
+	CHECK(isChanged(JSValue(L"1"), JSValue(1)));
+}
+
+// the page only has numbers, an integer and a double of the same value are the same property value
+static void testNumbers() {
+	CHECK(isUnchanged(JSValue(1), JSValue(1.0)));
+	CHECK(isUnchanged(JSValue(-7), JSValue(-7.0)));
+	CHECK(isUnchanged(JSValue(0), JSValue(-0.0)));
+	CHECK(isChanged(JSValue(1), JSValue(1.5)));
+	CHECK(isChanged(JSValue(2147483647), JSValue(2147483648.0)));
+
+	volatile double zero = 0.0;
+	double nan = zero / zero;
+	double infinity = 1.0 / zero;
+	CHECK(isUnchanged(JSValue(nan), JSValue(nan)));
+	CHECK(isChanged(JSValue(nan), JSValue(0.0)));
+	CHECK(isChanged(JSValue(nan), JSValue(0)));
+	CHECK(isChanged(JSValue(nan), JSValue()));
+	CHECK(isUnchanged(JSValue(infinity), JSValue(infinity)));
+	CHECK(isChanged(JSValue(infinity), JSValue(-infinity)));
+}
+
+static void testContainers() {
+	volatile double zero = 0.0;
+	JSValue::Array array;
+	array.push_back(JSValue(1));
+	array.push_back(JSValue(L"two"));
+	array.push_back(JSValue(zero / zero));
+	JSValue::Array same = array;
+	same[0] = JSValue(1.0);
+	CHECK(isUnchanged(JSValue(array), JSValue(same)));
+
+	JSValue::Array reordered;
+	reordered.push_back(array[1]);
+	reordered.push_back(array[0]);
+	reordered.push_back(array[2]);
+	CHECK(isChanged(JSValue(array), JSValue(reordered)));
+	JSValue::Array shorter(array.begin(), array.end() - 1);
+	CHECK(isChanged(JSValue(array), JSValue(shorter)));
+	CHECK(isChanged(JSValue(JSValue::Array()), JSValue(JSValue::Object())));
+	CHECK(isUnchanged(JSValue(JSValue::Array()), JSValue(JSValue::Array())));
+
+	JSValue::Object object;
+	object[L"x"] = JSValue(10);
+	object[L"y"] = JSValue(20);
+	object[L"items"] = JSValue(array);
+	JSValue::Object copy = object;
+	copy[L"x"] = JSValue(10.0);
+	CHECK(isUnchanged(JSValue(object), JSValue(copy)));
+	copy[L"y"] = JSValue(21);
+	CHECK(isChanged(JSValue(object), JSValue(copy)));
+
+	JSValue::Object renamed = object;
+	renamed.erase(L"y");
+	renamed[L"z"] = JSValue(20);
+	CHECK(isChanged(JSValue(object), JSValue(renamed)));
+	JSValue::Object extra = object;
+	extra[L"w"] = JSValue();
+	CHECK(isChanged(JSValue(object), JSValue(extra)));
+
+	// a change deep inside counts
+	JSValue::Object nested = object;
+	JSValue::Array items = array;
+	items[1] = JSValue(L"three");
+	nested[L"items"] = JSValue(items);
+	CHECK(isChanged(JSValue(object), JSValue(nested)));
+}
+
+void testEqualJSValues() {
+	testScalars();
+	testNumbers();
+	testContainers();
+}
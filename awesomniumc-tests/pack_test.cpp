@@ -0,0 +1,216 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "awesomiumc.h"
+#include "awesomiumc_pack.h"
+#include "unit_tests.h"
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define PACK_PATH L"unit_test.pack"
+
+struct PackedFile {
+	const char* path;
+	const char* data;
+};
+
+static unsigned int align(unsigned int offset) {
+	return (offset + AWE_PACK_ALIGNMENT - 1) & ~(AWE_PACK_ALIGNMENT - 1);
+}
+
+// lays the files out like awesomniumc-pack does, they have to be passed sorted by path
+static std::vector<unsigned char> buildPack(const PackedFile* files, int count) {
+	unsigned int stringsStart = sizeof(ResourcePackHeaderC) + count * sizeof(ResourcePackEntryC);
+	std::vector<ResourcePackEntryC> entries(count);
+	std::string strings;
+	for(int i = 0; i < count; i++) {
+		entries[i].pathOffset = stringsStart + (unsigned int)strings.size();
+		strings += files[i].path;
+		strings += '\0';
+		entries[i].mimeTypeOffset = stringsStart + (unsigned int)strings.size();
+		strings += awe_guessMimeType(files[i].path);
+		strings += '\0';
+	}
+	unsigned int offset = align(stringsStart + (unsigned int)strings.size());
+	for(int i = 0; i < count; i++) {
+		entries[i].dataOffset = offset;
+		entries[i].dataSize = (unsigned int)strlen(files[i].data);
+		offset = align(offset + entries[i].dataSize);
+	}
+
+	std::vector<unsigned char> pack(offset, 0);
+	ResourcePackHeaderC* header = reinterpret_cast<ResourcePackHeaderC*>(&pack[0]);
+	header->magic = AWE_PACK_MAGIC;
+	header->version = AWE_PACK_VERSION;
+	header->entryCount = count;
+	header->reserved = 0;
+	if(count > 0)
+		memcpy(&pack[sizeof(ResourcePackHeaderC)], &entries[0], count * sizeof(ResourcePackEntryC));
+	memcpy(&pack[stringsStart], strings.data(), strings.size());
+	for(int i = 0; i < count; i++)
+		memcpy(&pack[entries[i].dataOffset], files[i].data, entries[i].dataSize);
+	return pack;
+}
+
+static ResourcePackHeaderC* getHeader(std::vector<unsigned char>& pack) {
+	return reinterpret_cast<ResourcePackHeaderC*>(&pack[0]);
+}
+
+static ResourcePackEntryC* getEntry(std::vector<unsigned char>& pack, int index) {
+	return reinterpret_cast<ResourcePackEntryC*>(&pack[sizeof(ResourcePackHeaderC)]) + index;
+}
+
+static ResourcePackC openPack(const std::vector<unsigned char>& pack) {
+	FILE* file = _wfopen(PACK_PATH, L"wb");
+	if(!file)
+		return 0;
+	if(!pack.empty())
+		fwrite(&pack[0], 1, pack.size(), file);
+	fclose(file);
+	return awe_ResourcePack_open(PACK_PATH, "pack://");
+}
+
+static void closePack(ResourcePackC pack) {
+	if(pack)
+		awe_ResourcePack_close(pack);
+	DeleteFileW(PACK_PATH);
+}
+
+// opening a corrupt pack fails instead of handing out a broken index
+static bool isRejected(const std::vector<unsigned char>& pack) {
+	ResourcePackC opened = openPack(pack);
+	closePack(opened);
+	return opened == 0;
+}
+
+static const PackedFile files[] = {
+	{ "css/site.css", "body { margin: 0; }" },
+	{ "empty.txt", "" },
+	{ "index.html", "<html><body>index</body></html>" },
+	{ "js/app.js", "var app = {};" },
+};
+static const int fileCount = sizeof(files) / sizeof(files[0]);
+
+static void testLookup() {
+	ResourcePackC pack = openPack(buildPack(files, fileCount));
+	CHECK(pack != 0);
+	if(!pack)
+		return;
+	CHECK(awe_ResourcePack_getEntryCount(pack) == fileCount);
+	for(int i = 0; i < fileCount; i++) {
+		const unsigned char* buffer = 0;
+		int numBytes = -1;
+		const char* mimeType = 0;
+		CHECK(awe_ResourcePack_find(pack, files[i].path, &buffer, &numBytes, &mimeType) == -1);
+		CHECK(numBytes == (int)strlen(files[i].data));
+		CHECK(buffer && memcmp(buffer, files[i].data, numBytes) == 0);
+		CHECK(((size_t)buffer & (AWE_PACK_ALIGNMENT - 1)) == 0);
+		CHECK(mimeType && strcmp(mimeType, awe_guessMimeType(files[i].path)) == 0);
+	}
+
+	const unsigned char* buffer;
+	int numBytes;
+	CHECK(awe_ResourcePack_find(pack, "index.htm", &buffer, &numBytes, 0) == 0);
+	CHECK(awe_ResourcePack_find(pack, "index.html/", &buffer, &numBytes, 0) == 0);
+	CHECK(awe_ResourcePack_find(pack, "a.html", &buffer, &numBytes, 0) == 0);
+	CHECK(awe_ResourcePack_find(pack, "z.html", &buffer, &numBytes, 0) == 0);
+	CHECK(awe_ResourcePack_find(pack, "", &buffer, &numBytes, 0) == 0);
+	closePack(pack);
+
+	pack = openPack(buildPack(files, 0));
+	CHECK(pack != 0);
+	if(pack) {
+		CHECK(awe_ResourcePack_getEntryCount(pack) == 0);
+		CHECK(awe_ResourcePack_find(pack, "index.html", &buffer, &numBytes, 0) == 0);
+	}
+	closePack(pack);
+}
+
+static void testCorruptPacks() {
+	const std::vector<unsigned char> valid = buildPack(files, fileCount);
+	unsigned int size = (unsigned int)valid.size();
+	std::vector<unsigned char> pack;
+
+	CHECK(isRejected(std::vector<unsigned char>()));
+	CHECK(isRejected(std::vector<unsigned char>(valid.begin(), valid.begin() + sizeof(ResourcePackHeaderC) - 1)));
+
+	pack = valid;
+	getHeader(pack)->magic = 0x12345678;
+	CHECK(isRejected(pack));
+
+	pack = valid;
+	getHeader(pack)->version = AWE_PACK_VERSION + 1;
+	CHECK(isRejected(pack));
+
+	// an index running past the end of the file
+	pack = valid;
+	getHeader(pack)->entryCount = size / sizeof(ResourcePackEntryC);
+	CHECK(isRejected(pack));
+	pack = valid;
+	getHeader(pack)->entryCount = 0xFFFFFFFF;
+	CHECK(isRejected(pack));
+
+	pack = valid;
+	getEntry(pack, 1)->pathOffset = size;
+	CHECK(isRejected(pack));
+
+	pack = valid;
+	getEntry(pack, 2)->mimeTypeOffset = 0xFFFFFFF0;
+	CHECK(isRejected(pack));
+
+	// a path that isn't terminated before the end of the file
+	pack = valid;
+	pack.resize(size + 4, 'x');
+	getEntry(pack, 0)->pathOffset = size;
+	CHECK(isRejected(pack));
+
+	pack = valid;
+	getEntry(pack, 3)->dataOffset = size + 1;
+	CHECK(isRejected(pack));
+
+	pack = valid;
+	getEntry(pack, 3)->dataSize = size - getEntry(pack, 3)->dataOffset + 1;
+	CHECK(isRejected(pack));
+
+	// an overflowing offset plus size must not wrap around
+	pack = valid;
+	getEntry(pack, 3)->dataSize = 0xFFFFFFFF;
+	CHECK(isRejected(pack));
+
+	// lookups are binary searches, so unsorted or duplicate paths would miss entries
+	pack = valid;
+	ResourcePackEntryC first = *getEntry(pack, 0);
+	*getEntry(pack, 0) = *getEntry(pack, 2);
+	*getEntry(pack, 2) = first;
+	CHECK(isRejected(pack));
+	pack = valid;
+	getEntry(pack, 1)->pathOffset = getEntry(pack, 0)->pathOffset;
+	CHECK(isRejected(pack));
+
+	// the untouched pack still opens after all of the above
+	CHECK(!isRejected(valid));
+}
+
+void testResourcePack() {
+	CHECK(strcmp(awe_guessMimeType("index.html"), "text/html") == 0);
+	CHECK(strcmp(awe_guessMimeType("js/APP.JS"), "application/javascript") == 0);
+	testLookup();
+	testCorruptPacks();
+}
@@ -0,0 +1,46 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/**
+ * Unit tests for the parts of the wrapper that can be checked without a
+ * page. Only the command queue test needs a WebCore. Returns the number of
+ * failed checks.
+ */
+#include "unit_tests.h"
+#include <stdio.h>
+
+static int checks = 0;
+static int failures = 0;
+
+void checkCondition(bool passed, const char* condition, const char* file, int line) {
+	checks++;
+	if(passed)
+		return;
+	failures++;
+	printf("%s(%d): check failed: %s\n", file, line, condition);
+}
+
+int main() {
+	testConvert();
+	testResourcePack();
+	testDamageTracking();
+	testEqualJSValues();
+	testUTF8();
+	testCommandQueue();
+	printf("%d checks, %d failed\n", checks, failures);
+	return failures;
+}
@@ -0,0 +1,34 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_unit_tests_h_
+#define __awesomnium_unit_tests_h_
+
+// records a failure and carries on, so one run reports every broken check
+#define CHECK(condition) checkCondition((condition), #condition, __FILE__, __LINE__)
+
+void checkCondition(bool passed, const char* condition, const char* file, int line);
+
+void testConvert();
+void testResourcePack();
+void testDamageTracking();
+void testEqualJSValues();
+void testUTF8();
+void testCommandQueue();
+
+#endif
@@ -0,0 +1,118 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "internal.h"
+#include "unit_tests.h"
+#include <string.h>
+#include <string>
+#include <vector>
+
+static std::wstring makeText(const unsigned short* units, size_t length) {
+	std::wstring text;
+	for(size_t i = 0; i < length; i++)
+		text += (wchar_t)units[i];
+	return text;
+}
+
+static bool encodesTo(const unsigned short* units, size_t length, const char* expected) {
+	std::wstring text = makeText(units, length);
+	std::vector<char> out;
+	encodeUTF8(out, text.c_str(), text.size());
+	return out.size() == strlen(expected) && memcmp(&out[0], expected, out.size()) == 0;
+}
+
+static void testEncodeUTF8() {
+	const unsigned short ascii[] = { 'a', 'Z', '0' };
+	CHECK(encodesTo(ascii, 3, "aZ0"));
+	const unsigned short twoBytes[] = { 0x80, 0xE9, 0x7FF };
+	CHECK(encodesTo(twoBytes, 3, "\xC2\x80\xC3\xA9\xDF\xBF"));
+	const unsigned short threeBytes[] = { 0x800, 0x20AC, 0xFFFF };
+	CHECK(encodesTo(threeBytes, 3, "\xE0\xA0\x80\xE2\x82\xAC\xEF\xBF\xBF"));
+	const unsigned short pairs[] = { 0xD83D, 0xDE00, 0xDBFF, 0xDFFF };
+	CHECK(encodesTo(pairs, 4, "\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF"));
+
+	// unpaired surrogates become U+FFFD, the units around them are kept
+	const unsigned short highAlone[] = { 0xD83D, 'x' };
+	CHECK(encodesTo(highAlone, 2, "\xEF\xBF\xBDx"));
+	const unsigned short lowAlone[] = { 'x', 0xDE00 };
+	CHECK(encodesTo(lowAlone, 2, "x\xEF\xBF\xBD"));
+	const unsigned short highAtEnd[] = { 'x', 0xD83D };
+	CHECK(encodesTo(highAtEnd, 2, "x\xEF\xBF\xBD"));
+	const unsigned short reversed[] = { 0xDE00, 0xD83D };
+	CHECK(encodesTo(reversed, 2, "\xEF\xBF\xBD\xEF\xBF\xBD"));
+
+	// appends to what is already there
+	std::vector<char> out(1, '>');
+	encodeUTF8(out, L"ab", 2);
+	CHECK(out.size() == 3 && out[0] == '>' && out[1] == 'a' && out[2] == 'b');
+	encodeUTF8(out, L"", 0);
+	CHECK(out.size() == 3);
+}
+
+// the chunks have to cover the text in order, give at least one unit each
+// and never end between the halves of a surrogate pair
+static void testChunks(const std::wstring& text, size_t chunkSize) {
+	std::vector<char> whole;
+	encodeUTF8(whole, text.c_str(), text.size());
+	std::vector<char> joined;
+	size_t offset = 0;
+	bool valid = true;
+	do {
+		size_t length = getChunkLength(text, offset, chunkSize);
+		valid = valid && length >= 1 && length <= chunkSize && offset + length <= text.size();
+		if(!valid)
+			break;
+		wchar_t last = text[offset + length - 1];
+		valid = !(last >= 0xD800 && last <= 0xDBFF && offset + length < text.size());
+		encodeUTF8(joined, text.c_str() + offset, length);
+		offset += length;
+	} while(offset < text.size());
+	CHECK(valid);
+	CHECK(joined == whole);
+}
+
+static void testChunkLength() {
+	std::wstring text = L"abcdef";
+	CHECK(getChunkLength(text, 0, 4) == 4);
+	CHECK(getChunkLength(text, 4, 4) == 2);
+	CHECK(getChunkLength(text, 0, 6) == 6);
+	CHECK(getChunkLength(text, 0, 64) == 6);
+
+	// a pair across the boundary moves into the next chunk
+	const unsigned short split[] = { 'a', 'b', 'c', 0xD83D, 0xDE00, 'd' };
+	text = makeText(split, 6);
+	CHECK(getChunkLength(text, 0, 4) == 3);
+	CHECK(getChunkLength(text, 3, 4) == 3);
+	CHECK(getChunkLength(text, 0, 5) == 5);
+
+	const unsigned short onlyPairs[] = { 0xD83D, 0xDE00, 0xD83D, 0xDE00, 0xD83D, 0xDE00 };
+	text = makeText(onlyPairs, 6);
+	CHECK(getChunkLength(text, 0, 2) == 2);
+	CHECK(getChunkLength(text, 0, 3) == 2);
+	CHECK(getChunkLength(text, 2, 3) == 2);
+
+	// a mix of one to four byte characters, chunked at every size
+	const unsigned short mixed[] = { 'a', 0xE9, 0xD83D, 0xDE00, 0x20AC, 'b', 0xD83D, 0xDE01, 0xD83D, 0xDE02, 'c', 0xDE00, 0xD800, 'd', 0xD83D };
+	text = makeText(mixed, sizeof(mixed) / sizeof(mixed[0]));
+	for(size_t chunkSize = 2; chunkSize <= text.size() + 1; chunkSize++)
+		testChunks(text, chunkSize);
+}
+
+void testUTF8() {
+	testEncodeUTF8();
+	testChunkLength();
+}
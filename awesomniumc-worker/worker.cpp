@@ -0,0 +1,190 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+/**
+ * Shard worker, started by awe_WebCoreShards_new with its stdin and stdout
+ * connected to the host. Runs one WebCore and the views the host creates on
+ * it, see awesomiumc_shard.h for the protocol. Has to live in the directory
+ * holding the Awesomium runtime.
+ */
+#include "awesomiumc.h"
+#include "awesomiumc_shard.h"
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <map>
+
+#define UPDATE_INTERVAL_MS 10
+
+static HANDLE commands;
+static HANDLE events;
+static WebCoreC webCore;
+static std::map<int, WebViewC> views;
+static std::map<WebViewC, int> viewIds;
+static WebViewListenerC listener;
+static bool running = true;
+
+// filled by the command reader thread
+static CRITICAL_SECTION commandLock;
+static std::vector<char> pendingCommands;
+static volatile LONG hostConnected = 1;
+static char readBuffer[64 * 1024];
+
+static void sendEvent(WebViewC webView, int type) {
+	std::map<WebViewC, int>::iterator id = viewIds.find(webView);
+	if(id == viewIds.end())
+		return;
+	if(!awe_ShardMessage_write(events, type, id->second, 0, 0, 0, 0, 0, 0))
+		running = false;
+}
+
+static void AWE_CALLBACK onFinishLoading(WebViewC webView) {
+	sendEvent(webView, AWE_SHARD_FINISH_LOADING);
+}
+
+static void AWE_CALLBACK onWebViewCrashed(WebViewC webView) {
+	sendEvent(webView, AWE_SHARD_VIEW_CRASHED);
+}
+
+// a view whose frames can't be exported is useless to the host, it is dropped and reported
+static void createView(const ShardMessageC& message, const char* payload) {
+	if(views.find(message.viewId) != views.end())
+		return;
+	WebViewC webView = awe_WebCore_createWebView(webCore, message.a, message.b);
+	if(webView && message.payloadSize > 0 && !awe_WebView_setSharedFrameExport(webView, (const wchar_t*)payload, message.c, message.d, AWE_SHARD_FRAME_SLOTS)) {
+		awe_WebView_destroy(webView);
+		webView = 0;
+	}
+	if(!webView) {
+		if(!awe_ShardMessage_write(events, AWE_SHARD_CREATE_FAILED, message.viewId, 0, 0, 0, 0, 0, 0))
+			running = false;
+		return;
+	}
+	awe_WebView_setListener(webView, &listener);
+	views[message.viewId] = webView;
+	viewIds[webView] = message.viewId;
+}
+
+static void executeCommand(const ShardMessageC& message, const char* payload) {
+	if(message.type == AWE_SHARD_SHUTDOWN) {
+		running = false;
+		return;
+	}
+	if(message.type == AWE_SHARD_CREATE_VIEW) {
+		createView(message, payload);
+		return;
+	}
+	std::map<int, WebViewC>::iterator view = views.find(message.viewId);
+	if(view == views.end())
+		return;
+	WebViewC webView = view->second;
+	switch(message.type) {
+		case AWE_SHARD_DESTROY_VIEW:
+			viewIds.erase(webView);
+			views.erase(view);
+			awe_WebView_destroy(webView);
+			break;
+		case AWE_SHARD_LOAD_URL: awe_WebView_loadURL(webView, payload, L"", "", ""); break;
+		case AWE_SHARD_LOAD_HTML: awe_WebView_loadHTML(webView, payload, L""); break;
+		case AWE_SHARD_EXECUTE_JAVASCRIPT: awe_WebView_executeJavascript(webView, payload, L""); break;
+		case AWE_SHARD_RESIZE: awe_WebView_resize(webView, message.a, message.b, 0, 0); break;
+		case AWE_SHARD_INPUT: awe_WebView_injectEvents(webView, (const InputEventC*)payload, message.payloadSize / sizeof(InputEventC)); break;
+	}
+}
+
+// reads stdin as fast as the host writes, so the host never blocks on a full
+// pipe while this process is blocked writing events the host hasn't read yet
+static DWORD WINAPI readCommandsMain(LPVOID param) {
+	DWORD read = 0;
+	while(ReadFile(commands, readBuffer, sizeof(readBuffer), &read, 0) && read > 0) {
+		EnterCriticalSection(&commandLock);
+		pendingCommands.insert(pendingCommands.end(), readBuffer, readBuffer + read);
+		LeaveCriticalSection(&commandLock);
+	}
+	// the host has gone away
+	InterlockedExchange(&hostConnected, 0);
+	return 0;
+}
+
+// executes every complete command the host has written so far
+static void receiveCommands(std::vector<char>& received) {
+	bool connected = hostConnected != 0;
+	EnterCriticalSection(&commandLock);
+	received.insert(received.end(), pendingCommands.begin(), pendingCommands.end());
+	pendingCommands.clear();
+	LeaveCriticalSection(&commandLock);
+	if(!connected)
+		running = false;
+
+	size_t position = 0;
+	while(running && received.size() - position >= sizeof(ShardMessageC)) {
+		ShardMessageC message;
+		memcpy(&message, &received[position], sizeof(ShardMessageC));
+		// nothing after a broken record can be trusted
+		if(message.payloadSize < 0) {
+			running = false;
+			break;
+		}
+		if(received.size() - position < sizeof(ShardMessageC) + message.payloadSize)
+			break;
+		executeCommand(message, message.payloadSize > 0?&received[position + sizeof(ShardMessageC)]:0);
+		position += sizeof(ShardMessageC) + message.payloadSize;
+	}
+	received.erase(received.begin(), received.begin() + position);
+}
+
+int main(int argc, char** argv) {
+	commands = GetStdHandle(STD_INPUT_HANDLE);
+	events = GetStdHandle(STD_OUTPUT_HANDLE);
+	// the pipe would stay open in Awesomium's child processes if they inherited
+	// it, and nothing else may write to it
+	SetHandleInformation(commands, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(events, HANDLE_FLAG_INHERIT, 0);
+	SetStdHandle(STD_OUTPUT_HANDLE, GetStdHandle(STD_ERROR_HANDLE));
+	freopen("NUL", "w", stdout);
+	memset(&listener, 0, sizeof(WebViewListenerC));
+	listener.onFinishLoading = onFinishLoading;
+	listener.onWebViewCrashed = onWebViewCrashed;
+
+	webCore = awe_WebCore_new();
+	if(!awe_ShardMessage_write(events, AWE_SHARD_READY, 0, AWE_SHARD_PROTOCOL_VERSION, 0, 0, 0, 0, 0))
+		running = false;
+
+	InitializeCriticalSection(&commandLock);
+	HANDLE reader = CreateThread(0, 0, readCommandsMain, 0, 0, 0);
+	if(!reader)
+		running = false;
+
+	std::vector<char> received;
+	while(running) {
+		receiveCommands(received);
+		if(!running)
+			break;
+		// renders every view with a shared frame export that changed
+		awe_WebCore_update(webCore);
+		Sleep(UPDATE_INTERVAL_MS);
+	}
+
+	for(std::map<int, WebViewC>::iterator it = views.begin(); it != views.end(); it++)
+		awe_WebView_destroy(it->second);
+	awe_WebCore_delete(webCore);
+	// the reader may still be blocked on stdin, it ends with the process
+	if(reader)
+		CloseHandle(reader);
+	return 0;
+}
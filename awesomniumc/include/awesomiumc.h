@@ -595,9 +595,59 @@
 #define AWE_LOG_NORMAL 1
 #define AWE_LOG_VERBOSE 2
 
+#define AWE_CONVERT_BGRA_TO_RGBA 1
+#define AWE_CONVERT_BGRA_TO_RGB 2
+#define AWE_CONVERT_PREMULTIPLY 3
+#define AWE_CONVERT_UNPREMULTIPLY 4
+#define AWE_CONVERT_FORCE_OPAQUE 5
+
+#define AWE_SIMD_NONE 0
+#define AWE_SIMD_SSE2 1
+#define AWE_SIMD_SSSE3 2
+// only available in builds made with Visual Studio 2013 or newer
+#define AWE_SIMD_AVX2 3
+
+#define AWE_PACKED_NULL 0
+#define AWE_PACKED_BOOLEAN 1
+#define AWE_PACKED_INTEGER 2
+#define AWE_PACKED_DOUBLE 3
+#define AWE_PACKED_STRING 4
+#define AWE_PACKED_ARRAY 5
+#define AWE_PACKED_OBJECT 6
+
+#define AWE_VISIBILITY_VISIBLE 0
+#define AWE_VISIBILITY_OCCLUDED 1
+#define AWE_VISIBILITY_HIDDEN 2
+
+#define AWE_STATS_BUCKETS 16
+
+#define AWE_INPUT_MOUSE_MOVE 1
+#define AWE_INPUT_MOUSE_DOWN 2
+#define AWE_INPUT_MOUSE_UP 3
+#define AWE_INPUT_MOUSE_WHEEL 4
+#define AWE_INPUT_KEYBOARD 5
+#define AWE_INPUT_CHARACTER 6
+
+#define AWE_THUMBNAIL_PNG 0
+#define AWE_THUMBNAIL_BMP 1
+#define AWE_THUMBNAIL_JPEG 2
+
+#define AWE_CONTENTS_UTF16 0
+#define AWE_CONTENTS_UTF8 1
+
+#define AWE_SHARD_EVENT_FINISH_LOADING 1
+#define AWE_SHARD_EVENT_CRASHED 2
+#define AWE_SHARD_EVENT_WORKER_EXITED 3
+#define AWE_SHARD_EVENT_CREATE_FAILED 4
+
 #define WebCoreC void*
 #define WebViewC void*
-#define ResourceInterceptorC void*
+#define ResourceResponseC void*
+#define ResourcePackC void*
+#define WebViewPoolC void*
+#define ThumbnailPipelineC void*
+#define WebCoreShardsC void*
+#define RemoteWebViewC void*
 #define JSArgumentsC void*
 #define JSValueC void*
 #define ObjectC void*
@@ -609,6 +659,43 @@ typedef struct {
 	int x, y, width, height;
 } RectC;
 
+/**
+ * One value of a packed argument list. Arrays and objects reference their
+ * children by record index, all children of a container are stored
+ * contiguously. Object children are key/value pairs, the key being a string
+ * record. Strings are NUL terminated UTF-16 at a byte offset from the start
+ * of the PackedArgumentsC.
+ */
+typedef struct {
+	int type;
+	int count;		// string length in characters, number of elements of an array or members of an object
+	union {
+		int boolValue;
+		int intValue;
+		double doubleValue;
+		int stringOffset;
+		int firstChild;
+	} value;
+} PackedValueC;
+
+/**
+ * Header of a packed argument list, followed by recordCount PackedValueC
+ * records and the string data. The first argumentCount records are the
+ * callback arguments.
+ */
+typedef struct {
+	int size;
+	int argumentCount;
+	int recordCount;
+	int reserved;
+} PackedArgumentsC;
+
+// awe_WebView_setObjectProperties skips values equal to the last ones set, 1 and 1.0 are equal as are two NaNs
+typedef struct {
+	const wchar_t* propName;
+	JSValueC value;
+} ObjectPropertyC;
+
 typedef struct {
 	void (AWE_CALLBACK *onBeginNavigation) (WebViewC webView, const char* url, const wchar_t* frameName);	
 	void (AWE_CALLBACK *onBeginLoading) (WebViewC webView, const char* url, const wchar_t* frameName, int statusCode, const wchar_t* mimeType);
@@ -628,6 +715,94 @@ typedef struct {
 	void (AWE_CALLBACK *onDOMReady) (WebViewC webView);
 } WebViewListenerC;
 
+typedef struct {
+	int wasCached;
+	long long requestTimeMs;
+	long long responseTimeMs;
+	long long expectedContentSize;
+	const char* mimeType;
+} ResourceResponseMetricsC;
+
+/**
+ * onRequest may be called from a thread other than the one calling
+ * awe_WebCore_update. Return 0 to let the resource cache or the network
+ * handle the request.
+ */
+typedef struct {
+	ResourceResponseC (AWE_CALLBACK *onRequest) (WebViewC webView, const char* url, const char* referrer);
+	void (AWE_CALLBACK *onResponse) (WebViewC webView, const char* url, int statusCode, const ResourceResponseMetricsC* metrics);
+} ResourceInterceptorC;
+
+typedef struct {
+	const unsigned char* buffer;
+	int width, height, rowSpan;
+	int frameNumber;
+} FrameC;
+
+/**
+ * Timings of one exported function or listener callback for one WebView,
+ * webView is 0 for calls not tied to a view. histogram[0] counts calls under
+ * 1 microsecond, histogram[i] those under 2^i microseconds and the last
+ * bucket all slower ones. Only collected when built with AWE_ENABLE_STATS.
+ */
+typedef struct {
+	const char* name;
+	WebViewC webView;
+	long long count;
+	double totalMs;
+	double maxMs;
+	long long histogram[AWE_STATS_BUCKETS];
+} StatsEntryC;
+
+// receives wrapper diagnostics up to the level passed to awe_setLogger, AWE_LOG_NORMAL or AWE_LOG_VERBOSE
+typedef void (AWE_CALLBACK *LoggerC) (int level, const char* message);
+
+/**
+ * Called from awe_ThumbnailPipeline_update, url is 0 for HTML jobs and buffer
+ * is only valid during the call. Jobs need a positive width or height, a
+ * missing one keeps the page's aspect ratio. PNG and BMP are encoded by the
+ * wrapper, JPEG through GDI+; addURL and addHTML return 0 for jobs without
+ * any dimension and for JPEG jobs when GDI+ isn't available.
+ */
+typedef void (AWE_CALLBACK *ThumbnailCallbackC) (int jobId, const char* url, int succeeded, const unsigned char* buffer, int numBytes, void* userData);
+
+// called from awe_WebCoreShards_update with one of the AWE_SHARD_EVENT_* events, must not delete the shards
+typedef void (AWE_CALLBACK *ShardEventCallbackC) (RemoteWebViewC remoteWebView, int event, void* userData);
+
+/**
+ * FutureJSValue can only be waited on, so awe_WebView_executeJavascriptAsync
+ * doesn't keep futures around. It wraps the script in an indirect eval that
+ * reports back through a window.__awesomiumc object the wrapper creates on the
+ * view, installing a listener if none is set. The callback fires from
+ * awe_WebCore_update with the result, or with succeeded = 0 and the error
+ * message as a string if the script threw. Scripts still pending when the view
+ * or the WebCore is destroyed complete with succeeded = 0 and a null result.
+ */
+typedef void (AWE_CALLBACK *JavascriptResultCallbackC) (WebViewC webView, int requestId, int succeeded, const JSValueC result, void* userData);
+
+/**
+ * While the update thread started with awe_WebCore_startUpdateThread runs,
+ * it owns the WebCore: every listener and wrapper callback fires on it and
+ * other threads may only use the awe_WebView_post* calls, awe_WebCore_postTask,
+ * awe_WebCore_createWebViewDeferred and awe_WebView_acquireLatestFrame.
+ */
+typedef void (AWE_CALLBACK *TaskCallbackC) (WebCoreC webCore, void* userData);
+
+// called once the view requested with awe_WebCore_createWebViewDeferred exists, before its URL is loaded
+typedef void (AWE_CALLBACK *DeferredWebViewCallbackC) (WebViewC webView, void* userData);
+
+// called from awe_WebCore_update once a resize requested with awe_WebView_resizeAsync has repainted
+typedef void (AWE_CALLBACK *ResizeCompleteCallbackC) (WebViewC webView, int width, int height, void* userData);
+
+// called instead of onGetPageContents when set with awe_WebView_setPageContentsChunkCallback, chunk is UTF-16 or UTF-8 as set with awe_WebView_setPageContentsChunking
+typedef void (AWE_CALLBACK *PageContentsChunkCallbackC) (WebViewC webView, const char* url, const void* chunk, int numBytes, int isLast, void* userData);
+
+// called instead of onCallback when set with awe_WebView_setPackedCallback, args are only valid during the call
+typedef void (AWE_CALLBACK *PackedCallbackC) (WebViewC webView, const wchar_t* objectName, const wchar_t* callbackName, const PackedArgumentsC* args, void* userData);
+
+// called instead of onCallback for callbacks bound with awe_WebView_bindCallback, callbackId is the id it returned
+typedef void (AWE_CALLBACK *BoundCallbackC) (WebViewC webView, int callbackId, const JSArgumentsC args, void* userData);
+
 typedef struct {
 	int 		type;
 	int 		modifiers;
@@ -639,16 +814,34 @@ typedef struct {
 	int 		isSystemKey;
 } WebKeyboardEventC;
 
+// one of the AWE_INPUT_* events for awe_WebView_injectEvents, only the fields of its type are read
+typedef struct {
+	int type;
+	int x, y;
+	int button;
+	int scrollAmount;
+	unsigned int character;
+	WebKeyboardEventC keyboardEvent;
+} InputEventC;
+
 extern "C" {	
 	extern EXPORT WebCoreC        awe_WebCore_new();
 	extern EXPORT WebCoreC        awe_WebCore_newWithPlugins(const wchar_t* pluginPath);
 	extern EXPORT WebCoreC        awe_WebCore_newFromConfig(int enablePlugins, int enableJavascript, const wchar_t* userDataPath, const wchar_t* pluginPath, const wchar_t* logPath, int logLevel, const char* userAgentOverride, const char* proxyServer, const char* proxyConfig, int saveCacheAndCookies, int maxCacheSize, int disableSameOriginPolicy, const char* customCss);
+	extern EXPORT void            awe_WebCore_setSkipPluginScan(int skip);
+	extern EXPORT int             awe_WebCore_newFromConfigDeferred(int enablePlugins, int enableJavascript, const wchar_t* userDataPath, const wchar_t* pluginPath, const wchar_t* logPath, int logLevel, const char* userAgentOverride, const char* proxyServer, const char* proxyConfig, int saveCacheAndCookies, int maxCacheSize, int disableSameOriginPolicy, const char* customCss);
+	extern EXPORT WebCoreC        awe_WebCore_runDeferred(int timeoutMS);
+	extern EXPORT int             awe_WebCore_createWebViewDeferred(int width, int height, const char* url, DeferredWebViewCallbackC callback, void* userData);
 	extern EXPORT void	          awe_WebCore_delete(WebCoreC webCore);	
 	extern EXPORT void            awe_WebCore_setBaseDirectory(WebCoreC webCore, const char* baseDirectory);
 	extern EXPORT void            awe_WebCore_setBaseDirectoryW(WebCoreC webCore, const wchar_t* baseDirectory);
 	extern EXPORT WebViewC        awe_WebCore_createWebView(WebCoreC webCore, int width, int height);
 	extern EXPORT void            awe_WebCore_setCustomResponsePage(WebCoreC webCore, int statusCode, const wchar_t* filePath);
 	extern EXPORT void            awe_WebCore_update(WebCoreC webCore);
+	extern EXPORT int             awe_WebCore_renderDirtyViews(WebCoreC webCore, int budgetMS, WebViewC* renderedViews, int maxRenderedViews);
+	extern EXPORT WebCoreC        awe_WebCore_startUpdateThread(int updatesPerSecond);
+	extern EXPORT int             awe_WebCore_isUpdateThreadRunning(WebCoreC webCore);
+	extern EXPORT void            awe_WebCore_postTask(TaskCallbackC callback, void* userData);
 	extern EXPORT const wchar_t*  awe_WebCore_getBaseDirectory(WebCoreC webCore);
 	extern EXPORT int	          awe_WebCore_arePluginsEnabled(WebCoreC webCore);
 	extern EXPORT void            awe_WebCore_clearCache(WebCoreC webCore);
@@ -660,32 +853,68 @@ extern "C" {
 	extern EXPORT void                  awe_WebView_destroy(WebViewC webView);
 	extern EXPORT void                  awe_WebView_setListener(WebViewC webView, const WebViewListenerC* webViewListener);
 	extern EXPORT WebViewListenerC*     awe_WebView_getListener(WebViewC webView);
+	extern EXPORT void                  awe_WebView_setUserData(WebViewC webView, void* userData);
+	extern EXPORT void*                 awe_WebView_getUserData(WebViewC webView);
+	extern EXPORT void                  awe_WebView_setPackedCallback(WebViewC webView, PackedCallbackC callback, void* userData);
+	extern EXPORT void                  awe_WebView_setPageContentsChunking(WebViewC webView, int chunkSize, int encoding);
+	extern EXPORT void                  awe_WebView_setPageContentsChunkCallback(WebViewC webView, PageContentsChunkCallbackC callback, void* userData);
+	extern EXPORT void                  awe_WebView_setResourceInterceptor(WebViewC webView, const ResourceInterceptorC* resourceInterceptor);
 	extern EXPORT ResourceInterceptorC* awe_WebView_getResourceInterceptor(WebViewC webView);
 	extern EXPORT void                  awe_WebView_loadURL(WebViewC webView, const char* url, const wchar_t* frameName, const char* username, const char* password);
+	extern EXPORT void                  awe_WebView_loadURL_n(WebViewC webView, const char* url, int urlLength, const wchar_t* frameName, const char* username, const char* password);
 	extern EXPORT void                  awe_WebView_loadURLW(WebViewC webView, const wchar_t* url, const wchar_t* frameName, const char* username, const char* password);
 	extern EXPORT void                  awe_WebView_loadHTML(WebViewC webView, const char* html, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_loadHTML_n(WebViewC webView, const char* html, int htmlLength, const wchar_t* frameName);
 	extern EXPORT void                  awe_WebView_loadHTMLW(WebViewC webView, const wchar_t* html, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_loadHTMLW_n(WebViewC webView, const wchar_t* html, int htmlLength, const wchar_t* frameName);
 	extern EXPORT void                  awe_WebView_loadFile(WebViewC webView, const char* file, const wchar_t* frameName);
 	extern EXPORT void                  awe_WebView_goToHistoryOffset(WebViewC webView, int offset);
 	extern EXPORT void                  awe_WebView_stop(WebViewC webView);
 	extern EXPORT void                  awe_WebView_reload(WebViewC webView);
 	extern EXPORT void                  awe_WebView_executeJavascript(WebViewC webView, const char* javascript, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_executeJavascript_n(WebViewC webView, const char* javascript, int javascriptLength, const wchar_t* frameName);
 	extern EXPORT void                  awe_WebView_executeJavascriptW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_executeJavascriptW_n(WebViewC webView, const wchar_t* javascript, int javascriptLength, const wchar_t* frameName);
 	extern EXPORT JSValueC              awe_WebView_executeJavascriptWithResult(WebViewC webView, const char* javascript, const wchar_t* frameName);
 	extern EXPORT JSValueC              awe_WebView_executeJavascriptWithResultTimeout(WebViewC webView, const char* javascript, const wchar_t* frameName, int timeoutMS);
 	extern EXPORT JSValueC              awe_WebView_executeJavascriptWithResultW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName);
 	extern EXPORT JSValueC              awe_WebView_executeJavascriptWithResultTimeoutW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName, int timeoutMS);
+	extern EXPORT int                   awe_WebView_executeJavascriptAsync(WebViewC webView, const char* javascript, const wchar_t* frameName, JavascriptResultCallbackC callback, void* userData);
+	extern EXPORT int                   awe_WebView_executeJavascriptAsyncW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName, JavascriptResultCallbackC callback, void* userData);
+	extern EXPORT int                   awe_WebView_getPendingJavascriptCount(WebViewC webView);
+	extern EXPORT void                  awe_WebView_batchJavascript(WebViewC webView, const char* javascript, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_batchJavascriptW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_batchJavascriptFunction(WebViewC webView, const wchar_t* object, const wchar_t* function, JSArgumentsC args, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_flushJavascriptBatch(WebViewC webView);
 	extern EXPORT void                  awe_WebView_callJavascriptFunction(WebViewC webView, const wchar_t* object, const wchar_t* function, JSArgumentsC args, const wchar_t* frameName);
 	extern EXPORT void                  awe_WebView_createObject(WebViewC webView, const wchar_t* objectName);
 	extern EXPORT void                  awe_WebView_destroyObject(WebViewC webView, const wchar_t* objectName);
 	extern EXPORT void                  awe_WebView_setObjectProperty(WebViewC webView, const wchar_t* objectName, const wchar_t* propName, JSValueC value);
+	extern EXPORT int                   awe_WebView_setObjectProperties(WebViewC webView, const wchar_t* objectName, const ObjectPropertyC* properties, int count);
+	extern EXPORT void                  awe_WebView_clearObjectProperties(WebViewC webView, const wchar_t* objectName);
 	extern EXPORT void                  awe_WebView_setObjectCallback(WebViewC webView, const wchar_t* objectName, const wchar_t* callbackName);
+	extern EXPORT int                   awe_WebView_bindCallback(WebViewC webView, const wchar_t* objectName, const wchar_t* callbackName, BoundCallbackC callback, void* userData);
+	extern EXPORT void                  awe_WebView_unbindCallback(WebViewC webView, int callbackId);
 	extern EXPORT int                   awe_WebView_isLoadingPage(WebViewC webView);
 	extern EXPORT int                   awe_WebView_isDirty(WebViewC webView);
 	extern EXPORT void                  awe_WebView_getDirtyBounds(WebViewC webView, RectC* rect);
 	extern EXPORT RenderBufferC         awe_WebView_render(WebViewC webView);
+	extern EXPORT RenderBufferC         awe_WebView_getRenderBuffer(WebViewC webView);
+	extern EXPORT RenderBufferC         awe_WebView_renderDirtyRegion(WebViewC webView, RectC* dirtyRect, unsigned char** dirtyPixels, int* rowSpan);
+	extern EXPORT void                  awe_WebView_setDamageTracking(WebViewC webView, int enable);
+	extern EXPORT int                   awe_WebView_getDirtyRects(WebViewC webView, RectC* rects, int maxRects);
+	extern EXPORT void                  awe_WebView_setScrollDetection(WebViewC webView, int enable);
+	extern EXPORT int                   awe_WebView_getScrollArea(WebViewC webView, int* dx, int* dy, RectC* clip);
+	extern EXPORT void                  awe_WebView_setRenderTarget(WebViewC webView, unsigned char* buffer, int width, int height, int rowSpan);
+	extern EXPORT int                   awe_WebView_setSharedFrameExport(WebViewC webView, const wchar_t* name, int maxWidth, int maxHeight, int slotCount);
+	extern EXPORT int                   awe_WebView_isRenderTargetUpdated(WebViewC webView, RectC* bounds);
+	extern EXPORT int                   awe_WebView_acquireLatestFrame(WebViewC webView, FrameC* frame);
 	extern EXPORT void                  awe_WebView_pauseRendering(WebViewC webView);
 	extern EXPORT void                  awe_WebView_resumeRendering(WebViewC webView);
+	extern EXPORT void                  awe_WebView_setVisibility(WebViewC webView, int visibility);
+	extern EXPORT int                   awe_WebView_getVisibility(WebViewC webView);
+	extern EXPORT void                  awe_WebView_setMaxFps(WebViewC webView, int maxFps);
+	extern EXPORT void                  awe_WebView_setRenderPriority(WebViewC webView, int priority);
 	extern EXPORT void                  awe_WebView_injectMouseMove(WebViewC webView, int x, int y);
 	extern EXPORT void                  awe_WebView_injectMouseDown(WebViewC webView, int mouseButton);
 	extern EXPORT void                  awe_WebView_injectMouseUp(WebViewC webView, int mouseButton);
@@ -693,7 +922,18 @@ extern "C" {
 	extern EXPORT void                  awe_WebView_injectKeyboardEvent(WebViewC webView, WebKeyboardEventC* keyboardEvent);
 	extern EXPORT void                  awe_WebView_injectKeyboardEventArgs(WebViewC webView, int type, int modifiers, int virtualKeyCode, int nativeKeyCode, char* keyIdentifier, wchar_t* text, wchar_t* unmodifiedText, int isSystemKey);
 	extern EXPORT void                  awe_WebView_injectKeyboardEventCharacter(WebViewC webView, unsigned int character);
+	extern EXPORT int                   awe_WebView_injectEvents(WebViewC webView, const InputEventC* events, int count);
 	extern EXPORT void                  awe_WebView_injectKeyboardEventWindows(WebViewC webView, int msg, WPARAM wparam, LPARAM lparam);
+	extern EXPORT void                  awe_WebView_postLoadURL(WebViewC webView, const char* url, const wchar_t* frameName, const char* username, const char* password);
+	extern EXPORT void                  awe_WebView_postLoadURLW(WebViewC webView, const wchar_t* url, const wchar_t* frameName, const char* username, const char* password);
+	extern EXPORT void                  awe_WebView_postExecuteJavascript(WebViewC webView, const char* javascript, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_postExecuteJavascriptW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName);
+	extern EXPORT void                  awe_WebView_postMouseMove(WebViewC webView, int x, int y);
+	extern EXPORT void                  awe_WebView_postMouseDown(WebViewC webView, int mouseButton);
+	extern EXPORT void                  awe_WebView_postMouseUp(WebViewC webView, int mouseButton);
+	extern EXPORT void                  awe_WebView_postMouseWheel(WebViewC webView, int scrollAmount);
+	extern EXPORT void                  awe_WebView_postKeyboardEvent(WebViewC webView, WebKeyboardEventC* keyboardEvent);
+	extern EXPORT void                  awe_WebView_postKeyboardEventWindows(WebViewC webView, int msg, WPARAM wparam, LPARAM lparam);
 	extern EXPORT void                  awe_WebView_cut(WebViewC webView);
 	extern EXPORT void                  awe_WebView_copy(WebViewC webView);
 	extern EXPORT void                  awe_WebView_paste(WebViewC webView);
@@ -702,6 +942,9 @@ extern "C" {
 	extern EXPORT void                  awe_WebView_resetZoom(WebViewC webView);
 	extern EXPORT int                   awe_WebView_resize(WebViewC webView, int width, int height, int waitForRepaint, int repaintTimeoutMS);
 	extern EXPORT int                   awe_WebView_isResizing(WebViewC webView);
+	extern EXPORT void                  awe_WebView_setResizeMode(WebViewC webView, int maxWidth, int maxHeight, int debounceMS);
+	extern EXPORT void                  awe_WebView_resizeAsync(WebViewC webView, int width, int height);
+	extern EXPORT void                  awe_WebView_setResizeCompleteCallback(WebViewC webView, ResizeCompleteCallbackC callback, void* userData);
 	extern EXPORT void                  awe_WebView_unfocus(WebViewC webView);
 	extern EXPORT void                  awe_WebView_focus(WebViewC webView);
 	extern EXPORT void                  awe_WebView_setTransparent(WebViewC webView, int isTransparent);
@@ -714,6 +957,38 @@ extern "C" {
 //	extern EXPORT void                  awe_WebView_removeHeaderRewriteRulesByDefinitionName(WebViewC webView, const char* name); 	
 
 	extern EXPORT void awe_getKeyIdentifierFromVirtualKeyCode(int keyCode, char** identifier);
+	extern EXPORT void awe_setLogger(LoggerC logger, int level);
+
+	extern EXPORT WebViewPoolC awe_WebViewPool_new(WebCoreC webCore, int width, int height, int count);
+	extern EXPORT void         awe_WebViewPool_delete(WebViewPoolC webViewPool);
+	extern EXPORT WebViewC     awe_WebViewPool_acquire(WebViewPoolC webViewPool, int width, int height);
+	extern EXPORT void         awe_WebViewPool_release(WebViewPoolC webViewPool, WebViewC webView);
+	extern EXPORT void         awe_WebViewPool_setGrowOnDemand(WebViewPoolC webViewPool, int growOnDemand);
+	extern EXPORT int          awe_WebViewPool_getIdleCount(WebViewPoolC webViewPool);
+
+	extern EXPORT ThumbnailPipelineC awe_ThumbnailPipeline_new(WebCoreC webCore, int viewWidth, int viewHeight, int concurrentViews, int workerThreads);
+	extern EXPORT void               awe_ThumbnailPipeline_delete(ThumbnailPipelineC thumbnailPipeline);
+	extern EXPORT void               awe_ThumbnailPipeline_setCallback(ThumbnailPipelineC thumbnailPipeline, ThumbnailCallbackC callback, void* userData);
+	extern EXPORT void               awe_ThumbnailPipeline_setTimeout(ThumbnailPipelineC thumbnailPipeline, int timeoutMS);
+	extern EXPORT void               awe_ThumbnailPipeline_setJPEGQuality(ThumbnailPipelineC thumbnailPipeline, int quality);
+	extern EXPORT int                awe_ThumbnailPipeline_addURL(ThumbnailPipelineC thumbnailPipeline, const char* url, int width, int height, int format);
+	extern EXPORT int                awe_ThumbnailPipeline_addHTML(ThumbnailPipelineC thumbnailPipeline, const char* html, int width, int height, int format);
+	extern EXPORT int                awe_ThumbnailPipeline_update(ThumbnailPipelineC thumbnailPipeline);
+
+	extern EXPORT WebCoreShardsC awe_WebCoreShards_new(const wchar_t* workerPath, int workerCount);
+	extern EXPORT void           awe_WebCoreShards_delete(WebCoreShardsC webCoreShards);
+	extern EXPORT void           awe_WebCoreShards_setCallback(WebCoreShardsC webCoreShards, ShardEventCallbackC callback, void* userData);
+	extern EXPORT int            awe_WebCoreShards_getWorkerCount(WebCoreShardsC webCoreShards);
+	extern EXPORT void           awe_WebCoreShards_update(WebCoreShardsC webCoreShards);
+	extern EXPORT RemoteWebViewC awe_WebCoreShards_createWebView(WebCoreShardsC webCoreShards, int width, int height, int maxWidth, int maxHeight);
+	extern EXPORT void           awe_RemoteWebView_destroy(RemoteWebViewC remoteWebView);
+	extern EXPORT int            awe_RemoteWebView_getWorker(RemoteWebViewC remoteWebView);
+	extern EXPORT void           awe_RemoteWebView_loadURL(RemoteWebViewC remoteWebView, const char* url);
+	extern EXPORT void           awe_RemoteWebView_loadHTML(RemoteWebViewC remoteWebView, const char* html);
+	extern EXPORT void           awe_RemoteWebView_executeJavascript(RemoteWebViewC remoteWebView, const char* javascript);
+	extern EXPORT void           awe_RemoteWebView_resize(RemoteWebViewC remoteWebView, int width, int height);
+	extern EXPORT void           awe_RemoteWebView_injectEvents(RemoteWebViewC remoteWebView, const InputEventC* events, int count);
+	extern EXPORT int            awe_RemoteWebView_copyFrame(RemoteWebViewC remoteWebView, unsigned char* destBuffer, int destRowSpan, int* width, int* height, RectC* dirty);
 
 	extern EXPORT RenderBufferC awe_RenderBuffer_new(int width, int height);
 	extern EXPORT RenderBufferC awe_RenderBuffer_newFromBuffer(unsigned char* buffer, int width, int height, int rowSpan, int autoDeleteBuffer);
@@ -731,6 +1006,40 @@ extern "C" {
 	extern EXPORT int           awe_RenderBuffer_height(RenderBufferC renderBuffer);
 	extern EXPORT int           awe_RenderBuffer_rowSpan(RenderBufferC renderBuffer);
 	extern EXPORT int           awe_RenderBuffer_ownsBuffer(RenderBufferC renderBuffer);
+	extern EXPORT void          awe_RenderBuffer_convertArea(RenderBufferC renderBuffer, int x, int y, int width, int height, unsigned char* destBuffer, int destRowSpan, int conversion);
+
+	extern EXPORT void awe_convertPixels(const unsigned char* src, int srcRowSpan, unsigned char* destBuffer, int destRowSpan, int width, int height, int conversion);
+	extern EXPORT int  awe_getSIMDLevel();
+	extern EXPORT void awe_setSIMDLevel(int level);
+
+	extern EXPORT ResourceResponseC awe_ResourceResponse_create(int numBytes, unsigned char* buffer, const char* mimeType);
+	extern EXPORT ResourceResponseC awe_ResourceResponse_createFromFile(const wchar_t* filePath);
+
+	extern EXPORT ResourcePackC     awe_ResourcePack_open(const wchar_t* filePath, const char* urlPrefix);
+	extern EXPORT void              awe_ResourcePack_close(ResourcePackC resourcePack);
+	extern EXPORT int               awe_ResourcePack_getEntryCount(ResourcePackC resourcePack);
+	extern EXPORT int               awe_ResourcePack_find(ResourcePackC resourcePack, const char* path, const unsigned char** buffer, int* numBytes, const char** mimeType);
+	extern EXPORT ResourceResponseC awe_ResourcePack_createResponse(const char* url);
+
+	extern EXPORT void awe_ResourceCache_setCapacity(int maxBytes);
+	extern EXPORT int  awe_ResourceCache_getCapacity();
+	extern EXPORT int  awe_ResourceCache_getSize();
+	extern EXPORT void awe_ResourceCache_setCacheFiles(int enable);
+	extern EXPORT void awe_ResourceCache_put(const char* url, const unsigned char* buffer, int numBytes, const char* mimeType);
+	extern EXPORT void awe_ResourceCache_remove(const char* url);
+	extern EXPORT void awe_ResourceCache_clear();
+
+	extern EXPORT int  awe_Stats_isEnabled();
+	extern EXPORT int  awe_Stats_snapshot(StatsEntryC* entries, int maxEntries);
+	extern EXPORT void awe_Stats_reset();
+
+	extern EXPORT int  awe_Trace_start(const wchar_t* filePath);
+	extern EXPORT void awe_Trace_stop();
+	extern EXPORT int  awe_Trace_isRecording();
+
+	extern EXPORT void     awe_JSArena_begin();
+	extern EXPORT void     awe_JSArena_end();
+	extern EXPORT void     awe_JSArena_release();
 
 	extern EXPORT JSValueC awe_JSValue_newNull();
 	extern EXPORT JSValueC awe_JSValue_newBool(int value);
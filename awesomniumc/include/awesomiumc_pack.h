@@ -0,0 +1,54 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_pack_h_
+#define __awesomnium_pack_h_
+
+/**
+ * Resource pack layout, all values little endian:
+ *
+ *   ResourcePackHeaderC
+ *   ResourcePackEntryC[entryCount], sorted by path (byte wise strcmp order)
+ *   NUL terminated UTF-8 paths and mime types
+ *   file contents, each starting at a multiple of AWE_PACK_ALIGNMENT
+ *
+ * Paths are relative to the packed directory and use forward slashes.
+ * All offsets are relative to the start of the pack.
+ */
+#define AWE_PACK_MAGIC 0x50455741
+#define AWE_PACK_VERSION 1
+#define AWE_PACK_ALIGNMENT 16
+
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int entryCount;
+	unsigned int reserved;
+} ResourcePackHeaderC;
+
+typedef struct {
+	unsigned int pathOffset;
+	unsigned int mimeTypeOffset;
+	unsigned int dataOffset;
+	unsigned int dataSize;
+} ResourcePackEntryC;
+
+// shared by the resource cache and the packer, defined in mimetype.cpp
+const char* awe_guessMimeType(const char* path);
+
+#endif
@@ -0,0 +1,102 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_shard_h_
+#define __awesomnium_shard_h_
+#include <windows.h>
+
+/**
+ * Pipe protocol between awe_WebCoreShards and awesomniumc-worker. Each
+ * worker process runs its own WebCore (and with it its own Awesomium child
+ * processes), reads ShardMessageC records from stdin and writes them to
+ * stdout. A record is followed by payloadSize bytes of payload.
+ *
+ * Writes block while the pipe is full. The worker drains stdin on a thread of
+ * its own, so the host never waits on a worker that is itself blocked writing
+ * events the host only reads in awe_WebCoreShards_update. A worker whose
+ * AWE_SHARD_READY carries another protocol version, or that sends a record
+ * with a negative payloadSize, is treated as exited.
+ *
+ * Frames don't go through the pipe, every view is exported to the shared
+ * memory ring named in its AWE_SHARD_CREATE_VIEW payload (see
+ * awesomiumc_shm.h).
+ */
+#define AWE_SHARD_PROTOCOL_VERSION 2
+
+// host to worker
+#define AWE_SHARD_CREATE_VIEW 1         // a, b: size, c, d: maximum size, payload: UTF-16 mapping name
+#define AWE_SHARD_DESTROY_VIEW 2
+#define AWE_SHARD_LOAD_URL 3            // payload: UTF-8 url
+#define AWE_SHARD_LOAD_HTML 4           // payload: UTF-8 html
+#define AWE_SHARD_EXECUTE_JAVASCRIPT 5  // payload: UTF-8 script
+#define AWE_SHARD_RESIZE 6              // a, b: size
+#define AWE_SHARD_INPUT 7               // payload: InputEventC[]
+#define AWE_SHARD_SHUTDOWN 8
+
+// worker to host
+#define AWE_SHARD_READY 64              // a: protocol version
+#define AWE_SHARD_FINISH_LOADING 65
+#define AWE_SHARD_VIEW_CRASHED 66
+#define AWE_SHARD_CREATE_FAILED 67      // the view or its frame export could not be created
+
+#define AWE_SHARD_FRAME_SLOTS 3
+
+typedef struct {
+	int type;
+	int viewId;
+	int a, b, c, d;
+	int payloadSize;
+	int reserved;
+} ShardMessageC;
+
+// blocks until the whole record is written, returns 0 once the other side has gone away
+static int awe_ShardMessage_write(HANDLE pipe, int type, int viewId, int a, int b, int c, int d, const void* payload, int payloadSize) {
+	ShardMessageC message;
+	const char* data = (const char*)&message;
+	DWORD size = sizeof(ShardMessageC);
+	DWORD written;
+	int part;
+	message.type = type;
+	message.viewId = viewId;
+	message.a = a;
+	message.b = b;
+	message.c = c;
+	message.d = d;
+	message.payloadSize = payload?payloadSize:0;
+	message.reserved = 0;
+	for(part = 0; part < 2; part++) {
+		while(size > 0) {
+			if(!WriteFile(pipe, data, size, &written, 0))
+				return 0;
+			data += written;
+			size -= written;
+		}
+		data = (const char*)payload;
+		size = message.payloadSize;
+	}
+	return -1;
+}
+
+// shard mapping names are unique per host process, awe_WebCoreShards instance and view,
+// the worker refuses to export into a mapping that already exists
+static void awe_ShardMessage_mappingName(wchar_t* buffer, int bufferSize, DWORD hostProcessId, int shardsId, int viewId) {
+	_snwprintf(buffer, bufferSize - 1, L"Local\\awesomiumc-%lu-%d-%d", hostProcessId, shardsId, viewId);
+	buffer[bufferSize - 1] = 0;
+}
+
+#endif
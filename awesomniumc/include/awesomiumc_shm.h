@@ -0,0 +1,154 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_shm_h_
+#define __awesomnium_shm_h_
+#include <windows.h>
+
+/**
+ * Shared memory frame ring written by awe_WebView_setSharedFrameExport, laid
+ * out as
+ *
+ *   SharedFramesHeaderC
+ *   SharedFrameSlotC[slotCount]
+ *   slotCount pixel areas of slotSize bytes, BGRA, starting at dataOffset
+ *
+ * Each slot is a seqlock: its sequence is odd while the wrapper writes it and
+ * twice the frame number once complete. The header's latestSlot always
+ * names the last completed slot. The dirty rect of a slot is the area that
+ * changed since the previous frame, a consumer that skipped frames (the
+ * sequence grew by more than 2) has to treat the whole frame as changed.
+ * Frames are exported whenever the WebView is rendered, starting with the
+ * next render after the export is set up.
+ *
+ * This header is all a consumer process needs, it doesn't link against the
+ * wrapper. Frames are read in place. Once done with one, call
+ * awe_SharedFrames_validate, if it returns 0 the slot was reused while the
+ * frame was being read and it should be dropped.
+ */
+#define AWE_SHM_MAGIC 0x4D485341
+#define AWE_SHM_VERSION 1
+#define AWE_SHM_ALIGNMENT 64
+
+typedef struct {
+	unsigned int magic;
+	unsigned int version;
+	unsigned int slotCount;
+	unsigned int maxWidth;
+	unsigned int maxHeight;
+	unsigned int slotSize;
+	unsigned int dataOffset;
+	volatile LONG latestSlot;
+} SharedFramesHeaderC;
+
+typedef struct {
+	volatile LONG sequence;
+	unsigned int width;
+	unsigned int height;
+	unsigned int rowSpan;
+	int dirtyX, dirtyY, dirtyWidth, dirtyHeight;
+} SharedFrameSlotC;
+
+typedef struct {
+	HANDLE mapping;
+	unsigned char* base;
+	const SharedFramesHeaderC* header;
+	const SharedFrameSlotC* slots;
+} SharedFramesReaderC;
+
+typedef struct {
+	const unsigned char* buffer;
+	int width, height, rowSpan;
+	int sequence;
+	int slot;
+	int dirtyX, dirtyY, dirtyWidth, dirtyHeight;
+} SharedFrameC;
+
+static size_t awe_SharedFrames_getSize(unsigned int slotCount, unsigned int maxWidth, unsigned int maxHeight) {
+	size_t slots = sizeof(SharedFramesHeaderC) + sizeof(SharedFrameSlotC) * slotCount;
+	size_t dataOffset = (slots + AWE_SHM_ALIGNMENT - 1) & ~(size_t)(AWE_SHM_ALIGNMENT - 1);
+	size_t slotSize = ((size_t)maxWidth * maxHeight * 4 + AWE_SHM_ALIGNMENT - 1) & ~(size_t)(AWE_SHM_ALIGNMENT - 1);
+	return dataOffset + slotSize * slotCount;
+}
+
+static int awe_SharedFrames_open(SharedFramesReaderC* reader, const wchar_t* name) {
+	memset(reader, 0, sizeof(SharedFramesReaderC));
+	reader->mapping = OpenFileMappingW(FILE_MAP_READ, FALSE, name);
+	if(!reader->mapping)
+		return 0;
+	reader->base = (unsigned char*)MapViewOfFile(reader->mapping, FILE_MAP_READ, 0, 0, 0);
+	reader->header = (const SharedFramesHeaderC*)reader->base;
+	if(!reader->base || reader->header->magic != AWE_SHM_MAGIC || reader->header->version != AWE_SHM_VERSION) {
+		if(reader->base)
+			UnmapViewOfFile(reader->base);
+		CloseHandle(reader->mapping);
+		memset(reader, 0, sizeof(SharedFramesReaderC));
+		return 0;
+	}
+	reader->slots = (const SharedFrameSlotC*)(reader->base + sizeof(SharedFramesHeaderC));
+	return -1;
+}
+
+static void awe_SharedFrames_close(SharedFramesReaderC* reader) {
+	if(reader->base)
+		UnmapViewOfFile(reader->base);
+	if(reader->mapping)
+		CloseHandle(reader->mapping);
+	memset(reader, 0, sizeof(SharedFramesReaderC));
+}
+
+// the view is mapped read only, so the sequence is read with a plain load
+// between barriers instead of an interlocked operation, which would write
+static LONG awe_SharedFrames_readSequence(const SharedFrameSlotC* info) {
+	MemoryBarrier();
+	LONG sequence = info->sequence;
+	MemoryBarrier();
+	return sequence;
+}
+
+// fills in the latest complete frame, returns -1 if it is newer than the one frame held before, zero frame before the first call
+static int awe_SharedFrames_acquireLatest(SharedFramesReaderC* reader, SharedFrameC* frame) {
+	LONG slot = reader->header->latestSlot;
+	if(slot < 0 || (unsigned int)slot >= reader->header->slotCount)
+		return 0;
+	const SharedFrameSlotC* info = &reader->slots[slot];
+	LONG sequence = awe_SharedFrames_readSequence(info);
+	if((sequence & 1) || sequence == frame->sequence)
+		return 0;
+	frame->buffer = reader->base + reader->header->dataOffset + (size_t)slot * reader->header->slotSize;
+	frame->width = info->width;
+	frame->height = info->height;
+	frame->rowSpan = info->rowSpan;
+	frame->dirtyX = info->dirtyX;
+	frame->dirtyY = info->dirtyY;
+	frame->dirtyWidth = info->dirtyWidth;
+	frame->dirtyHeight = info->dirtyHeight;
+	frame->slot = slot;
+	// the metadata above is only consistent if the slot wasn't reused meanwhile
+	if(awe_SharedFrames_readSequence(info) != sequence)
+		return 0;
+	frame->sequence = sequence;
+	return -1;
+}
+
+static int awe_SharedFrames_validate(SharedFramesReaderC* reader, const SharedFrameC* frame) {
+	const SharedFrameSlotC* info = &reader->slots[frame->slot];
+	return awe_SharedFrames_readSequence(info) == frame->sequence?-1:0;
+}
+
+#endif
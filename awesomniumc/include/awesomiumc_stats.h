@@ -0,0 +1,59 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_stats_h_
+#define __awesomnium_stats_h_
+
+/**
+ * Wrapper side latency instrumentation, compiled in when AWE_ENABLE_STATS is
+ * defined for the awesomniumc project. Without it AWE_STATS_SCOPE expands to
+ * nothing and awe_Stats_snapshot reports no entries.
+ *
+ * AWE_STATS_SCOPE(name, webView) times the rest of the enclosing block and
+ * adds it to the entry for name and webView. name must be a string literal,
+ * entries are keyed by its address.
+ */
+#ifdef AWE_ENABLE_STATS
+void awe_recordStat(const char* name, void* webView, LONGLONG ticks);
+
+class StatsScope {
+public:
+	StatsScope(const char* name, void* webView) {
+		this->name = name;
+		this->webView = webView;
+		QueryPerformanceCounter(&start);
+	}
+
+	~StatsScope() {
+		LARGE_INTEGER end;
+		QueryPerformanceCounter(&end);
+		awe_recordStat(name, webView, end.QuadPart - start.QuadPart);
+	}
+
+private:
+	const char* name;
+	void* webView;
+	LARGE_INTEGER start;
+};
+
+#define AWE_STATS_SCOPE(name, webView) StatsScope statsScope(name, webView)
+#else
+#define AWE_STATS_SCOPE(name, webView)
+#endif
+
+#endif
@@ -0,0 +1,82 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_trace_h_
+#define __awesomnium_trace_h_
+
+/**
+ * Trace format written by awe_Trace_start and read by awesomniumc-replay. A
+ * TraceHeaderC is followed by TraceRecordC records, each followed by
+ * payloadSize bytes of payload. delta is the time since the previous record
+ * in microseconds, viewId numbers the WebViews of the trace starting at 1.
+ *
+ * Load and script records carry the text in the first a bytes of the payload
+ * and the frame name as UTF-16 in the rest. Usernames and passwords passed to
+ * loadURL are not recorded. Posted calls are recorded when they execute.
+ */
+#define AWE_TRACE_MAGIC 0x52544541       // "AETR"
+#define AWE_TRACE_VERSION 1
+
+#define AWE_TRACE_CREATE_VIEW 1          // a, b: size, 0 if unknown for views created before recording started
+#define AWE_TRACE_DESTROY_VIEW 2
+#define AWE_TRACE_LOAD_URL 3             // payload: UTF-8 url, frame name
+#define AWE_TRACE_LOAD_URL_W 4           // payload: UTF-16 url, frame name
+#define AWE_TRACE_LOAD_HTML 5            // payload: UTF-8 html, frame name
+#define AWE_TRACE_LOAD_HTML_W 6          // payload: UTF-16 html, frame name
+#define AWE_TRACE_EXECUTE_JAVASCRIPT 7   // payload: UTF-8 script, frame name
+#define AWE_TRACE_EXECUTE_JAVASCRIPT_W 8 // payload: UTF-16 script, frame name
+#define AWE_TRACE_RESIZE 9               // a, b: size
+#define AWE_TRACE_MOUSE_MOVE 10          // a, b: position
+#define AWE_TRACE_MOUSE_DOWN 11          // a: button
+#define AWE_TRACE_MOUSE_UP 12            // a: button
+#define AWE_TRACE_MOUSE_WHEEL 13         // a: scroll amount
+#define AWE_TRACE_KEYBOARD 14            // payload: WebKeyboardEventC
+#define AWE_TRACE_KEYBOARD_WINDOWS 15    // a: msg, b: wparam, payload: LPARAM
+#define AWE_TRACE_CHARACTER 16           // a: character
+#define AWE_TRACE_INPUT 17               // a: count, payload: InputEventC[]
+#define AWE_TRACE_CREATE_OBJECT 18       // payload: UTF-16 object name
+#define AWE_TRACE_SET_OBJECT_CALLBACK 19 // payload: UTF-16 object name, 0, callback name
+#define AWE_TRACE_UPDATE 20              // one awe_WebCore_update, viewId is 0
+#define AWE_TRACE_CALLBACK 21            // a: argument count, payload: UTF-16 object name, 0, callback name
+#define AWE_TRACE_LOAD_FILE 22           // payload: UTF-8 file, frame name
+#define AWE_TRACE_GO_TO_HISTORY_OFFSET 23 // a: offset
+#define AWE_TRACE_STOP 24
+#define AWE_TRACE_RELOAD 25
+#define AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT 26   // b: timeout in ms, -1 for none, payload: UTF-8 script, frame name
+#define AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT_W 27 // b: timeout in ms, -1 for none, payload: UTF-16 script, frame name
+#define AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC 28    // payload: UTF-8 script, frame name
+#define AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC_W 29  // payload: UTF-16 script, frame name
+#define AWE_TRACE_CALL_JAVASCRIPT_FUNCTION 30    // payload: UTF-16 call written as a script, frame name
+#define AWE_TRACE_BATCH_JAVASCRIPT 31    // payload: UTF-16 statement, frame name
+#define AWE_TRACE_FLUSH_BATCH 32
+
+typedef struct {
+	unsigned int magic;
+	int version;
+	int reserved[2];
+} TraceHeaderC;
+
+typedef struct {
+	unsigned short type;
+	unsigned short viewId;
+	unsigned int delta;
+	int a, b;
+	unsigned int payloadSize;
+} TraceRecordC;
+
+#endif
@@ -17,15 +17,215 @@
 **/
 #define EXPORTS
 #include "awesomiumc.h"
+#include "awesomiumc_pack.h"
+#include "awesomiumc_stats.h"
+#include "awesomiumc_shm.h"
+#include "awesomiumc_trace.h"
+#include "internal.h"
 #include "WebCore.h"
 #include <iostream>
+#include <cstdio>
+#include <cstdarg>
+#include <cfloat>
 #include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include <set>
+#include <algorithm>
+#include <new>
 
 using namespace Awesomium;
 
+#define AWE_WRAPPER_OBJECT L"__awesomiumc"
+
+static bool handleWrapperCallback(WebView* caller, const std::wstring& callbackName, const JSArguments& args);
+static bool dispatchBoundCallback(WebView* caller, const std::wstring& objectName, const std::wstring& callbackName, const JSArguments& args);
+static bool deliverPageContents(WebView* caller, const std::string& url, const std::wstring& contents);
+static void recordTrace(int type, WebView* webView, int a, int b);
+template <class C>
+static void traceText(int type, WebView* webView, const C* text, size_t length, const wchar_t* frameName, int b = 0);
+static void traceCallback(WebView* caller, const std::wstring& objectName, const std::wstring& callbackName, int argumentCount);
+
+/*-----------------------------------------------------------------------------
+  Logging and argument strings. Diagnostics go to the logger set with
+  awe_setLogger and are not formatted unless its level asks for them.
+
+  The Awesomium API takes std::string references, arguments are assigned to
+  scratch strings that keep their capacity between calls, and frame, object
+  and callback names are interned so the common ones are never copied again.
+  Like the rest of the API this must only be used from the thread that owns
+  the WebCore. Posted commands carry their own copies and don't use them.
+-----------------------------------------------------------------------------*/
+#define AWE_SCRATCH_STRINGS 4
+#define AWE_MAX_INTERNED_NAMES 1024
+
+static LoggerC logger = 0;
+static int logLevel = AWE_LOG_NONE;
+
+static void logMessage(int level, const char* format, ...) {
+	if(!logger || level > logLevel)
+		return;
+	char message[512];
+	va_list args;
+	va_start(args, format);
+	_vsnprintf(message, sizeof(message) - 1, format, args);
+	va_end(args);
+	message[sizeof(message) - 1] = 0;
+	logger(level, message);
+}
+
+static std::string scratchStrings[AWE_SCRATCH_STRINGS];
+static std::wstring scratchWideStrings[AWE_SCRATCH_STRINGS];
+
+static const std::string& toString(int slot, const char* str, size_t length) {
+	return scratchStrings[slot].assign(str, length);
+}
+
+static const std::string& toString(int slot, const char* str) {
+	return toString(slot, str, strlen(str));
+}
+
+static const std::wstring& toString(int slot, const wchar_t* str, size_t length) {
+	return scratchWideStrings[slot].assign(str, length);
+}
+
+static const std::wstring& toString(int slot, const wchar_t* str) {
+	return toString(slot, str, wcslen(str));
+}
+
+static std::multimap<unsigned int, std::wstring> internedNames;
+static std::wstring overflowNames[AWE_SCRATCH_STRINGS];
+static int nextOverflowName = 0;
+
+// falls back to the scratch strings once the table is full, a call never needs more than AWE_SCRATCH_STRINGS names
+static const std::wstring& internName(const wchar_t* name) {
+	unsigned int hash = 2166136261u;
+	size_t length = 0;
+	for(; name[length]; length++)
+		hash = (hash ^ (unsigned int)name[length]) * 16777619u;
+	typedef std::multimap<unsigned int, std::wstring>::iterator Iterator;
+	std::pair<Iterator, Iterator> range = internedNames.equal_range(hash);
+	for(Iterator it = range.first; it != range.second; it++) {
+		if(it->second.size() == length && wmemcmp(it->second.c_str(), name, length) == 0)
+			return it->second;
+	}
+	if(internedNames.size() >= AWE_MAX_INTERNED_NAMES) {
+		nextOverflowName = (nextOverflowName + 1) % AWE_SCRATCH_STRINGS;
+		return overflowNames[nextOverflowName].assign(name, length);
+	}
+	return internedNames.insert(std::make_pair(hash, std::wstring(name, length)))->second;
+}
+
+struct PackSource {
+	const JSValue* value;
+	const std::wstring* key;
+};
+
+// flattens callback arguments into a PackedArgumentsC, the scratch vectors are kept between calls
+class ArgumentPacker {
+	std::vector<PackSource> sources;
+	std::vector<PackedValueC> records;
+	std::vector<wchar_t> strings;
+	std::vector<char> buffer;
+
+	int packString(const std::wstring& str) {
+		int offset = (int)(strings.size() * sizeof(wchar_t));
+		strings.insert(strings.end(), str.begin(), str.end());
+		strings.push_back(0);
+		return offset;
+	}
+
+public:
+	// breadth first, string offsets are fixed up once the record count is known
+	const PackedArgumentsC* pack(const JSArguments& args) {
+		sources.clear();
+		records.clear();
+		strings.clear();
+		for(size_t i = 0; i < args.size(); i++) {
+			PackSource source = { &args[i], 0 };
+			sources.push_back(source);
+		}
+
+		for(size_t i = 0; i < sources.size(); i++) {
+			PackedValueC record;
+			memset(&record, 0, sizeof(PackedValueC));
+			const JSValue* value = sources[i].value;
+			if(sources[i].key) {
+				record.type = AWE_PACKED_STRING;
+				record.count = (int)sources[i].key->size();
+				record.value.stringOffset = packString(*sources[i].key);
+			}
+			else if(value->isBoolean()) {
+				record.type = AWE_PACKED_BOOLEAN;
+				record.value.boolValue = value->toBoolean()?-1:0;
+			}
+			else if(value->isInteger()) {
+				record.type = AWE_PACKED_INTEGER;
+				record.value.intValue = value->toInteger();
+			}
+			else if(value->isDouble()) {
+				record.type = AWE_PACKED_DOUBLE;
+				record.value.doubleValue = value->toDouble();
+			}
+			else if(value->isString()) {
+				record.type = AWE_PACKED_STRING;
+				record.count = (int)value->toString().size();
+				record.value.stringOffset = packString(value->toString());
+			}
+			else if(value->isArray()) {
+				const JSValue::Array& array = value->getArray();
+				record.type = AWE_PACKED_ARRAY;
+				record.count = (int)array.size();
+				record.value.firstChild = (int)sources.size();
+				for(size_t j = 0; j < array.size(); j++) {
+					PackSource source = { &array[j], 0 };
+					sources.push_back(source);
+				}
+			}
+			else if(value->isObject()) {
+				const JSValue::Object& object = value->getObject();
+				record.type = AWE_PACKED_OBJECT;
+				record.count = (int)object.size();
+				record.value.firstChild = (int)sources.size();
+				for(JSValue::Object::const_iterator it = object.begin(); it != object.end(); it++) {
+					PackSource key = { 0, &it->first };
+					PackSource member = { &it->second, 0 };
+					sources.push_back(key);
+					sources.push_back(member);
+				}
+			}
+			else
+				record.type = AWE_PACKED_NULL;
+			records.push_back(record);
+		}
+
+		int stringsStart = (int)(sizeof(PackedArgumentsC) + records.size() * sizeof(PackedValueC));
+		int size = stringsStart + (int)(strings.size() * sizeof(wchar_t));
+		buffer.resize(size);
+		PackedArgumentsC* header = reinterpret_cast<PackedArgumentsC*>(&buffer[0]);
+		header->size = size;
+		header->argumentCount = (int)args.size();
+		header->recordCount = (int)records.size();
+		header->reserved = 0;
+		PackedValueC* packed = reinterpret_cast<PackedValueC*>(header + 1);
+		for(size_t i = 0; i < records.size(); i++) {
+			packed[i] = records[i];
+			if(packed[i].type == AWE_PACKED_STRING)
+				packed[i].value.stringOffset += stringsStart;
+		}
+		if(!strings.empty())
+			memcpy(&buffer[stringsStart], &strings[0], strings.size() * sizeof(wchar_t));
+		return header;
+	}
+};
+
+static bool dispatchPackedCallback(WebView* caller, const std::wstring& objectName, const std::wstring& callbackName, ArgumentPacker& packer, const JSArguments& args);
+
 class WebViewListenerImpl: public WebViewListener {
 protected:
 	const WebViewListenerC* funcs;
+	ArgumentPacker packer;
 public:
 
 	WebViewListenerImpl(const WebViewListenerC* funcs) {
@@ -39,10 +239,15 @@ public:
 		return funcs;
 	}
 
+	void setFuncs(const WebViewListenerC* funcs) {
+		this->funcs = funcs;
+	}
+
 	void onBeginNavigation(Awesomium::WebView* caller, 
 						   const std::string& url, 
 						   const std::wstring& frameName) {
-		if(funcs->onBeginNavigation)
+		AWE_STATS_SCOPE("WebViewListenerC.onBeginNavigation", caller);
+		if(funcs && funcs->onBeginNavigation)
 			funcs->onBeginNavigation(caller, url.c_str(), frameName.c_str());
 	}
 	
@@ -51,12 +256,14 @@ public:
 						const std::wstring& frameName, 
 						int statusCode, 
 						const std::wstring& mimeType) {
-		if(funcs->onBeginLoading)
+		AWE_STATS_SCOPE("WebViewListenerC.onBeginLoading", caller);
+		if(funcs && funcs->onBeginLoading)
 			funcs->onBeginLoading(caller, url.c_str(), frameName.c_str(), statusCode, mimeType.c_str());
 	}
 	
 	void onFinishLoading(Awesomium::WebView* caller) {
-		if(funcs->onFinishLoading)
+		AWE_STATS_SCOPE("WebViewListenerC.onFinishLoading", caller);
+		if(funcs && funcs->onFinishLoading)
 			funcs->onFinishLoading(caller);
 	}
 	
@@ -64,84 +271,1543 @@ public:
 					const std::wstring& objectName, 
 					const std::wstring& callbackName, 
 					const Awesomium::JSArguments& args) {		
-		if(funcs->onCallback)
+		AWE_STATS_SCOPE("WebViewListenerC.onCallback", caller);
+		if(objectName == AWE_WRAPPER_OBJECT && handleWrapperCallback(caller, callbackName, args))
+			return;
+		traceCallback(caller, objectName, callbackName, (int)args.size());
+		if(dispatchBoundCallback(caller, objectName, callbackName, args))
+			return;
+		if(dispatchPackedCallback(caller, objectName, callbackName, packer, args))
+			return;
+		if(funcs && funcs->onCallback)
 			funcs->onCallback(caller, objectName.c_str(), callbackName.c_str(), &args);
 	}
 	
 	void onReceiveTitle(Awesomium::WebView* caller, 
 						const std::wstring& title,
 						const std::wstring& frameName) {
-		if(funcs->onReceiveTitle)
+		AWE_STATS_SCOPE("WebViewListenerC.onReceiveTitle", caller);
+		if(funcs && funcs->onReceiveTitle)
 			funcs->onReceiveTitle(caller, title.c_str(), frameName.c_str());
 	}
 	
 	void onChangeTooltip(Awesomium::WebView* caller, 
 		const std::wstring& tooltip) {
-		if(funcs->onChangeTooltip)
+		AWE_STATS_SCOPE("WebViewListenerC.onChangeTooltip", caller);
+		if(funcs && funcs->onChangeTooltip)
 			funcs->onChangeTooltip(caller, tooltip.c_str());
 	}
 	
 	void onChangeCursor(Awesomium::WebView* caller, 
 		Awesomium::CursorType cursor) {
-		if(funcs->onChangeCursor)
+		AWE_STATS_SCOPE("WebViewListenerC.onChangeCursor", caller);
+		if(funcs && funcs->onChangeCursor)
 			funcs->onChangeCursor(caller, cursor);
 	}
 	
 	void onChangeKeyboardFocus(Awesomium::WebView* caller, 
 		bool isFocused) {
-		if(funcs->onChangeKeyboardFocus)
+		AWE_STATS_SCOPE("WebViewListenerC.onChangeKeyboardFocus", caller);
+		if(funcs && funcs->onChangeKeyboardFocus)
 			funcs->onChangeKeyboardFocus(caller, isFocused?-1:0);
 	}
 	
 	void onChangeTargetURL(Awesomium::WebView* caller, 
 		const std::string& url) {
-		if(funcs->onChangeTargetURL)
+		AWE_STATS_SCOPE("WebViewListenerC.onChangeTargetURL", caller);
+		if(funcs && funcs->onChangeTargetURL)
 			funcs->onChangeTargetURL(caller, url.c_str());
 	}
 	
 	void onOpenExternalLink(Awesomium::WebView* caller, 
 									const std::string& url, 
 									const std::wstring& source) {
-		if(funcs->onOpenExternalLink)
+		AWE_STATS_SCOPE("WebViewListenerC.onOpenExternalLink", caller);
+		if(funcs && funcs->onOpenExternalLink)
 			funcs->onOpenExternalLink(caller, url.c_str(), source.c_str());
 	}
 
 	void onRequestDownload(Awesomium::WebView* caller,
 		const std::string& url) {
-		if(funcs->onRequestDownload)
+		AWE_STATS_SCOPE("WebViewListenerC.onRequestDownload", caller);
+		if(funcs && funcs->onRequestDownload)
 			funcs->onRequestDownload(caller, url.c_str());
 	}
 	
 	void onWebViewCrashed(Awesomium::WebView* caller) {
-		if(funcs->onWebViewCrashed)
+		AWE_STATS_SCOPE("WebViewListenerC.onWebViewCrashed", caller);
+		if(funcs && funcs->onWebViewCrashed)
 			funcs->onWebViewCrashed(caller);
 	}
 			
 	void onPluginCrashed(Awesomium::WebView* caller, 
 		const std::wstring& pluginName) {
-		if(funcs->onPluginCrashed)
+		AWE_STATS_SCOPE("WebViewListenerC.onPluginCrashed", caller);
+		if(funcs && funcs->onPluginCrashed)
 			funcs->onPluginCrashed(caller, pluginName.c_str());
 	}
 			
 	void onRequestMove(Awesomium::WebView* caller, 
 		int x, int y) {
-		if(funcs->onRequestMove)
+		AWE_STATS_SCOPE("WebViewListenerC.onRequestMove", caller);
+		if(funcs && funcs->onRequestMove)
 			funcs->onRequestMove(caller, x, y);
 	}
 	
 	void onGetPageContents(Awesomium::WebView* caller, 
 								   const std::string& url, 
 								   const std::wstring& contents) {
-		if(funcs->onGetPageContents)
+		AWE_STATS_SCOPE("WebViewListenerC.onGetPageContents", caller);
+		if(deliverPageContents(caller, url, contents))
+			return;
+		if(funcs && funcs->onGetPageContents)
 			funcs->onGetPageContents(caller, url.c_str(), contents.c_str());
 	}
 			
 	void onDOMReady(Awesomium::WebView* caller) {
-		if(funcs->onDOMReady)
+		AWE_STATS_SCOPE("WebViewListenerC.onDOMReady", caller);
+		if(funcs && funcs->onDOMReady)
 			funcs->onDOMReady(caller);
 	}
 };
 
+/*-----------------------------------------------------------------------------
+  Resource cache, a size bounded LRU of response bodies keyed by URL. It is
+  consulted by the ResourceInterceptorImpl of every WebView, which may be
+  called from a thread other than the one calling awe_WebCore_update.
+  file:// URLs that miss are loaded by Awesomium as usual while a thread pool
+  work item reads them into the cache for the next request.
+-----------------------------------------------------------------------------*/
+struct CachedResource {
+	std::string url;
+	std::vector<unsigned char> data;
+	std::string mimeType;
+};
+
+struct ResourceCache {
+	CRITICAL_SECTION lock;
+	std::list<CachedResource> entries;
+	std::map<std::string, std::list<CachedResource>::iterator> index;
+	size_t size;
+	size_t capacity;
+	bool cacheFiles;
+	// file:// URLs being read into the cache
+	std::set<std::string> loading;
+
+	ResourceCache() {
+		InitializeCriticalSection(&lock);
+		size = 0;
+		capacity = 0;
+		cacheFiles = true;
+	}
+
+	~ResourceCache() {
+		DeleteCriticalSection(&lock);
+	}
+
+	// callers hold the lock
+	void remove(std::map<std::string, std::list<CachedResource>::iterator>::iterator it) {
+		size -= it->second->data.size();
+		entries.erase(it->second);
+		index.erase(it);
+	}
+
+	void evict() {
+		while(size > capacity && !entries.empty())
+			remove(index.find(entries.back().url));
+	}
+
+	void put(const std::string& url, const unsigned char* data, size_t numBytes, const std::string& mimeType) {
+		EnterCriticalSection(&lock);
+		std::map<std::string, std::list<CachedResource>::iterator>::iterator it = index.find(url);
+		if(it != index.end())
+			remove(it);
+		if(numBytes <= capacity) {
+			entries.push_front(CachedResource());
+			CachedResource& entry = entries.front();
+			entry.url = url;
+			entry.data.assign(data, data + numBytes);
+			entry.mimeType = mimeType;
+			index[url] = entries.begin();
+			size += numBytes;
+			evict();
+		}
+		LeaveCriticalSection(&lock);
+	}
+
+	// ResourceResponse::Create copies the body, so the entry may be evicted right after.
+	// Returns 0 on a miss, and sets loadFile when the caller should read url into the cache.
+	ResourceResponse* createResponse(const std::string& url, bool* loadFile) {
+		ResourceResponse* response = 0;
+		*loadFile = false;
+		EnterCriticalSection(&lock);
+		if(capacity > 0) {
+			std::map<std::string, std::list<CachedResource>::iterator>::iterator it = index.find(url);
+			if(it != index.end()) {
+				entries.splice(entries.begin(), entries, it->second);
+				CachedResource& entry = *it->second;
+				response = ResourceResponse::Create(entry.data.size(), entry.data.empty()?0:&entry.data[0], entry.mimeType);
+			} else if(cacheFiles && url.compare(0, 7, "file://") == 0 && loading.insert(url).second) {
+				*loadFile = true;
+			}
+		}
+		LeaveCriticalSection(&lock);
+		return response;
+	}
+
+	void finishLoading(const std::string& url) {
+		EnterCriticalSection(&lock);
+		loading.erase(url);
+		LeaveCriticalSection(&lock);
+	}
+};
+
+static ResourceCache resourceCache;
+
+// file:///C:/some%20dir/file.html -> C:/some dir/file.html
+static std::wstring getFilePath(const std::string& url) {
+	std::string path;
+	size_t start = url.compare(0, 8, "file:///") == 0?8:7;
+	for(size_t i = start; i < url.size(); i++) {
+		if(url[i] == '?' || url[i] == '#')
+			break;
+		if(url[i] == '%' && i + 2 < url.size()) {
+			path += (char)strtol(url.substr(i + 1, 2).c_str(), 0, 16);
+			i += 2;
+		}
+		else
+			path += url[i];
+	}
+	std::wstring result;
+	int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, 0, 0);
+	if(length > 1) {
+		result.resize(length);
+		MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &result[0], length);
+		result.resize(length - 1);
+	}
+	return result;
+}
+
+// thread pool work item reading a file:// URL into the cache, param is a heap allocated copy of the URL
+static DWORD WINAPI cacheFile(LPVOID param) {
+	std::string* url = static_cast<std::string*> (param);
+	FILE* file = _wfopen(getFilePath(*url).c_str(), L"rb");
+	if(file) {
+		std::vector<unsigned char> data;
+		unsigned char chunk[16 * 1024];
+		size_t read;
+		while((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+			data.insert(data.end(), chunk, chunk + read);
+		fclose(file);
+		resourceCache.put(*url, data.empty()?0:&data[0], data.size(), awe_guessMimeType(url->c_str()));
+	}
+	resourceCache.finishLoading(*url);
+	delete url;
+	return 0;
+}
+
+class ResourceInterceptorImpl: public ResourceInterceptor {
+protected:
+	const ResourceInterceptorC* volatile funcs;
+public:
+
+	ResourceInterceptorImpl() {
+		funcs = 0;
+	}
+
+	const ResourceInterceptorC* getFuncs() {
+		return funcs;
+	}
+
+	void setFuncs(const ResourceInterceptorC* funcs) {
+		this->funcs = funcs;
+	}
+
+	Awesomium::ResourceResponse* onRequest(Awesomium::WebView* caller, 
+										   const std::string& url, 
+										   const std::string& referrer) {
+		AWE_STATS_SCOPE("ResourceInterceptorC.onRequest", caller);
+		const ResourceInterceptorC* callbacks = funcs;
+		if(callbacks && callbacks->onRequest) {
+			ResourceResponse* response = static_cast<ResourceResponse*>(callbacks->onRequest(caller, url.c_str(), referrer.c_str()));
+			if(response)
+				return response;
+		}
+		ResourceResponse* response = static_cast<ResourceResponse*>(awe_ResourcePack_createResponse(url.c_str()));
+		if(response)
+			return response;
+		bool loadFile;
+		response = resourceCache.createResponse(url, &loadFile);
+		if(loadFile) {
+			std::string* copy = new std::string(url);
+			if(!QueueUserWorkItem(cacheFile, copy, WT_EXECUTEDEFAULT)) {
+				resourceCache.finishLoading(url);
+				delete copy;
+			}
+		}
+		return response;
+	}
+
+	void onResponse(Awesomium::WebView* caller, 
+					const std::string& url, int statusCode, 
+					const Awesomium::ResourceResponseMetrics& metrics) {
+		AWE_STATS_SCOPE("ResourceInterceptorC.onResponse", caller);
+		const ResourceInterceptorC* callbacks = funcs;
+		if(callbacks && callbacks->onResponse) {
+			ResourceResponseMetricsC metricsC;
+			metricsC.wasCached = metrics.wasCached?-1:0;
+			metricsC.requestTimeMs = metrics.requestTimeMs;
+			metricsC.responseTimeMs = metrics.responseTimeMs;
+			metricsC.expectedContentSize = metrics.expectedContentSize;
+			metricsC.mimeType = metrics.mimeType.c_str();
+			callbacks->onResponse(caller, url.c_str(), statusCode, &metricsC);
+		}
+	}
+};
+
+/*-----------------------------------------------------------------------------
+  Wrapper side WebView state
+-----------------------------------------------------------------------------*/
+#define AWE_CONTENTS_CHUNK_SIZE (64 * 1024)
+
+#define AWE_RESIZE_DEBOUNCE_MS 33
+
+#define AWE_SCROLL_MIN_SIZE 64
+
+#define AWE_FRAME_COUNT 3
+#define AWE_FRAME_FRESH 4
+
+struct BoundCallback {
+	std::wstring objectName;
+	std::wstring callbackName;
+	unsigned long long hash;
+	BoundCallbackC callback;
+	void* userData;
+};
+
+struct PendingScript {
+	JavascriptResultCallbackC callback;
+	void* userData;
+};
+
+// one of the frames published by the update thread
+struct FrameSlot {
+	std::vector<unsigned char> pixels;
+	int width;
+	int height;
+	int frameNumber;
+	// area changed since this slot was last written
+	RectC pending;
+};
+
+// writer side of the awesomiumc_shm.h frame ring
+struct SharedFrameWriter {
+	HANDLE mapping;
+	unsigned char* base;
+	SharedFramesHeaderC* header;
+	SharedFrameSlotC* slots;
+	// area each slot is missing, slots still hold the frame from slotCount publishes ago
+	std::vector<RectC> pending;
+	int nextSlot;
+	LONG frameNumber;
+
+	~SharedFrameWriter() {
+		UnmapViewOfFile(base);
+		CloseHandle(mapping);
+	}
+};
+
+struct WebViewState {
+	WebView* webView;
+	// tells this view apart from earlier ones at the same address
+	unsigned int generation;
+	void* userData;
+
+	// damage tracking, shadow holds a copy of the last frame handed out
+	bool damageTracking;
+	DamageShadow shadow;
+	std::vector<RectC> dirtyRects;
+
+	// caller owned render target, written to whenever the WebView is rendered
+	RenderBuffer* target;
+	bool targetNeedsFullCopy;
+	bool targetUpdated;
+	RectC targetBounds;
+
+	// scripts evaluated asynchronously, keyed by request id
+	bool wrapperObjectCreated;
+	std::map<int, PendingScript> pendingScripts;
+
+	// batched scripts keyed by frame name, flushed as one evaluation per frame
+	std::map<std::wstring, std::wstring> scriptBatches;
+
+	// triple buffered frames, the update thread writes the back frame and
+	// exchanges it with the ready one, the host exchanges the ready frame with
+	// the front one. readyFrame carries AWE_FRAME_FRESH until it is taken.
+	FrameSlot frames[AWE_FRAME_COUNT];
+	int backFrame;
+	int frontFrame;
+	volatile LONG readyFrame;
+	int frameCount;
+
+	// installed on every WebView so the resource cache can serve requests
+	ResourceInterceptorImpl* interceptor;
+
+	// objects created through awe_WebView_createObject, destroyed when a pooled view is released
+	std::vector<std::wstring> objects;
+
+	// callbacks bound with awe_WebView_bindCallback, the id is the index + 1,
+	// boundCallbackIds maps the 64 bit hash of both names to the ids
+	std::vector<BoundCallback> boundCallbacks;
+	std::multimap<unsigned long long, int> boundCallbackIds;
+
+	// set with awe_WebView_setPackedCallback, kept out of WebViewListenerC so its size doesn't change
+	PackedCallbackC packedCallback;
+	void* packedCallbackUserData;
+
+	// last values sent with awe_WebView_setObjectProperties, keyed by object and property name
+	std::map<std::wstring, JSValue::Object> propertyShadows;
+
+	// frames exported to shared memory for other processes
+	SharedFrameWriter* sharedFrames;
+
+	// page contents delivered in chunks of contentsChunkSize UTF-16 units, transcoded through contentsBuffer
+	int contentsChunkSize;
+	int contentsEncoding;
+	std::vector<char> contentsBuffer;
+	PageContentsChunkCallbackC contentsCallback;
+	void* contentsCallbackUserData;
+
+	// render throttling, awe_WebCore_update only renders visible views and at most maxFps times a second
+	int visibility;
+	int maxFps;
+	LONGLONG lastRenderTicks;
+
+	// awe_WebCore_renderDirtyViews renders higher priorities first, renderBuffer is the last rendered buffer
+	int renderPriority;
+	const RenderBuffer* renderBuffer;
+
+	// size last passed to WebView::resize, or the creation size
+	int width;
+	int height;
+
+	// asynchronous resizing, the latest requested size is applied at most once
+	// every resizeDebounceMS and resizeCallback fires once the page has
+	// repainted at the applied size, appliedWidth and appliedHeight
+	int resizeWidth;
+	int resizeHeight;
+	int appliedWidth;
+	int appliedHeight;
+	bool resizePending;
+	bool resizeApplied;
+	int resizeDebounceMS;
+	LONGLONG lastResizeTicks;
+	ResizeCompleteCallbackC resizeCallback;
+	void* resizeCallbackUserData;
+
+	// maximum size passed to awe_WebView_setResizeMode, 0 if not set
+	int maxResizeWidth;
+	int maxResizeHeight;
+
+	// scroll detection, scrollShadow is a tightly packed copy of the previous
+	// frame. When the last render moved the content of scrollClip by scrollDY
+	// rows, dirtyRects only hold the rows the move does not account for.
+	bool scrollDetection;
+	std::vector<unsigned char> scrollShadow;
+	int scrollShadowWidth;
+	int scrollShadowHeight;
+	bool scrolled;
+	int scrollDY;
+	RectC scrollClip;
+
+	WebViewState(WebView* webView) {
+		this->webView = webView;
+		generation = 0;
+		damageTracking = false;
+		target = 0;
+		targetNeedsFullCopy = false;
+		targetUpdated = false;
+		wrapperObjectCreated = false;
+		backFrame = 0;
+		readyFrame = 1;
+		frontFrame = 2;
+		frameCount = 0;
+		interceptor = 0;
+		visibility = AWE_VISIBILITY_VISIBLE;
+		maxFps = 0;
+		lastRenderTicks = 0;
+		renderPriority = 0;
+		renderBuffer = 0;
+		width = 0;
+		height = 0;
+		resizeWidth = 0;
+		resizeHeight = 0;
+		appliedWidth = 0;
+		appliedHeight = 0;
+		resizePending = false;
+		resizeApplied = false;
+		resizeDebounceMS = AWE_RESIZE_DEBOUNCE_MS;
+		lastResizeTicks = 0;
+		resizeCallback = 0;
+		resizeCallbackUserData = 0;
+		maxResizeWidth = 0;
+		maxResizeHeight = 0;
+		scrollDetection = false;
+		scrollShadowWidth = 0;
+		scrollShadowHeight = 0;
+		scrolled = false;
+		scrollDY = 0;
+		memset(&scrollClip, 0, sizeof(RectC));
+		sharedFrames = 0;
+		packedCallback = 0;
+		packedCallbackUserData = 0;
+		contentsChunkSize = AWE_CONTENTS_CHUNK_SIZE;
+		contentsEncoding = AWE_CONTENTS_UTF16;
+		contentsCallback = 0;
+		contentsCallbackUserData = 0;
+		userData = 0;
+		for(int i = 0; i < AWE_FRAME_COUNT; i++) {
+			frames[i].width = 0;
+			frames[i].height = 0;
+			frames[i].frameNumber = 0;
+			memset(&frames[i].pending, 0, sizeof(RectC));
+		}
+	}
+
+	~WebViewState() {
+		delete target;
+		delete interceptor;
+		delete sharedFrames;
+	}
+};
+
+static std::map<WebView*, WebViewState*> webViewStates;
+
+// initialized before any export can run, so there is no first use to race on
+struct StaticLock {
+	CRITICAL_SECTION lock;
+
+	StaticLock() {
+		InitializeCriticalSection(&lock);
+	}
+
+	~StaticLock() {
+		DeleteCriticalSection(&lock);
+	}
+};
+
+// held while states are added or deleted and by the lookups the host makes
+// while the update thread owns the views, awe_WebView_acquireLatestFrame and
+// posting commands
+static StaticLock statesLock;
+
+static unsigned int nextViewGeneration = 1;
+
+static WebViewState* getWebViewState(WebView* webView) {
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(webView);
+	if(result != webViewStates.end())
+		return result->second;
+	WebViewState* state = new WebViewState(webView);
+	state->generation = nextViewGeneration++;
+	EnterCriticalSection(&statesLock.lock);
+	webViewStates[webView] = state;
+	LeaveCriticalSection(&statesLock.lock);
+	return state;
+}
+
+static void cancelPendingScripts(WebView* webView) {
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(webView);
+	if(result == webViewStates.end() || result->second->pendingScripts.empty())
+		return;
+	// callbacks may queue new scripts, detach the current ones first
+	std::map<int, PendingScript> pending;
+	pending.swap(result->second->pendingScripts);
+	JSValue null;
+	for(std::map<int, PendingScript>::iterator it = pending.begin(); it != pending.end(); it++)
+		it->second.callback(webView, it->first, 0, &null, it->second.userData);
+}
+
+static void deleteWebViewState(WebView* webView) {
+	cancelPendingScripts(webView);
+	EnterCriticalSection(&statesLock.lock);
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(webView);
+	if(result != webViewStates.end()) {
+		delete result->second;
+		webViewStates.erase(result);
+	}
+	LeaveCriticalSection(&statesLock.lock);
+}
+
+// returns false if no chunk callback is set
+static bool deliverPageContents(WebView* caller, const std::string& url, const std::wstring& contents) {
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(caller);
+	if(result == webViewStates.end() || !result->second->contentsCallback)
+		return false;
+	WebViewState* state = result->second;
+	size_t chunkSize = state->contentsChunkSize > 1?state->contentsChunkSize:2;
+	size_t offset = 0;
+	do {
+		size_t length = getChunkLength(contents, offset, chunkSize);
+		bool isLast = offset + length == contents.size();
+		const wchar_t* chunk = contents.c_str() + offset;
+		if(state->contentsEncoding == AWE_CONTENTS_UTF8) {
+			state->contentsBuffer.clear();
+			encodeUTF8(state->contentsBuffer, chunk, length);
+			state->contentsCallback(caller, url.c_str(), state->contentsBuffer.empty()?"":&state->contentsBuffer[0], 
+				(int)state->contentsBuffer.size(), isLast?-1:0, state->contentsCallbackUserData);
+		} else {
+			state->contentsCallback(caller, url.c_str(), chunk, (int)(length * sizeof(wchar_t)), isLast?-1:0, state->contentsCallbackUserData);
+		}
+		offset += length;
+	} while(offset < contents.size());
+
+	// don't keep the buffer of a huge page around
+	if(state->contentsBuffer.capacity() > (size_t)chunkSize * 4)
+		std::vector<char>().swap(state->contentsBuffer);
+	return true;
+}
+
+static void cancelAllPendingScripts() {
+	std::vector<WebView*> webViews;
+	for(std::map<WebView*, WebViewState*>::iterator it = webViewStates.begin(); it != webViewStates.end(); it++)
+		webViews.push_back(it->first);
+	for(size_t i = 0; i < webViews.size(); i++)
+		cancelPendingScripts(webViews[i]);
+}
+
+static void deleteAllWebViewStates() {
+	EnterCriticalSection(&statesLock.lock);
+	for(std::map<WebView*, WebViewState*>::iterator it = webViewStates.begin(); it != webViewStates.end(); it++)
+		delete it->second;
+	webViewStates.clear();
+	LeaveCriticalSection(&statesLock.lock);
+}
+
+static int nextScriptId = 1;
+
+template <class C>
+static void appendAscii(std::basic_string<C>& out, const char* str) {
+	for(; *str; str++)
+		out += (C)*str;
+}
+
+template <class C>
+static void appendStringLiteral(std::basic_string<C>& out, const C* str) {
+	out += (C)'"';
+	for(; *str; str++) {
+		unsigned int c = sizeof(C) == 1?(unsigned char)*str:(unsigned int)*str;
+		if(c == '"' || c == '\\') {
+			out += (C)'\\';
+			out += *str;
+		}
+		else if(c == '\n')
+			appendAscii(out, "\\n");
+		else if(c == '\r')
+			appendAscii(out, "\\r");
+		else if(c == 0x2028)
+			appendAscii(out, "\\u2028");
+		else if(c == 0x2029)
+			appendAscii(out, "\\u2029");
+		// the same separators encoded as UTF-8
+		else if(sizeof(C) == 1 && c == 0xE2 && (unsigned char)str[1] == 0x80 && ((unsigned char)str[2] == 0xA8 || (unsigned char)str[2] == 0xA9)) {
+			appendAscii(out, (unsigned char)str[2] == 0xA8?"\\u2028":"\\u2029");
+			str += 2;
+		}
+		else
+			out += *str;
+	}
+	out += (C)'"';
+}
+
+// evaluates the script in global scope and reports the result to the wrapper object, the
+// wrapper runs synchronously in the page so a result is lost only if the view goes away
+template <class C>
+static int executeJavascriptAsync(WebView* webView, const C* javascript, const wchar_t* frameName, JavascriptResultCallbackC callback, void* userData) {
+	WebViewState* state = getWebViewState(webView);
+	if(!state->wrapperObjectCreated) {
+		if(!webView->getListener())
+			webView->setListener(new WebViewListenerImpl(0));
+		webView->createObject(AWE_WRAPPER_OBJECT);
+		webView->setObjectCallback(AWE_WRAPPER_OBJECT, L"resolve");
+		webView->setObjectCallback(AWE_WRAPPER_OBJECT, L"reject");
+		state->wrapperObjectCreated = true;
+	}
+
+	int id = nextScriptId++;
+	char idString[16];
+	sprintf(idString, "%d", id);
+
+	std::basic_string<C> script;
+	appendAscii(script, "(function(){var r;try{r=(0,eval)(");
+	appendStringLiteral(script, javascript);
+	appendAscii(script, ");}catch(e){__awesomiumc.reject(");
+	appendAscii(script, idString);
+	appendAscii(script, ",String(e));return;}__awesomiumc.resolve(");
+	appendAscii(script, idString);
+	appendAscii(script, ",r===undefined?null:r);})();");
+
+	PendingScript pending;
+	pending.callback = callback;
+	pending.userData = userData;
+	state->pendingScripts[id] = pending;
+	webView->executeJavascript(script, internName(frameName));
+	return id;
+}
+
+static void appendUTF8(std::wstring& out, const char* str) {
+	int length = MultiByteToWideChar(CP_UTF8, 0, str, -1, 0, 0);
+	if(length <= 1)
+		return;
+	size_t offset = out.size();
+	out.resize(offset + length);
+	MultiByteToWideChar(CP_UTF8, 0, str, -1, &out[offset], length);
+	// drop the terminator
+	out.resize(offset + length - 1);
+}
+
+// writes the value as a Javascript literal
+static void appendJSValue(std::wstring& out, const JSValue& value) {
+	char number[32];
+	if(value.isBoolean())
+		appendAscii(out, value.toBoolean()?"true":"false");
+	else if(value.isInteger()) {
+		sprintf(number, "%d", value.toInteger());
+		appendAscii(out, number);
+	}
+	else if(value.isDouble()) {
+		double d = value.toDouble();
+		if(d != d)
+			appendAscii(out, "NaN");
+		else if(d > DBL_MAX)
+			appendAscii(out, "Infinity");
+		else if(d < -DBL_MAX)
+			appendAscii(out, "-Infinity");
+		else {
+			sprintf(number, "%.17g", d);
+			appendAscii(out, number);
+		}
+	}
+	else if(value.isString())
+		appendStringLiteral(out, value.toString().c_str());
+	else if(value.isArray()) {
+		const JSValue::Array& array = value.getArray();
+		out += L'[';
+		for(size_t i = 0; i < array.size(); i++) {
+			if(i > 0)
+				out += L',';
+			appendJSValue(out, array[i]);
+		}
+		out += L']';
+	}
+	else if(value.isObject()) {
+		const JSValue::Object& object = value.getObject();
+		out += L'{';
+		for(JSValue::Object::const_iterator it = object.begin(); it != object.end(); it++) {
+			if(it != object.begin())
+				out += L',';
+			appendStringLiteral(out, it->first.c_str());
+			out += L':';
+			appendJSValue(out, it->second);
+		}
+		out += L'}';
+	}
+	else
+		appendAscii(out, "null");
+}
+
+// each script gets its own try block so a failing one doesn't abort the rest of the batch
+// the statement appended after start is traced once it is complete
+static std::wstring& beginBatchedScript(WebView* webView, const wchar_t* frameName, size_t* start) {
+	std::wstring& batch = getWebViewState(webView)->scriptBatches[internName(frameName)];
+	batch += L"try{";
+	*start = batch.size();
+	return batch;
+}
+
+static void endBatchedScript(WebView* webView, std::wstring& batch, size_t start, const wchar_t* frameName) {
+	traceText(AWE_TRACE_BATCH_JAVASCRIPT, webView, batch.c_str() + start, batch.size() - start, frameName);
+	batch += L"\n}catch(e){}\n";
+}
+
+static void appendFunctionCall(std::wstring& out, const wchar_t* object, const wchar_t* function, const JSArguments* arguments) {
+	if(object[0]) {
+		out += object;
+		out += L'.';
+	}
+	out += function;
+	out += L'(';
+	for(size_t i = 0; arguments && i < arguments->size(); i++) {
+		if(i > 0)
+			out += L',';
+		appendJSValue(out, (*arguments)[i]);
+	}
+	out += L");";
+}
+
+static void flushScriptBatches(WebViewState* state) {
+	for(std::map<std::wstring, std::wstring>::iterator it = state->scriptBatches.begin(); it != state->scriptBatches.end(); it++) {
+		if(it->second.empty())
+			continue;
+		state->webView->executeJavascript(it->second, it->first);
+		// keep the buffer around for the next frame
+		it->second.clear();
+	}
+}
+
+/*-----------------------------------------------------------------------------
+  Command queue, lets any thread post WebView calls that are executed on the
+  thread calling awe_WebCore_update, or the update thread while it runs.
+  Producers push onto a lock free stack, the consumer takes the whole stack
+  at once and reverses it. Commands without a WebView are always executed.
+-----------------------------------------------------------------------------*/
+#define AWE_COMMAND_LOAD_URL 1
+#define AWE_COMMAND_LOAD_URL_W 2
+#define AWE_COMMAND_EXECUTE_JAVASCRIPT 3
+#define AWE_COMMAND_EXECUTE_JAVASCRIPT_W 4
+#define AWE_COMMAND_MOUSE_MOVE 5
+#define AWE_COMMAND_MOUSE_DOWN 6
+#define AWE_COMMAND_MOUSE_UP 7
+#define AWE_COMMAND_MOUSE_WHEEL 8
+#define AWE_COMMAND_KEYBOARD_EVENT 9
+#define AWE_COMMAND_KEYBOARD_EVENT_WINDOWS 10
+#define AWE_COMMAND_CREATE_VIEW 11
+#define AWE_COMMAND_TASK 12
+
+struct WebViewCommand {
+	WebViewCommand* next;
+	WebView* webView;
+	int type;
+	int x, y;
+	WPARAM wparam;
+	LPARAM lparam;
+	std::string string;
+	std::wstring wideString;
+	std::wstring frameName;
+	std::string username;
+	std::string password;
+	WebKeyboardEventC keyboardEvent;
+	DeferredWebViewCallbackC viewCallback;
+	TaskCallbackC task;
+	void* userData;
+	// generation of the view when the command was posted
+	unsigned int generation;
+
+	WebViewCommand(WebView* webView, int type) {
+		next = 0;
+		this->webView = webView;
+		this->type = type;
+		generation = 0;
+		x = 0;
+		y = 0;
+		wparam = 0;
+		lparam = 0;
+		viewCallback = 0;
+		task = 0;
+		userData = 0;
+	}
+};
+
+static WebViewCommand* volatile commandQueue = 0;
+
+static std::string copyString(const char* str) {
+	return str?std::string(str):std::string();
+}
+
+static std::wstring copyString(const wchar_t* str) {
+	return str?std::wstring(str):std::wstring();
+}
+
+// commands for views that are already gone are dropped right away
+static void postCommand(WebViewCommand* command) {
+	if(command->webView) {
+		EnterCriticalSection(&statesLock.lock);
+		std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(command->webView);
+		if(result != webViewStates.end())
+			command->generation = result->second->generation;
+		LeaveCriticalSection(&statesLock.lock);
+		if(!command->generation) {
+			delete command;
+			return;
+		}
+	}
+	WebViewCommand* head;
+	do {
+		head = commandQueue;
+		command->next = head;
+	} while(InterlockedCompareExchangePointer((void* volatile*)&commandQueue, command, head) != head);
+}
+
+static void executeCommand(WebViewCommand* command) {
+	WebView* webView = command->webView;
+	switch(command->type) {
+		// the strings are passed as they are, the scratch strings belong to the direct calls
+		case AWE_COMMAND_LOAD_URL:
+			traceText(AWE_TRACE_LOAD_URL, webView, command->string.c_str(), command->string.size(), command->frameName.c_str());
+			webView->loadURL(command->string, command->frameName, command->username, command->password);
+			break;
+		case AWE_COMMAND_LOAD_URL_W:
+			traceText(AWE_TRACE_LOAD_URL_W, webView, command->wideString.c_str(), command->wideString.size(), command->frameName.c_str());
+			webView->loadURL(command->wideString, command->frameName, command->username, command->password);
+			break;
+		case AWE_COMMAND_EXECUTE_JAVASCRIPT:
+			traceText(AWE_TRACE_EXECUTE_JAVASCRIPT, webView, command->string.c_str(), command->string.size(), command->frameName.c_str());
+			webView->executeJavascript(command->string, command->frameName);
+			break;
+		case AWE_COMMAND_EXECUTE_JAVASCRIPT_W:
+			traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_W, webView, command->wideString.c_str(), command->wideString.size(), command->frameName.c_str());
+			webView->executeJavascript(command->wideString, command->frameName);
+			break;
+		case AWE_COMMAND_MOUSE_MOVE: awe_WebView_injectMouseMove(webView, command->x, command->y); break;
+		case AWE_COMMAND_MOUSE_DOWN: awe_WebView_injectMouseDown(webView, command->x); break;
+		case AWE_COMMAND_MOUSE_UP: awe_WebView_injectMouseUp(webView, command->x); break;
+		case AWE_COMMAND_MOUSE_WHEEL: awe_WebView_injectMouseWheel(webView, command->x); break;
+		case AWE_COMMAND_KEYBOARD_EVENT: awe_WebView_injectKeyboardEvent(webView, &command->keyboardEvent); break;
+		case AWE_COMMAND_KEYBOARD_EVENT_WINDOWS: awe_WebView_injectKeyboardEventWindows(webView, command->x, command->wparam, command->lparam); break;
+		case AWE_COMMAND_CREATE_VIEW: awe_WebCore_createWebViewDeferred(command->x, command->y, command->string.c_str(), command->viewCallback, command->userData); break;
+		case AWE_COMMAND_TASK: command->task(WebCore::GetPointer(), command->userData); break;
+	}
+}
+
+// commands for WebViews destroyed in the meantime are dropped, also when a new
+// view got the same address
+static void drainCommandQueue() {
+	WebViewCommand* list = static_cast<WebViewCommand*>(InterlockedExchangePointer((void* volatile*)&commandQueue, 0));
+	WebViewCommand* ordered = 0;
+	while(list) {
+		WebViewCommand* next = list->next;
+		list->next = ordered;
+		ordered = list;
+		list = next;
+	}
+	while(ordered) {
+		WebViewCommand* next = ordered->next;
+		if(!ordered->webView) {
+			executeCommand(ordered);
+		} else {
+			std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(ordered->webView);
+			if(result != webViewStates.end() && result->second->generation == ordered->generation)
+				executeCommand(ordered);
+		}
+		delete ordered;
+		ordered = next;
+	}
+}
+
+static bool handleWrapperCallback(WebView* caller, const std::wstring& callbackName, const JSArguments& args) {
+	bool resolved = callbackName == L"resolve";
+	if(!resolved && callbackName != L"reject")
+		return false;
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(caller);
+	if(result == webViewStates.end() || args.size() < 2)
+		return true;
+	std::map<int, PendingScript>& pendingScripts = result->second->pendingScripts;
+	std::map<int, PendingScript>::iterator pending = pendingScripts.find(args[0].toInteger());
+	if(pending == pendingScripts.end())
+		return true;
+	int id = pending->first;
+	PendingScript script = pending->second;
+	pendingScripts.erase(pending);
+	script.callback(caller, id, resolved?-1:0, &args[1], script.userData);
+	return true;
+}
+
+static unsigned long long hashCallbackName(const wchar_t* objectName, size_t objectLength, const wchar_t* callbackName, size_t callbackLength) {
+	unsigned long long hash = 14695981039346656037ull;
+	for(size_t i = 0; i < objectLength; i++)
+		hash = (hash ^ (unsigned long long)objectName[i]) * 1099511628211ull;
+	// separates the names so "a" "bc" and "ab" "c" differ
+	hash = hash * 1099511628211ull;
+	for(size_t i = 0; i < callbackLength; i++)
+		hash = (hash ^ (unsigned long long)callbackName[i]) * 1099511628211ull;
+	return hash;
+}
+
+static int findBoundCallback(WebViewState* state, unsigned long long hash, const wchar_t* objectName, size_t objectLength, const wchar_t* callbackName, size_t callbackLength) {
+	typedef std::multimap<unsigned long long, int>::iterator Iterator;
+	std::pair<Iterator, Iterator> range = state->boundCallbackIds.equal_range(hash);
+	for(Iterator it = range.first; it != range.second; it++) {
+		const BoundCallback& bound = state->boundCallbacks[it->second - 1];
+		if(bound.objectName.size() == objectLength && bound.callbackName.size() == callbackLength &&
+			wmemcmp(bound.objectName.c_str(), objectName, objectLength) == 0 && wmemcmp(bound.callbackName.c_str(), callbackName, callbackLength) == 0)
+			return it->second;
+	}
+	return 0;
+}
+
+static void unbindCallback(WebViewState* state, int callbackId) {
+	BoundCallback& bound = state->boundCallbacks[callbackId - 1];
+	typedef std::multimap<unsigned long long, int>::iterator Iterator;
+	std::pair<Iterator, Iterator> range = state->boundCallbackIds.equal_range(bound.hash);
+	for(Iterator it = range.first; it != range.second; it++) {
+		if(it->second == callbackId) {
+			state->boundCallbackIds.erase(it);
+			break;
+		}
+	}
+	bound.callback = 0;
+	bound.userData = 0;
+}
+
+static bool dispatchPackedCallback(WebView* caller, const std::wstring& objectName, const std::wstring& callbackName, ArgumentPacker& packer, const JSArguments& args) {
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(caller);
+	if(result == webViewStates.end() || !result->second->packedCallback)
+		return false;
+	WebViewState* state = result->second;
+	state->packedCallback(caller, objectName.c_str(), callbackName.c_str(), packer.pack(args), state->packedCallbackUserData);
+	return true;
+}
+
+// the names are resolved to the id by their 64 bit hash alone, they are only
+// compared in the unlikely case that two bound pairs share a hash
+static bool dispatchBoundCallback(WebView* caller, const std::wstring& objectName, const std::wstring& callbackName, const JSArguments& args) {
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(caller);
+	if(result == webViewStates.end() || result->second->boundCallbackIds.empty())
+		return false;
+	WebViewState* state = result->second;
+	unsigned long long hash = hashCallbackName(objectName.c_str(), objectName.size(), callbackName.c_str(), callbackName.size());
+	typedef std::multimap<unsigned long long, int>::iterator Iterator;
+	std::pair<Iterator, Iterator> range = state->boundCallbackIds.equal_range(hash);
+	if(range.first == range.second)
+		return false;
+	int id = range.first->second;
+	if(++range.first != range.second)
+		id = findBoundCallback(state, hash, objectName.c_str(), objectName.size(), callbackName.c_str(), callbackName.size());
+	if(!id)
+		return false;
+	const BoundCallback& bound = state->boundCallbacks[id - 1];
+	bound.callback(caller, id, &args, bound.userData);
+	return true;
+}
+
+// clips the rect to the given dimensions, returns false if nothing is left
+static bool clipRect(const Rect& rect, int width, int height, RectC* result) {
+	int x0 = rect.x < 0?0:rect.x;
+	int y0 = rect.y < 0?0:rect.y;
+	int x1 = rect.x + rect.width > width?width:rect.x + rect.width;
+	int y1 = rect.y + rect.height > height?height:rect.y + rect.height;
+	if(x1 <= x0 || y1 <= y0) {
+		*result = makeRect(0, 0, 0, 0);
+		return false;
+	}
+	*result = makeRect(x0, y0, x1 - x0, y1 - y0);
+	return true;
+}
+
+static unsigned int hashRow(const unsigned char* row, int width) {
+	const unsigned int* pixels = reinterpret_cast<const unsigned int*>(row);
+	unsigned int hash = 2166136261u;
+	for(int x = 0; x < width; x++)
+		hash = (hash ^ pixels[x]) * 16777619u;
+	return hash;
+}
+
+static bool compareRowHash(const std::pair<unsigned int, int>& a, const std::pair<unsigned int, int>& b) {
+	return a.first < b.first;
+}
+
+// finds the row offset that maps the most rows of the previous frame onto the
+// new one inside the dirty area, only rows that differ from the row above vote
+// so runs of background rows can't outvote the content. Returns 0 if nothing
+// better than the unscrolled frame was found.
+static int findScrollOffset(const std::vector<unsigned int>& oldHashes, const std::vector<unsigned int>& newHashes) {
+	int height = (int)newHashes.size();
+	std::vector<std::pair<unsigned int, int> > oldRows;
+	oldRows.reserve(height);
+	for(int y = 0; y < height; y++) {
+		if(y == 0 || oldHashes[y] != oldHashes[y - 1])
+			oldRows.push_back(std::make_pair(oldHashes[y], y));
+	}
+	std::sort(oldRows.begin(), oldRows.end());
+
+	std::vector<int> votes(height * 2, 0);
+	typedef std::vector<std::pair<unsigned int, int> >::iterator Iterator;
+	for(int y = 0; y < height; y++) {
+		if(y > 0 && newHashes[y] == newHashes[y - 1])
+			continue;
+		std::pair<Iterator, Iterator> range = std::equal_range(oldRows.begin(), oldRows.end(), std::make_pair(newHashes[y], -1), compareRowHash);
+		// repeated rows such as list items match everywhere, they don't tell the offset
+		if(range.second - range.first > 4)
+			continue;
+		for(Iterator it = range.first; it != range.second; it++)
+			votes[y - it->second + height]++;
+	}
+
+	int best = 0;
+	for(int dy = 1 - height; dy < height; dy++) {
+		if(votes[dy + height] > votes[best + height])
+			best = dy;
+	}
+	if(votes[best + height] < AWE_SCROLL_MIN_SIZE / 4)
+		return 0;
+	return best;
+}
+
+// looks for a vertical move of the dirty area's content, the rows the move
+// does not account for become the dirty rects. Rows are compared byte wise
+// before they count as moved since hashes may collide.
+static bool detectScroll(WebViewState* state, const RenderBuffer* renderBuffer, const RectC& dirty) {
+	int shadowRowSpan = state->scrollShadowWidth * 4;
+	std::vector<unsigned int> oldHashes(dirty.height), newHashes(dirty.height);
+	for(int y = 0; y < dirty.height; y++) {
+		oldHashes[y] = hashRow(&state->scrollShadow[(dirty.y + y) * shadowRowSpan + dirty.x * 4], dirty.width);
+		newHashes[y] = hashRow(renderBuffer->buffer + (dirty.y + y) * renderBuffer->rowSpan + dirty.x * 4, dirty.width);
+	}
+	int dy = findScrollOffset(oldHashes, newHashes);
+	if(dy == 0)
+		return false;
+
+	std::vector<RectC> residual;
+	int exposedRows = 0;
+	int runStart = -1;
+	for(int y = 0; y <= dirty.height; y++) {
+		bool covered = false;
+		if(y < dirty.height && y - dy >= 0 && y - dy < dirty.height && newHashes[y] == oldHashes[y - dy]) {
+			covered = memcmp(renderBuffer->buffer + (dirty.y + y) * renderBuffer->rowSpan + dirty.x * 4,
+				&state->scrollShadow[(dirty.y + y - dy) * shadowRowSpan + dirty.x * 4], dirty.width * 4) == 0;
+		}
+		if(!covered && y < dirty.height && runStart < 0)
+			runStart = y;
+		if((covered || y == dirty.height) && runStart >= 0) {
+			residual.push_back(makeRect(dirty.x, dirty.y + runStart, dirty.width, y - runStart));
+			exposedRows += y - runStart;
+			runStart = -1;
+		}
+	}
+	// not worth a blit when most of the area has to be uploaded anyway
+	if(exposedRows * 4 > dirty.height * 3)
+		return false;
+
+	state->scrollDY = dy;
+	state->scrollClip = dirty;
+	state->dirtyRects.swap(residual);
+	return true;
+}
+
+static void updateScrollShadow(WebViewState* state, const RenderBuffer* renderBuffer, const RectC& dirty) {
+	int width = renderBuffer->width;
+	int height = renderBuffer->height;
+	int shadowRowSpan = width * 4;
+	state->scrolled = false;
+	if(state->scrollShadowWidth != width || state->scrollShadowHeight != height) {
+		state->scrollShadow.resize(shadowRowSpan * height);
+		state->scrollShadowWidth = width;
+		state->scrollShadowHeight = height;
+		for(int y = 0; y < height; y++)
+			memcpy(&state->scrollShadow[y * shadowRowSpan], renderBuffer->buffer + y * renderBuffer->rowSpan, shadowRowSpan);
+		return;
+	}
+	if(dirty.width >= AWE_SCROLL_MIN_SIZE && dirty.height >= AWE_SCROLL_MIN_SIZE)
+		state->scrolled = detectScroll(state, renderBuffer, dirty);
+	for(int y = dirty.y; y < dirty.y + dirty.height; y++)
+		memcpy(&state->scrollShadow[y * shadowRowSpan + dirty.x * 4], renderBuffer->buffer + y * renderBuffer->rowSpan + dirty.x * 4, dirty.width * 4);
+}
+
+static void unionRect(RectC* rect, const RectC& other) {
+	if(other.width == 0 || other.height == 0)
+		return;
+	if(rect->width == 0 || rect->height == 0) {
+		*rect = other;
+		return;
+	}
+	int x1 = rect->x + rect->width > other.x + other.width?rect->x + rect->width:other.x + other.width;
+	int y1 = rect->y + rect->height > other.y + other.height?rect->y + rect->height:other.y + other.height;
+	rect->x = rect->x < other.x?rect->x:other.x;
+	rect->y = rect->y < other.y?rect->y:other.y;
+	rect->width = x1 - rect->x;
+	rect->height = y1 - rect->y;
+}
+
+// copies the dirty rects of the last render into the caller owned target
+static void writeRenderTarget(WebViewState* state, const RenderBuffer* renderBuffer) {
+	RenderBuffer* target = state->target;
+	if(state->targetNeedsFullCopy) {
+		state->dirtyRects.clear();
+		state->dirtyRects.push_back(makeRect(0, 0, renderBuffer->width, renderBuffer->height));
+		state->targetNeedsFullCopy = false;
+	} else if(state->scrolled) {
+		RectC clip;
+		const RectC& scrollClip = state->scrollClip;
+		if(clipRect(Rect(scrollClip.x, scrollClip.y, scrollClip.width, scrollClip.height), target->width, target->height, &clip)) {
+			target->scrollArea(0, state->scrollDY, Rect(clip.x, clip.y, clip.width, clip.height));
+			unionRect(&state->targetBounds, clip);
+			state->targetUpdated = true;
+		}
+	}
+	for(size_t i = 0; i < state->dirtyRects.size(); i++) {
+		RectC rect;
+		const RectC& dirty = state->dirtyRects[i];
+		if(!clipRect(Rect(dirty.x, dirty.y, dirty.width, dirty.height), target->width, target->height, &rect))
+			continue;
+		Rect area(rect.x, rect.y, rect.width, rect.height);
+		target->copyArea(*renderBuffer, area, area);
+		unionRect(&state->targetBounds, rect);
+		state->targetUpdated = true;
+	}
+}
+
+// frames larger than the ring's maximum size are cropped
+static void writeSharedFrame(SharedFrameWriter* writer, const RenderBuffer* renderBuffer, const RectC& dirty) {
+	SharedFramesHeaderC* header = writer->header;
+	int width = renderBuffer->width < (int)header->maxWidth?renderBuffer->width:header->maxWidth;
+	int height = renderBuffer->height < (int)header->maxHeight?renderBuffer->height:header->maxHeight;
+	for(size_t i = 0; i < writer->pending.size(); i++)
+		unionRect(&writer->pending[i], dirty);
+
+	int slotIndex = writer->nextSlot;
+	writer->nextSlot = (writer->nextSlot + 1) % header->slotCount;
+	SharedFrameSlotC& slot = writer->slots[slotIndex];
+	LONG frameNumber = ++writer->frameNumber;
+	InterlockedExchange(&slot.sequence, frameNumber * 2 - 1);
+
+	RectC& pending = writer->pending[slotIndex];
+	if((int)slot.width != width || (int)slot.height != height) {
+		slot.width = width;
+		slot.height = height;
+		slot.rowSpan = width * 4;
+		pending = makeRect(0, 0, width, height);
+	}
+	RectC area;
+	unsigned char* pixels = writer->base + header->dataOffset + (size_t)slotIndex * header->slotSize;
+	if(clipRect(Rect(pending.x, pending.y, pending.width, pending.height), width, height, &area)) {
+		for(int y = area.y; y < area.y + area.height; y++)
+			memcpy(pixels + y * slot.rowSpan + area.x * 4, renderBuffer->buffer + y * renderBuffer->rowSpan + area.x * 4, area.width * 4);
+	}
+	pending = makeRect(0, 0, 0, 0);
+	clipRect(Rect(dirty.x, dirty.y, dirty.width, dirty.height), width, height, &area);
+	slot.dirtyX = area.x;
+	slot.dirtyY = area.y;
+	slot.dirtyWidth = area.width;
+	slot.dirtyHeight = area.height;
+
+	InterlockedExchange(&slot.sequence, frameNumber * 2);
+	InterlockedExchange(&header->latestSlot, slotIndex);
+}
+
+// renders the WebView and updates the wrapper side dirty state
+static const RenderBuffer* renderWebView(WebViewState* state, RectC* dirty) {
+	AWE_STATS_SCOPE("WebView::render", state->webView);
+	// the dirty bounds are reset by render(), so fetch them first
+	Rect bounds = state->webView->getDirtyBounds();
+	const RenderBuffer* renderBuffer = state->webView->render();
+	state->renderBuffer = renderBuffer;
+	if(!renderBuffer) {
+		*dirty = makeRect(0, 0, 0, 0);
+		state->dirtyRects.clear();
+		return 0;
+	}
+
+	// clip against the buffer, the bounds may still refer to the old size after a resize
+	clipRect(bounds, renderBuffer->width, renderBuffer->height, dirty);
+	if(state->damageTracking) {
+		trackDamage(state->shadow, renderBuffer->buffer, renderBuffer->width, renderBuffer->height, renderBuffer->rowSpan, *dirty, state->dirtyRects);
+	} else {
+		state->dirtyRects.clear();
+		if(dirty->width > 0)
+			state->dirtyRects.push_back(*dirty);
+	}
+	if(state->scrollDetection)
+		updateScrollShadow(state, renderBuffer, *dirty);
+	if(state->target)
+		writeRenderTarget(state, renderBuffer);
+	if(state->sharedFrames)
+		writeSharedFrame(state->sharedFrames, renderBuffer, *dirty);
+	return renderBuffer;
+}
+
+static void publishFrame(WebViewState* state, const RenderBuffer* renderBuffer, const RectC& dirty) {
+	for(int i = 0; i < AWE_FRAME_COUNT; i++)
+		unionRect(&state->frames[i].pending, dirty);
+
+	FrameSlot& slot = state->frames[state->backFrame];
+	if(slot.width != renderBuffer->width || slot.height != renderBuffer->height) {
+		slot.width = renderBuffer->width;
+		slot.height = renderBuffer->height;
+		slot.pixels.resize(slot.width * slot.height * 4);
+		slot.pending = makeRect(0, 0, slot.width, slot.height);
+	}
+	// the slot still holds the frame from two publishes ago, only bring the changed area up to date
+	RectC area;
+	if(clipRect(Rect(slot.pending.x, slot.pending.y, slot.pending.width, slot.pending.height), slot.width, slot.height, &area)) {
+		for(int y = area.y; y < area.y + area.height; y++)
+			memcpy(&slot.pixels[(y * slot.width + area.x) * 4], renderBuffer->buffer + y * renderBuffer->rowSpan + area.x * 4, area.width * 4);
+	}
+	slot.pending = makeRect(0, 0, 0, 0);
+	slot.frameNumber = ++state->frameCount;
+	state->backFrame = InterlockedExchange(&state->readyFrame, state->backFrame | AWE_FRAME_FRESH) & (AWE_FRAME_FRESH - 1);
+}
+
+static LONGLONG getTicks() {
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return ticks.QuadPart;
+}
+
+static LONGLONG getTicksPerSecond() {
+	static LONGLONG ticksPerSecond = 0;
+	if(!ticksPerSecond) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		ticksPerSecond = frequency.QuadPart;
+	}
+	return ticksPerSecond;
+}
+
+// hidden and occluded views are skipped, visible ones once their frame budget has passed
+static bool isRenderDue(WebViewState* state, LONGLONG now) {
+	if(state->visibility != AWE_VISIBILITY_VISIBLE)
+		return false;
+	if(state->maxFps > 0 && state->lastRenderTicks && now - state->lastRenderTicks < getTicksPerSecond() / state->maxFps)
+		return false;
+	return true;
+}
+
+// sizes requested while the previous resize is still waiting for its repaint,
+// or within the debounce time, are replaced by later ones and never applied
+static void applyPendingResize(WebViewState* state, LONGLONG now) {
+	if(!state->resizePending || state->resizeApplied)
+		return;
+	if(state->lastResizeTicks && now - state->lastResizeTicks < getTicksPerSecond() * state->resizeDebounceMS / 1000)
+		return;
+	state->resizePending = false;
+	state->resizeApplied = true;
+	state->lastResizeTicks = now;
+	state->appliedWidth = state->resizeWidth;
+	state->appliedHeight = state->resizeHeight;
+	state->width = state->appliedWidth;
+	state->height = state->appliedHeight;
+	recordTrace(AWE_TRACE_RESIZE, state->webView, state->appliedWidth, state->appliedHeight);
+	state->webView->resize(state->appliedWidth, state->appliedHeight, false, 0);
+}
+
+// the wrapper side copies keep their capacity, so resizing below the maximum
+// size never reallocates the ones in use
+static void reserveResizeCapacity(WebViewState* state) {
+	size_t capacity = (size_t)state->maxResizeWidth * state->maxResizeHeight * 4;
+	if(!capacity)
+		return;
+	if(state->damageTracking)
+		state->shadow.pixels.reserve(capacity);
+	if(state->scrollDetection)
+		state->scrollShadow.reserve(capacity);
+	for(int i = 0; i < AWE_FRAME_COUNT; i++)
+		state->frames[i].pixels.reserve(capacity);
+}
+
+static bool isResizeComplete(WebViewState* state) {
+	if(!state->resizeApplied || state->webView->isResizing())
+		return false;
+	state->resizeApplied = false;
+	return true;
+}
+
+// the callback may create or destroy views, so it is called once iterating webViewStates is done
+static void notifyResizeComplete(WebView* webView) {
+	std::map<WebView*, WebViewState*>::iterator it = webViewStates.find(webView);
+	if(it == webViewStates.end())
+		return;
+	WebViewState* state = it->second;
+	if(state->resizeCallback)
+		state->resizeCallback(state->webView, state->appliedWidth, state->appliedHeight, state->resizeCallbackUserData);
+}
+
+static void updateWebCore(WebCore* webCore, bool publishFrames) {
+	AWE_STATS_SCOPE("awe_WebCore_update", 0);
+	recordTrace(AWE_TRACE_UPDATE, 0, 0, 0);
+	drainCommandQueue();
+	LONGLONG now = getTicks();
+	for(std::map<WebView*, WebViewState*>::iterator it = webViewStates.begin(); it != webViewStates.end(); it++) {
+		flushScriptBatches(it->second);
+		applyPendingResize(it->second, now);
+	}
+	webCore->update();
+
+	// render views with a registered target straight into the target, the
+	// update thread renders every view to publish its frames
+	now = getTicks();
+	std::vector<WebView*> resized;
+	for(std::map<WebView*, WebViewState*>::iterator it = webViewStates.begin(); it != webViewStates.end(); it++) {
+		WebViewState* state = it->second;
+		if(isResizeComplete(state))
+			resized.push_back(state->webView);
+		if(!state->target && !state->sharedFrames && !publishFrames)
+			continue;
+		state->targetUpdated = false;
+		state->targetBounds = makeRect(0, 0, 0, 0);
+		if(!isRenderDue(state, now))
+			continue;
+		bool firstFrame = publishFrames && state->frameCount == 0;
+		if(state->targetNeedsFullCopy || state->webView->isDirty() || firstFrame) {
+			state->lastRenderTicks = now;
+			RectC dirty;
+			const RenderBuffer* renderBuffer = renderWebView(state, &dirty);
+			if(publishFrames && renderBuffer)
+				publishFrame(state, renderBuffer, dirty);
+		}
+	}
+	for(size_t i = 0; i < resized.size(); i++)
+		notifyResizeComplete(resized[i]);
+}
+
+/*-----------------------------------------------------------------------------
+  Update thread. Awesomium requires WebCore to be used from the thread that
+  created it, so the update thread constructs the deferred WebCore itself and
+  is the only thread calling into it until awe_WebCore_delete stops it. It
+  creates the deferred views, runs the posted commands and renders every view
+  into its frames at a fixed rate, so all listener and wrapper callbacks fire
+  on it. The host thread only posts and acquires frames.
+-----------------------------------------------------------------------------*/
+static HANDLE updateThread = 0;
+static HANDLE updateStarted = 0;
+static volatile DWORD updateThreadId = 0;
+static volatile LONG updateThreadRunning = 0;
+static int updateInterval = 16;
+
+// true on any thread but the update thread while it runs, those may only post
+static bool isOffUpdateThread() {
+	return updateThreadId && GetCurrentThreadId() != updateThreadId;
+}
+
+static void stopUpdateThread() {
+	if(!updateThread)
+		return;
+	InterlockedExchange(&updateThreadRunning, 0);
+	WaitForSingleObject(updateThread, INFINITE);
+	CloseHandle(updateThread);
+	updateThread = 0;
+}
+
+/*-----------------------------------------------------------------------------
+  Trace recording, the exports write their calls to the trace opened with
+  awe_Trace_start (see awesomiumc_trace.h). While no trace is open recording
+  is a single check of traceFile.
+-----------------------------------------------------------------------------*/
+#define AWE_TRACE_BUFFER_SIZE (256 * 1024)
+
+static FILE* volatile traceFile = 0;
+static StaticLock traceLock;
+static LONGLONG traceStartTicks = 0;
+static unsigned long long traceMicros = 0;
+static std::map<WebView*, unsigned short> traceViewIds;
+static unsigned short nextTraceViewId = 1;
+
+// called with traceLock held
+static void writeTraceRecord(int type, unsigned short viewId, int a, int b, const void* payload, size_t payloadSize, const void* extra, size_t extraSize) {
+	unsigned long long micros = (unsigned long long)(getTicks() - traceStartTicks) * 1000000 / getTicksPerSecond();
+	TraceRecordC record;
+	record.type = (unsigned short)type;
+	record.viewId = viewId;
+	record.delta = (unsigned int)(micros - traceMicros);
+	record.a = a;
+	record.b = b;
+	record.payloadSize = (unsigned int)(payloadSize + extraSize);
+	traceMicros = micros;
+	fwrite(&record, sizeof(TraceRecordC), 1, traceFile);
+	if(payloadSize)
+		fwrite(payload, 1, payloadSize, traceFile);
+	if(extraSize)
+		fwrite(extra, 1, extraSize, traceFile);
+}
+
+// called with traceLock held, views created before awe_Trace_start get their
+// CREATE_VIEW record with the size of their last render on first use
+static unsigned short getTraceViewId(WebView* webView, int width, int height) {
+	std::map<WebView*, unsigned short>::iterator it = traceViewIds.find(webView);
+	if(it != traceViewIds.end())
+		return it->second;
+	std::map<WebView*, WebViewState*>::iterator state = webViewStates.find(webView);
+	if(width == 0 && state != webViewStates.end() && state->second->renderBuffer) {
+		width = state->second->renderBuffer->width;
+		height = state->second->renderBuffer->height;
+	}
+	unsigned short viewId = nextTraceViewId++;
+	traceViewIds[webView] = viewId;
+	writeTraceRecord(AWE_TRACE_CREATE_VIEW, viewId, width, height, 0, 0, 0, 0);
+	return viewId;
+}
+
+static void recordTrace(int type, WebView* webView, int a, int b, const void* payload, size_t payloadSize, const void* extra, size_t extraSize) {
+	if(!traceFile)
+		return;
+	EnterCriticalSection(&traceLock.lock);
+	if(traceFile) {
+		unsigned short viewId = webView?getTraceViewId(webView, 0, 0):0;
+		writeTraceRecord(type, viewId, a, b, payload, payloadSize, extra, extraSize);
+		if(type == AWE_TRACE_DESTROY_VIEW)
+			traceViewIds.erase(webView);
+	}
+	LeaveCriticalSection(&traceLock.lock);
+}
+
+static void recordTrace(int type, WebView* webView, int a, int b) {
+	recordTrace(type, webView, a, b, 0, 0, 0, 0);
+}
+
+static void traceCreateView(WebView* webView, int width, int height) {
+	if(!traceFile)
+		return;
+	EnterCriticalSection(&traceLock.lock);
+	if(traceFile)
+		getTraceViewId(webView, width, height);
+	LeaveCriticalSection(&traceLock.lock);
+}
+
+template<class C>
+static void traceText(int type, WebView* webView, const C* text, size_t length, const wchar_t* frameName, int b) {
+	if(!traceFile)
+		return;
+	size_t frameNameLength = frameName?wcslen(frameName):0;
+	recordTrace(type, webView, (int)(length * sizeof(C)), b, text, length * sizeof(C), frameName, frameNameLength * sizeof(wchar_t));
+}
+
+static void traceNames(int type, WebView* webView, int a, const wchar_t* objectName, const wchar_t* callbackName) {
+	if(!traceFile)
+		return;
+	std::wstring names(objectName);
+	names.push_back(0);
+	names += callbackName;
+	recordTrace(type, webView, a, 0, names.c_str(), names.size() * sizeof(wchar_t), 0, 0);
+}
+
+static void traceCallback(WebView* caller, const std::wstring& objectName, const std::wstring& callbackName, int argumentCount) {
+	traceNames(AWE_TRACE_CALLBACK, caller, argumentCount, objectName.c_str(), callbackName.c_str());
+}
+
+EXPORT int awe_Trace_start(const wchar_t* filePath) {
+	awe_Trace_stop();
+	FILE* file = _wfopen(filePath, L"wb");
+	if(!file)
+		return 0;
+	setvbuf(file, 0, _IOFBF, AWE_TRACE_BUFFER_SIZE);
+	TraceHeaderC header;
+	memset(&header, 0, sizeof(TraceHeaderC));
+	header.magic = AWE_TRACE_MAGIC;
+	header.version = AWE_TRACE_VERSION;
+	fwrite(&header, sizeof(TraceHeaderC), 1, file);
+
+	EnterCriticalSection(&traceLock.lock);
+	traceStartTicks = getTicks();
+	traceMicros = 0;
+	traceViewIds.clear();
+	nextTraceViewId = 1;
+	traceFile = file;
+	LeaveCriticalSection(&traceLock.lock);
+	return -1;
+}
+
+EXPORT void awe_Trace_stop() {
+	EnterCriticalSection(&traceLock.lock);
+	FILE* file = traceFile;
+	traceFile = 0;
+	traceViewIds.clear();
+	LeaveCriticalSection(&traceLock.lock);
+	if(file)
+		fclose(file);
+}
+
+EXPORT int awe_Trace_isRecording() {
+	return traceFile?-1:0;
+}
+
 /*-----------------------------------------------------------------------------
   WebCore API
 -----------------------------------------------------------------------------*/
@@ -158,6 +1824,60 @@ EXPORT WebCoreC awe_WebCore_newWithPlugins(const wchar_t* pluginPath) {
 	return webCore;
 }
 
+// set with awe_WebCore_setSkipPluginScan
+static bool skipPluginScan = false;
+
+// copies of the awe_WebCore_newFromConfig arguments, outlive the call when the WebCore is deferred
+struct WebCoreSettings {
+	bool enablePlugins;
+	bool enableJavascript;
+	std::wstring userDataPath;
+	std::wstring pluginPath;
+	std::wstring logPath;
+	int logLevel;
+	std::string userAgentOverride;
+	std::string proxyServer;
+	std::string proxyConfig;
+	bool saveCacheAndCookies;
+	int maxCacheSize;
+	bool disableSameOriginPolicy;
+	std::string customCss;
+
+	WebCoreSettings(int enablePlugins, int enableJavascript, const wchar_t* userDataPath, const wchar_t* pluginPath, const wchar_t* logPath, int logLevel,
+		const char* userAgentOverride, const char* proxyServer, const char* proxyConfig, int saveCacheAndCookies, int maxCacheSize, int disableSameOriginPolicy, const char* customCss)
+		: userDataPath(copyString(userDataPath)), logPath(copyString(logPath)), userAgentOverride(copyString(userAgentOverride)), 
+		  proxyServer(copyString(proxyServer)), proxyConfig(copyString(proxyConfig)), customCss(copyString(customCss)) {
+		this->enablePlugins = enablePlugins?true:false;
+		this->enableJavascript = enableJavascript?true:false;
+		// without plugins the plugin directory is only worth scanning if the host wants it
+		if(this->enablePlugins || !skipPluginScan)
+			this->pluginPath = copyString(pluginPath);
+		this->logLevel = logLevel;
+		this->saveCacheAndCookies = saveCacheAndCookies?true:false;
+		this->maxCacheSize = maxCacheSize;
+		this->disableSameOriginPolicy = disableSameOriginPolicy?true:false;
+	}
+};
+
+static WebCore* createWebCore(const WebCoreSettings& settings) {
+	WebCoreConfig config;
+	config.setEnablePlugins(settings.enablePlugins);
+	config.setEnableJavascript(settings.enableJavascript);
+	config.setUserDataPath(settings.userDataPath);
+	config.setPluginPath(settings.pluginPath);
+	config.setLogPath(settings.logPath);
+	if(settings.logLevel >= AWE_LOG_NONE && settings.logLevel <= AWE_LOG_VERBOSE)
+		config.setLogLevel((LogLevel)settings.logLevel);
+	config.setUserAgentOverride(settings.userAgentOverride);
+	config.setProxyServer(settings.proxyServer);
+	config.setProxyConfigScript(settings.proxyConfig);
+	config.setSaveCacheAndCookies(settings.saveCacheAndCookies);
+	config.setMaxCacheSize(settings.maxCacheSize);
+	config.setDisableSameOriginPolicy(settings.disableSameOriginPolicy);
+	config.setCustomCSS(settings.customCss);
+	return new WebCore(config);
+}
+
 EXPORT WebCoreC awe_WebCore_newFromConfig( int enablePlugins, 
 										   int enableJavascript, 
 										   const wchar_t* userDataPath, 
@@ -171,24 +1891,176 @@ EXPORT WebCoreC awe_WebCore_newFromConfig( int enablePlugins,
 										   int maxCacheSize, 
 										   int disableSameOriginPolicy, 
 										   const char* customCss) {
-	WebCoreConfig config;
-	config.setEnablePlugins(enablePlugins?true:false);
-	config.setEnableJavascript(enableJavascript?true:false);
-	config.setUserDataPath(std::wstring(userDataPath));
-	config.setPluginPath(std::wstring(pluginPath));
-	config.setLogPath(std::wstring(logPath));
-	config.setUserAgentOverride(std::string(userAgentOverride));
-	config.setProxyServer(std::string(proxyServer));
-	config.setSaveCacheAndCookies(saveCacheAndCookies?true:false);
-	config.setMaxCacheSize(maxCacheSize);
-	config.setDisableSameOriginPolicy(disableSameOriginPolicy?true:false);
-	config.setCustomCSS(std::string(customCss));
-	return new WebCore(config);
+	WebCoreSettings settings(enablePlugins, enableJavascript, userDataPath, pluginPath, logPath, logLevel, userAgentOverride, proxyServer,
+		proxyConfig, saveCacheAndCookies, maxCacheSize, disableSameOriginPolicy, customCss);
+	return createWebCore(settings);
+}
+
+EXPORT void awe_WebCore_setSkipPluginScan(int skip) {
+	skipPluginScan = skip?true:false;
+}
+
+/*-----------------------------------------------------------------------------
+  Deferred startup. Awesomium requires WebCore to be used from the thread that
+  created it, so there is no background initialization: 
+  awe_WebCore_newFromConfigDeferred only copies the settings and the host calls
+  awe_WebCore_runDeferred from its own loop once the UI is up. The first call
+  constructs the WebCore (ICU, plugin scan and cache setup), later calls
+  create the views requested with awe_WebCore_createWebViewDeferred, in order,
+  as many per call as fit in its timeout. Child processes are only spawned
+  once a view is created.
+-----------------------------------------------------------------------------*/
+struct DeferredWebView {
+	int width;
+	int height;
+	std::string url;
+	DeferredWebViewCallbackC callback;
+	void* userData;
+};
+
+static WebCoreSettings* deferredSettings = 0;
+static WebCore* deferredWebCore = 0;
+static bool deferredPending = false;
+static std::list<DeferredWebView> deferredWebViews;
+
+static void createDeferredWebView(WebCore* webCore, const DeferredWebView& deferred) {
+	WebViewC webView = awe_WebCore_createWebView(webCore, deferred.width, deferred.height);
+	// the listener is usually set from the callback, load afterwards so no event is missed
+	if(deferred.callback)
+		deferred.callback(webView, deferred.userData);
+	if(!deferred.url.empty())
+		static_cast<WebView*> (webView)->loadURL(deferred.url, std::wstring(), std::string(), std::string());
+}
+
+EXPORT int awe_WebCore_newFromConfigDeferred(int enablePlugins, 
+										  int enableJavascript, 
+										  const wchar_t* userDataPath, 
+										  const wchar_t* pluginPath, 
+										  const wchar_t* logPath, 
+										  int logLevel, 
+										  const char* userAgentOverride, 
+										  const char* proxyServer, 
+										  const char* proxyConfig, 
+										  int saveCacheAndCookies, 
+										  int maxCacheSize, 
+										  int disableSameOriginPolicy, 
+										  const char* customCss) {
+	if(deferredPending || WebCore::GetPointer())
+		return 0;
+	deferredSettings = new WebCoreSettings(enablePlugins, enableJavascript, userDataPath, pluginPath, logPath, logLevel, userAgentOverride, 
+		proxyServer, proxyConfig, saveCacheAndCookies, maxCacheSize, disableSameOriginPolicy, customCss);
+	deferredPending = true;
+	return -1;
+}
+
+// returns 0 until the WebCore exists and no deferred views are queued, constructing the WebCore
+// takes a call of its own, views are created for at most timeoutMS (at least one per call)
+static WebCore* runDeferred(int timeoutMS) {
+	if(!deferredPending)
+		return deferredWebCore;
+	if(!deferredWebCore) {
+		deferredWebCore = createWebCore(*deferredSettings);
+		delete deferredSettings;
+		deferredSettings = 0;
+		logMessage(AWE_LOG_VERBOSE, "deferred WebCore created");
+		if(!deferredWebViews.empty())
+			return 0;
+	}
+	LONGLONG start = getTicks();
+	// callbacks may defer more views, those are queued behind the current ones
+	while(!deferredWebViews.empty()) {
+		DeferredWebView deferred = deferredWebViews.front();
+		deferredWebViews.pop_front();
+		createDeferredWebView(deferredWebCore, deferred);
+		if(!deferredWebViews.empty() && timeoutMS >= 0 && (getTicks() - start) * 1000 / getTicksPerSecond() >= timeoutMS)
+			return 0;
+	}
+	deferredPending = false;
+	logMessage(AWE_LOG_VERBOSE, "deferred views created");
+	return deferredWebCore;
+}
+
+// returns 0 while the update thread runs the deferred startup
+EXPORT WebCoreC awe_WebCore_runDeferred(int timeoutMS) {
+	if(updateThreadId)
+		return 0;
+	return runDeferred(timeoutMS);
+}
+
+// queued until awe_WebCore_runDeferred gets to it while startup is deferred, returns 0 if there is no WebCore
+EXPORT int awe_WebCore_createWebViewDeferred(int width, int height, const char* url, DeferredWebViewCallbackC callback, void* userData) {
+	if(isOffUpdateThread()) {
+		WebViewCommand* command = new WebViewCommand(0, AWE_COMMAND_CREATE_VIEW);
+		command->x = width;
+		command->y = height;
+		command->string = copyString(url);
+		command->viewCallback = callback;
+		command->userData = userData;
+		postCommand(command);
+		return -1;
+	}
+	WebCore* webCore = WebCore::GetPointer();
+	if(!webCore && !deferredPending) {
+		logMessage(AWE_LOG_NORMAL, "awe_WebCore_createWebViewDeferred called without a WebCore");
+		return 0;
+	}
+	DeferredWebView deferred;
+	deferred.width = width;
+	deferred.height = height;
+	deferred.url = copyString(url);
+	deferred.callback = callback;
+	deferred.userData = userData;
+	if(deferredPending)
+		deferredWebViews.push_back(deferred);
+	else
+		createDeferredWebView(webCore, deferred);
+	return -1;
+}
+
+static void deleteWebCore(WebCore* ptr) {
+	if(ptr == deferredWebCore) {
+		deferredWebCore = 0;
+		deferredPending = false;
+		deferredWebViews.clear();
+	}
+	cancelAllPendingScripts();
+	delete ptr;
+	deleteAllWebViewStates();
+	// no WebViews left, this just frees commands still queued
+	drainCommandQueue();
+	awe_Trace_stop();
+}
+
+static DWORD WINAPI updateThreadMain(LPVOID param) {
+	updateThreadId = GetCurrentThreadId();
+	WebCore* webCore = runDeferred(0);
+	if(!webCore)
+		webCore = deferredWebCore;
+	SetEvent(updateStarted);
+	LARGE_INTEGER frequency, start, end;
+	QueryPerformanceFrequency(&frequency);
+	while(updateThreadRunning) {
+		QueryPerformanceCounter(&start);
+		runDeferred(updateInterval);
+		updateWebCore(webCore, true);
+		QueryPerformanceCounter(&end);
+		int elapsed = (int)((end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart);
+		int wait = updateInterval - elapsed;
+		Sleep(wait > 0?wait:0);
+	}
+	deleteWebCore(webCore);
+	updateThreadId = 0;
+	return 0;
 }
 
+// the update thread deletes its WebCore itself once it is stopped
 EXPORT void awe_WebCore_delete(WebCoreC webCore) {
 	WebCore* ptr = static_cast<WebCore*> (webCore);
-	delete ptr;
+	if(updateThread && ptr == deferredWebCore) {
+		stopUpdateThread();
+		return;
+	}
+	deleteWebCore(ptr);
 }
 
 EXPORT void awe_WebCore_setBaseDirectory(WebCoreC webCore, const char* baseDirectory) {
@@ -203,7 +2075,18 @@ EXPORT void awe_WebCore_setBaseDirectoryW(WebCoreC webCore, const wchar_t* baseD
 
 EXPORT WebViewC awe_WebCore_createWebView(WebCoreC webCore, int width, int height) {
 	WebCore* ptr = static_cast<WebCore*> (webCore);
-	return ptr->createWebView(width, height);	
+	if(isOffUpdateThread()) {
+		logMessage(AWE_LOG_NORMAL, "awe_WebCore_createWebView called off the update thread, use awe_WebCore_createWebViewDeferred");
+		return 0;
+	}
+	WebView* webView = ptr->createWebView(width, height);
+	traceCreateView(webView, width, height);
+	WebViewState* state = getWebViewState(webView);
+	state->width = width;
+	state->height = height;
+	state->interceptor = new ResourceInterceptorImpl();
+	webView->setResourceInterceptor(state->interceptor);
+	return webView;
 }
 
 EXPORT void awe_WebCore_setCustomResponsePage(WebCoreC webCore, int statusCode, const wchar_t* filePath) {
@@ -213,7 +2096,97 @@ EXPORT void awe_WebCore_setCustomResponsePage(WebCoreC webCore, int statusCode,
 
 EXPORT void awe_WebCore_update(WebCoreC webCore) {
 	WebCore* ptr = static_cast<WebCore*> (webCore);
-	ptr->update();
+	// the update thread owns updating while it runs
+	if(updateThreadId)
+		return;
+	updateWebCore(ptr, false);
+}
+
+static WebView* renderCursor = 0;
+
+static bool hasHigherRenderPriority(const WebViewState* a, const WebViewState* b) {
+	return a->renderPriority > b->renderPriority;
+}
+
+EXPORT int awe_WebCore_renderDirtyViews(WebCoreC webCore, int budgetMS, WebViewC* renderedViews, int maxRenderedViews) {
+	AWE_STATS_SCOPE("awe_WebCore_renderDirtyViews", 0);
+	// the update thread renders every view itself
+	if(updateThreadId || webViewStates.empty())
+		return 0;
+
+	// collect dirty views round robin starting after the last one rendered so
+	// the views at the end don't starve when the budget runs out
+	LONGLONG start = getTicks();
+	std::vector<WebViewState*> candidates;
+	std::map<WebView*, WebViewState*>::iterator it = webViewStates.upper_bound(renderCursor);
+	for(size_t i = 0; i < webViewStates.size(); i++, it++) {
+		if(it == webViewStates.end())
+			it = webViewStates.begin();
+		if(isRenderDue(it->second, start) && it->second->webView->isDirty())
+			candidates.push_back(it->second);
+	}
+	std::stable_sort(candidates.begin(), candidates.end(), hasHigherRenderPriority);
+
+	// always render at least one view so a small budget still makes progress
+	LONGLONG deadline = start + getTicksPerSecond() * budgetMS / 1000;
+	int count = 0;
+	for(size_t i = 0; i < candidates.size(); i++) {
+		if(renderedViews && count >= maxRenderedViews)
+			break;
+		LONGLONG now = getTicks();
+		if(count > 0 && budgetMS > 0 && now >= deadline)
+			break;
+		WebViewState* state = candidates[i];
+		state->lastRenderTicks = now;
+		state->targetUpdated = false;
+		state->targetBounds = makeRect(0, 0, 0, 0);
+		RectC dirty;
+		if(!renderWebView(state, &dirty))
+			continue;
+		renderCursor = state->webView;
+		if(renderedViews)
+			renderedViews[count] = state->webView;
+		count++;
+	}
+	return count;
+}
+
+// constructs the WebCore set up with awe_WebCore_newFromConfigDeferred on the update thread, returns 0 if
+// startup isn't deferred or updatesPerSecond isn't positive, the handle may only be used to post
+EXPORT WebCoreC awe_WebCore_startUpdateThread(int updatesPerSecond) {
+	if(updateThread || !deferredSettings)
+		return 0;
+	if(updatesPerSecond <= 0) {
+		logMessage(AWE_LOG_NORMAL, "awe_WebCore_startUpdateThread needs a positive rate");
+		return 0;
+	}
+	updateInterval = updatesPerSecond < 1000?1000 / updatesPerSecond:1;
+	updateStarted = CreateEvent(0, TRUE, FALSE, 0);
+	updateThreadRunning = 1;
+	updateThread = CreateThread(0, 0, updateThreadMain, 0, 0, 0);
+	if(!updateThread) {
+		updateThreadRunning = 0;
+		CloseHandle(updateStarted);
+		updateStarted = 0;
+		return 0;
+	}
+	WaitForSingleObject(updateStarted, INFINITE);
+	CloseHandle(updateStarted);
+	updateStarted = 0;
+	return deferredWebCore;
+}
+
+EXPORT int awe_WebCore_isUpdateThreadRunning(WebCoreC webCore) {
+	return updateThread?-1:0;
+}
+
+EXPORT void awe_WebCore_postTask(TaskCallbackC callback, void* userData) {
+	if(!callback)
+		return;
+	WebViewCommand* command = new WebViewCommand(0, AWE_COMMAND_TASK);
+	command->task = callback;
+	command->userData = userData;
+	postCommand(command);
 }
 
 EXPORT const wchar_t* awe_WebCore_getBaseDirectory(WebCoreC webCore) {
@@ -252,8 +2225,11 @@ EXPORT const char* awe_WebCore_getCookies(WebCoreC webCore, const char* url, int
 -----------------------------------------------------------------------------*/
 EXPORT void awe_WebView_destroy(WebViewC webView) { 
 	WebView* ptr = static_cast<WebView*> (webView);	
+	recordTrace(AWE_TRACE_DESTROY_VIEW, ptr, 0, 0);
 	if(ptr->getListener())
 		delete ptr->getListener();
+	ptr->setResourceInterceptor(0);
+	deleteWebViewState(ptr);
 	ptr->destroy();
 }
 
@@ -264,6 +2240,33 @@ EXPORT void awe_WebView_setListener(WebViewC webView, const WebViewListenerC* we
 	ptr->setListener(new WebViewListenerImpl(webViewListener));
 }
 
+EXPORT void awe_WebView_setPackedCallback(WebViewC webView, PackedCallbackC callback, void* userData) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	// callbacks only arrive through a listener
+	if(!ptr->getListener())
+		ptr->setListener(new WebViewListenerImpl(0));
+	state->packedCallback = callback;
+	state->packedCallbackUserData = userData;
+}
+
+EXPORT void awe_WebView_setPageContentsChunking(WebViewC webView, int chunkSize, int encoding) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	state->contentsChunkSize = chunkSize > 0?chunkSize:AWE_CONTENTS_CHUNK_SIZE;
+	state->contentsEncoding = encoding;
+}
+
+EXPORT void awe_WebView_setPageContentsChunkCallback(WebViewC webView, PageContentsChunkCallbackC callback, void* userData) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	// page contents only arrive through a listener
+	if(!ptr->getListener())
+		ptr->setListener(new WebViewListenerImpl(0));
+	state->contentsCallback = callback;
+	state->contentsCallbackUserData = userData;
+}
+
 EXPORT WebViewListenerC* awe_WebView_getListener(WebViewC webView) {
 	WebView* ptr = static_cast<WebView*> (webView);
 	if(ptr->getListener())
@@ -272,105 +2275,338 @@ EXPORT WebViewListenerC* awe_WebView_getListener(WebViewC webView) {
 		return 0;	
 }
 
-EXPORT ResourceInterceptorC* awe_WebView_getResourceInterceptor(WebViewC webView) {
+EXPORT void awe_WebView_setUserData(WebViewC webView, void* userData) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	getWebViewState(ptr)->userData = userData;
+}
+
+EXPORT void* awe_WebView_getUserData(WebViewC webView) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(ptr);
+	return result != webViewStates.end()?result->second->userData:0;
+}
+
+EXPORT void awe_WebView_setResourceInterceptor(WebViewC webView, const ResourceInterceptorC* resourceInterceptor) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	if(!state->interceptor) {
+		state->interceptor = new ResourceInterceptorImpl();
+		ptr->setResourceInterceptor(state->interceptor);
+	}
+	state->interceptor->setFuncs(resourceInterceptor);
+}
+
+EXPORT ResourceInterceptorC* awe_WebView_getResourceInterceptor(WebViewC webView) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	if(state->interceptor)
+		return (ResourceInterceptorC*)state->interceptor->getFuncs();
+	else
+		return 0;
+}
+
+EXPORT void awe_WebView_loadURL(WebViewC webView, const char* url, const wchar_t* frameName, const char* username, const char* password) {
+	AWE_STATS_SCOPE("awe_WebView_loadURL", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	// FIXME
-	return 0;
+	traceText(AWE_TRACE_LOAD_URL, ptr, url, strlen(url), frameName);
+	ptr->loadURL(toString(0, url), internName(frameName), toString(1, username), toString(2, password));
 }
 
-EXPORT void awe_WebView_loadURL(WebViewC webView, const char* url, const wchar_t* frameName, const char* username, const char* password) {
+EXPORT void awe_WebView_loadURL_n(WebViewC webView, const char* url, int urlLength, const wchar_t* frameName, const char* username, const char* password) {
+	AWE_STATS_SCOPE("awe_WebView_loadURL_n", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->loadURL(std::string(url),std::wstring(frameName), std::string(username), std::string(password));	
+	traceText(AWE_TRACE_LOAD_URL, ptr, url, urlLength, frameName);
+	ptr->loadURL(toString(0, url, urlLength), internName(frameName), toString(1, username), toString(2, password));
 }
 
 EXPORT void awe_WebView_loadURLW(WebViewC webView, const wchar_t* url, const wchar_t* frameName, const char* username, const char* password) {
+	AWE_STATS_SCOPE("awe_WebView_loadURLW", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->loadURL(std::wstring(url), std::wstring(frameName), std::string(username), std::string(password));
+	traceText(AWE_TRACE_LOAD_URL_W, ptr, url, wcslen(url), frameName);
+	ptr->loadURL(toString(0, url), internName(frameName), toString(1, username), toString(2, password));
 }
 
 EXPORT void awe_WebView_loadHTML(WebViewC webView, const char* html, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_loadHTML", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	traceText(AWE_TRACE_LOAD_HTML, ptr, html, strlen(html), frameName);
+	ptr->loadHTML(toString(0, html), internName(frameName));
+}
+
+EXPORT void awe_WebView_loadHTML_n(WebViewC webView, const char* html, int htmlLength, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_loadHTML_n", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->loadHTML(std::string(html), std::wstring(frameName));
+	traceText(AWE_TRACE_LOAD_HTML, ptr, html, htmlLength, frameName);
+	ptr->loadHTML(toString(0, html, htmlLength), internName(frameName));
 }
 
 EXPORT void awe_WebView_loadHTMLW(WebViewC webView, const wchar_t* html, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_loadHTMLW", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->loadHTML(std::wstring(html), std::wstring(frameName));
+	traceText(AWE_TRACE_LOAD_HTML_W, ptr, html, wcslen(html), frameName);
+	ptr->loadHTML(toString(0, html), internName(frameName));
+}
+
+EXPORT void awe_WebView_loadHTMLW_n(WebViewC webView, const wchar_t* html, int htmlLength, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_loadHTMLW_n", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	traceText(AWE_TRACE_LOAD_HTML_W, ptr, html, htmlLength, frameName);
+	ptr->loadHTML(toString(0, html, htmlLength), internName(frameName));
 }
 
 EXPORT void awe_WebView_loadFile(WebViewC webView, const char* file, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_loadFile", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->loadFile(std::string(file), std::wstring(frameName));
+	traceText(AWE_TRACE_LOAD_FILE, ptr, file, strlen(file), frameName);
+	ptr->loadFile(toString(0, file), internName(frameName));
 }
 
 EXPORT void awe_WebView_goToHistoryOffset(WebViewC webView, int offset) {
 	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_GO_TO_HISTORY_OFFSET, ptr, offset, 0);
 	ptr->goToHistoryOffset(offset);
 }
 
 EXPORT void awe_WebView_stop(WebViewC webView) {
 	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_STOP, ptr, 0, 0);
 	ptr->stop();
 }
 
 EXPORT void awe_WebView_reload(WebViewC webView) {
 	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_RELOAD, ptr, 0, 0);
 	ptr->reload();
 }
 
 EXPORT void awe_WebView_executeJavascript(WebViewC webView, const char* javascript, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascript", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT, ptr, javascript, strlen(javascript), frameName);
+	ptr->executeJavascript(toString(0, javascript), internName(frameName));
+}
+
+EXPORT void awe_WebView_executeJavascript_n(WebViewC webView, const char* javascript, int javascriptLength, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascript_n", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->executeJavascript(std::string(javascript), std::wstring(frameName));
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT, ptr, javascript, javascriptLength, frameName);
+	ptr->executeJavascript(toString(0, javascript, javascriptLength), internName(frameName));
 }
 
 EXPORT void awe_WebView_executeJavascriptW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptW", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_W, ptr, javascript, wcslen(javascript), frameName);
+	ptr->executeJavascript(toString(0, javascript), internName(frameName));
+}
+
+EXPORT void awe_WebView_executeJavascriptW_n(WebViewC webView, const wchar_t* javascript, int javascriptLength, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptW_n", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->executeJavascript(std::wstring(javascript), std::wstring(frameName));
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_W, ptr, javascript, javascriptLength, frameName);
+	ptr->executeJavascript(toString(0, javascript, javascriptLength), internName(frameName));
 }
 
 EXPORT JSValueC awe_WebView_executeJavascriptWithResult(WebViewC webView, const char* javascript, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptWithResult", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	return (JSValueC)&(ptr->executeJavascriptWithResult(std::string(javascript), std::wstring(frameName)).get());
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT, ptr, javascript, strlen(javascript), frameName, -1);
+	return (JSValueC)&(ptr->executeJavascriptWithResult(toString(0, javascript), internName(frameName)).get());
 }
 
 EXPORT JSValueC awe_WebView_executeJavascriptWithResultTimeout(WebViewC webView, const char* javascript, const wchar_t* frameName, int timeoutMS) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptWithResultTimeout", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	return (JSValueC)&(ptr->executeJavascriptWithResult(std::string(javascript), std::wstring(frameName)).getWithTimeout(timeoutMS));
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT, ptr, javascript, strlen(javascript), frameName, timeoutMS);
+	return (JSValueC)&(ptr->executeJavascriptWithResult(toString(0, javascript), internName(frameName)).getWithTimeout(timeoutMS));
 }
 
 EXPORT JSValueC awe_WebView_executeJavascriptWithResultW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptWithResultW", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	return (JSValueC)&(ptr->executeJavascriptWithResult(std::wstring(javascript), std::wstring(frameName)).get());
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT_W, ptr, javascript, wcslen(javascript), frameName, -1);
+	return (JSValueC)&(ptr->executeJavascriptWithResult(toString(0, javascript), internName(frameName)).get());
 }
 
 EXPORT JSValueC awe_WebView_executeJavascriptWithResultTimeoutW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName, int timeoutMS) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptWithResultTimeoutW", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_RESULT_W, ptr, javascript, wcslen(javascript), frameName, timeoutMS);
+	return (JSValueC)&(ptr->executeJavascriptWithResult(toString(0, javascript), internName(frameName)).getWithTimeout(timeoutMS));
+}
+
+EXPORT int awe_WebView_executeJavascriptAsync(WebViewC webView, const char* javascript, const wchar_t* frameName, JavascriptResultCallbackC callback, void* userData) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptAsync", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC, ptr, javascript, strlen(javascript), frameName);
+	return executeJavascriptAsync(ptr, javascript, frameName, callback, userData);
+}
+
+EXPORT int awe_WebView_executeJavascriptAsyncW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName, JavascriptResultCallbackC callback, void* userData) {
+	AWE_STATS_SCOPE("awe_WebView_executeJavascriptAsyncW", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	traceText(AWE_TRACE_EXECUTE_JAVASCRIPT_ASYNC_W, ptr, javascript, wcslen(javascript), frameName);
+	return executeJavascriptAsync(ptr, javascript, frameName, callback, userData);
+}
+
+EXPORT int awe_WebView_getPendingJavascriptCount(WebViewC webView) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	return (int)getWebViewState(ptr)->pendingScripts.size();
+}
+
+EXPORT void awe_WebView_batchJavascript(WebViewC webView, const char* javascript, const wchar_t* frameName) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	size_t start;
+	std::wstring& batch = beginBatchedScript(ptr, frameName, &start);
+	appendUTF8(batch, javascript);
+	endBatchedScript(ptr, batch, start, frameName);
+}
+
+EXPORT void awe_WebView_batchJavascriptW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName) {
 	WebView* ptr = static_cast<WebView*> (webView);
-	return (JSValueC)&(ptr->executeJavascriptWithResult(std::wstring(javascript), std::wstring(frameName)).getWithTimeout(timeoutMS));
+	size_t start;
+	std::wstring& batch = beginBatchedScript(ptr, frameName, &start);
+	batch += javascript;
+	endBatchedScript(ptr, batch, start, frameName);
 }
 
+EXPORT void awe_WebView_batchJavascriptFunction(WebViewC webView, const wchar_t* object, const wchar_t* function, JSArgumentsC args, const wchar_t* frameName) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	const JSArguments* arguments = reinterpret_cast<const JSArguments*> (args);
+	size_t start;
+	std::wstring& batch = beginBatchedScript(ptr, frameName, &start);
+	appendFunctionCall(batch, object, function, arguments);
+	endBatchedScript(ptr, batch, start, frameName);
+}
+
+EXPORT void awe_WebView_flushJavascriptBatch(WebViewC webView) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_FLUSH_BATCH, ptr, 0, 0);
+	flushScriptBatches(getWebViewState(ptr));
+}
+
+// JSArguments have no serialized form, the call is traced as the equivalent script
 EXPORT void awe_WebView_callJavascriptFunction(WebViewC webView, const wchar_t* object, const wchar_t* function, JSArgumentsC args, const wchar_t* frameName) {
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->callJavascriptFunction(std::wstring(object), std::wstring(function), *(reinterpret_cast<const JSArguments*> (args)), std::wstring(frameName));
+	if(traceFile) {
+		std::wstring script;
+		appendFunctionCall(script, object, function, reinterpret_cast<const JSArguments*> (args));
+		traceText(AWE_TRACE_CALL_JAVASCRIPT_FUNCTION, ptr, script.c_str(), script.size(), frameName);
+	}
+	ptr->callJavascriptFunction(internName(object), internName(function), *(reinterpret_cast<const JSArguments*> (args)), internName(frameName));
 }
 
 EXPORT void awe_WebView_createObject(WebViewC webView, const wchar_t* objectName) {
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->createObject(std::wstring(objectName));
+	recordTrace(AWE_TRACE_CREATE_OBJECT, ptr, 0, 0, objectName, wcslen(objectName) * sizeof(wchar_t), 0, 0);
+	ptr->createObject(internName(objectName));
+	std::vector<std::wstring>& objects = getWebViewState(ptr)->objects;
+	if(std::find(objects.begin(), objects.end(), objectName) == objects.end())
+		objects.push_back(objectName);
 }
 
 EXPORT void awe_WebView_destroyObject(WebViewC webView, const wchar_t* objectName) {
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->destroyObject(std::wstring(objectName));
+	ptr->destroyObject(internName(objectName));
+	WebViewState* state = getWebViewState(ptr);
+	std::vector<std::wstring>& objects = state->objects;
+	objects.erase(std::remove(objects.begin(), objects.end(), objectName), objects.end());
+	for(size_t i = 0; i < state->boundCallbacks.size(); i++) {
+		if(state->boundCallbacks[i].callback && state->boundCallbacks[i].objectName == objectName)
+			unbindCallback(state, (int)i + 1);
+	}
+	state->propertyShadows.erase(objectName);
 }
 
 EXPORT void awe_WebView_setObjectProperty(WebViewC webView, const wchar_t* objectName, const wchar_t* propName, JSValueC value) {
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->setObjectProperty(std::wstring(objectName), std::wstring(propName),  *(reinterpret_cast<const JSValue*> (value)));
+	const std::wstring& object = internName(objectName);
+	const std::wstring& prop = internName(propName);
+	const JSValue& jsValue = *(reinterpret_cast<const JSValue*> (value));
+	ptr->setObjectProperty(object, prop, jsValue);
+	// keep the bulk sync shadow in step so the next delta isn't computed against a stale value
+	std::map<std::wstring, JSValue::Object>& shadows = getWebViewState(ptr)->propertyShadows;
+	std::map<std::wstring, JSValue::Object>::iterator shadow = shadows.find(object);
+	if(shadow != shadows.end())
+		shadow->second[prop] = jsValue;
+}
+
+EXPORT int awe_WebView_setObjectProperties(WebViewC webView, const wchar_t* objectName, const ObjectPropertyC* properties, int count) {
+	AWE_STATS_SCOPE("awe_WebView_setObjectProperties", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	// names are passed on as the shadow's keys, interned names may be scratch
+	// strings that later lookups overwrite
+	std::map<std::wstring, JSValue::Object>& shadows = getWebViewState(ptr)->propertyShadows;
+	const std::wstring& objectKey = internName(objectName);
+	std::map<std::wstring, JSValue::Object>::iterator shadow = shadows.lower_bound(objectKey);
+	if(shadow == shadows.end() || shadow->first != objectKey)
+		shadow = shadows.insert(shadow, std::make_pair(objectKey, JSValue::Object()));
+	const std::wstring& object = shadow->first;
+	int sent = 0;
+	for(int i = 0; i < count; i++) {
+		const std::wstring& prop = internName(properties[i].propName);
+		const JSValue& value = *(reinterpret_cast<const JSValue*> (properties[i].value));
+		JSValue::Object::iterator last = shadow->second.lower_bound(prop);
+		if(last != shadow->second.end() && last->first == prop) {
+			if(equalJSValues(last->second, value))
+				continue;
+			last->second = value;
+		} else {
+			last = shadow->second.insert(last, std::make_pair(prop, value));
+		}
+		ptr->setObjectProperty(object, last->first, value);
+		sent++;
+	}
+	return sent;
+}
+
+EXPORT void awe_WebView_clearObjectProperties(WebViewC webView, const wchar_t* objectName) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	std::map<std::wstring, JSValue::Object>& shadows = getWebViewState(ptr)->propertyShadows;
+	if(objectName)
+		shadows.erase(objectName);
+	else
+		shadows.clear();
 }
 
 EXPORT void awe_WebView_setObjectCallback(WebViewC webView, const wchar_t* objectName, const wchar_t* callbackName) {
 	WebView* ptr = static_cast<WebView*> (webView);
-	ptr->setObjectCallback(std::wstring(objectName), std::wstring(callbackName));
+	traceNames(AWE_TRACE_SET_OBJECT_CALLBACK, ptr, 0, objectName, callbackName);
+	ptr->setObjectCallback(internName(objectName), internName(callbackName));
+}
+
+EXPORT int awe_WebView_bindCallback(WebViewC webView, const wchar_t* objectName, const wchar_t* callbackName, BoundCallbackC callback, void* userData) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	// callbacks only arrive through a listener
+	if(!ptr->getListener())
+		ptr->setListener(new WebViewListenerImpl(0));
+	size_t objectLength = wcslen(objectName);
+	size_t callbackLength = wcslen(callbackName);
+	unsigned long long hash = hashCallbackName(objectName, objectLength, callbackName, callbackLength);
+	int id = findBoundCallback(state, hash, objectName, objectLength, callbackName, callbackLength);
+	if(!id) {
+		BoundCallback bound;
+		bound.objectName.assign(objectName, objectLength);
+		bound.callbackName.assign(callbackName, callbackLength);
+		bound.hash = hash;
+		state->boundCallbacks.push_back(bound);
+		id = (int)state->boundCallbacks.size();
+		state->boundCallbackIds.insert(std::make_pair(hash, id));
+		traceNames(AWE_TRACE_SET_OBJECT_CALLBACK, ptr, 0, objectName, callbackName);
+		ptr->setObjectCallback(internName(objectName), internName(callbackName));
+	}
+	state->boundCallbacks[id - 1].callback = callback;
+	state->boundCallbacks[id - 1].userData = userData;
+	return id;
+}
+
+EXPORT void awe_WebView_unbindCallback(WebViewC webView, int callbackId) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	if(callbackId <= 0 || callbackId > (int)state->boundCallbacks.size() || !state->boundCallbacks[callbackId - 1].callback)
+		return;
+	unbindCallback(state, callbackId);
 }
 
 EXPORT int awe_WebView_isLoadingPage(WebViewC webView) {
@@ -393,8 +2629,160 @@ EXPORT void awe_WebView_getDirtyBounds(WebViewC webView, RectC* rect) {
 }
 
 EXPORT RenderBufferC awe_WebView_render(WebViewC webView) {
+	AWE_STATS_SCOPE("awe_WebView_render", webView);
 	WebView* ptr = static_cast<WebView*> (webView);	
-	return (RenderBufferC)ptr->render();
+	RectC dirty;
+	return (RenderBufferC)renderWebView(getWebViewState(ptr), &dirty);
+}
+
+EXPORT RenderBufferC awe_WebView_renderDirtyRegion(WebViewC webView, RectC* dirtyRect, unsigned char** dirtyPixels, int* rowSpan) {
+	AWE_STATS_SCOPE("awe_WebView_renderDirtyRegion", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	const RenderBuffer* renderBuffer = renderWebView(getWebViewState(ptr), dirtyRect);
+	*dirtyPixels = 0;
+	*rowSpan = 0;
+	if(!renderBuffer)
+		return 0;
+
+	*rowSpan = renderBuffer->rowSpan;
+	if(dirtyRect->width > 0)
+		*dirtyPixels = renderBuffer->buffer + dirtyRect->y * renderBuffer->rowSpan + dirtyRect->x * 4;
+	return (RenderBufferC)renderBuffer;
+}
+
+EXPORT void awe_WebView_setDamageTracking(WebViewC webView, int enable) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	state->damageTracking = enable!=0?true:false;
+	reserveResizeCapacity(state);
+	if(!state->damageTracking) {
+		std::vector<unsigned char>().swap(state->shadow.pixels);
+		state->shadow.width = 0;
+		state->shadow.height = 0;
+	}
+}
+
+EXPORT void awe_WebView_setScrollDetection(WebViewC webView, int enable) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	state->scrollDetection = enable!=0?true:false;
+	state->scrolled = false;
+	reserveResizeCapacity(state);
+	if(!state->scrollDetection) {
+		std::vector<unsigned char>().swap(state->scrollShadow);
+		state->scrollShadowWidth = 0;
+		state->scrollShadowHeight = 0;
+	}
+}
+
+EXPORT int awe_WebView_getScrollArea(WebViewC webView, int* dx, int* dy, RectC* clip) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	if(!state->scrolled)
+		return 0;
+	*dx = 0;
+	*dy = state->scrollDY;
+	*clip = state->scrollClip;
+	return -1;
+}
+
+EXPORT int awe_WebView_getDirtyRects(WebViewC webView, RectC* rects, int maxRects) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	return copyDirtyRects(getWebViewState(ptr)->dirtyRects, rects, maxRects);
+}
+
+EXPORT void awe_WebView_setRenderTarget(WebViewC webView, unsigned char* buffer, int width, int height, int rowSpan) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	delete state->target;
+	state->target = 0;
+	state->targetUpdated = false;
+	state->targetBounds = makeRect(0, 0, 0, 0);
+	if(buffer) {
+		state->target = new RenderBuffer(buffer, width, height, rowSpan, false);
+		state->targetNeedsFullCopy = true;
+	}
+}
+
+EXPORT int awe_WebView_setSharedFrameExport(WebViewC webView, const wchar_t* name, int maxWidth, int maxHeight, int slotCount) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	delete state->sharedFrames;
+	state->sharedFrames = 0;
+	if(!name)
+		return -1;
+
+	if(slotCount < 2)
+		slotCount = 2;
+	size_t size = awe_SharedFrames_getSize(slotCount, maxWidth, maxHeight);
+	HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, (DWORD)size, name);
+	if(!mapping)
+		return 0;
+	// an existing mapping keeps its own, possibly smaller, size and has another writer
+	if(GetLastError() == ERROR_ALREADY_EXISTS) {
+		logMessage(AWE_LOG_NORMAL, "shared frame mapping already exists");
+		CloseHandle(mapping);
+		return 0;
+	}
+	unsigned char* base = static_cast<unsigned char*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+	if(!base) {
+		CloseHandle(mapping);
+		return 0;
+	}
+	SharedFrameWriter* writer = new SharedFrameWriter();
+	writer->mapping = mapping;
+	writer->base = base;
+	writer->header = reinterpret_cast<SharedFramesHeaderC*>(base);
+	writer->slots = reinterpret_cast<SharedFrameSlotC*>(base + sizeof(SharedFramesHeaderC));
+	writer->pending.resize(slotCount, makeRect(0, 0, 0, 0));
+	writer->nextSlot = 0;
+	writer->frameNumber = 0;
+	memset(base, 0, awe_SharedFrames_getSize(slotCount, 0, 0));
+	writer->header->slotCount = slotCount;
+	writer->header->maxWidth = maxWidth;
+	writer->header->maxHeight = maxHeight;
+	writer->header->dataOffset = (unsigned int)awe_SharedFrames_getSize(slotCount, 0, 0);
+	writer->header->slotSize = (unsigned int)((size - writer->header->dataOffset) / slotCount);
+	writer->header->latestSlot = -1;
+	writer->header->version = AWE_SHM_VERSION;
+	InterlockedExchange(reinterpret_cast<volatile LONG*>(&writer->header->magic), AWE_SHM_MAGIC);
+	state->sharedFrames = writer;
+	return -1;
+}
+
+EXPORT int awe_WebView_isRenderTargetUpdated(WebViewC webView, RectC* bounds) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	if(bounds)
+		*bounds = state->targetBounds;
+	return state->targetUpdated?-1:0;
+}
+
+EXPORT int awe_WebView_acquireLatestFrame(WebViewC webView, FrameC* frame) {
+	AWE_STATS_SCOPE("awe_WebView_acquireLatestFrame", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	// no lookup that could insert, the update thread may be adding or deleting states
+	EnterCriticalSection(&statesLock.lock);
+	std::map<WebView*, WebViewState*>::iterator result = webViewStates.find(ptr);
+	if(result == webViewStates.end()) {
+		LeaveCriticalSection(&statesLock.lock);
+		memset(frame, 0, sizeof(FrameC));
+		return 0;
+	}
+	WebViewState* state = result->second;
+	bool fresh = false;
+	if(state->readyFrame & AWE_FRAME_FRESH) {
+		state->frontFrame = InterlockedExchange(&state->readyFrame, state->frontFrame) & (AWE_FRAME_FRESH - 1);
+		fresh = true;
+	}
+	const FrameSlot& slot = state->frames[state->frontFrame];
+	frame->buffer = slot.pixels.empty()?0:&slot.pixels[0];
+	frame->width = slot.width;
+	frame->height = slot.height;
+	frame->rowSpan = slot.width * 4;
+	frame->frameNumber = slot.frameNumber;
+	LeaveCriticalSection(&statesLock.lock);
+	return fresh?-1:0;
 }
 
 EXPORT void awe_WebView_pauseRendering(WebViewC webView) {
@@ -407,39 +2795,85 @@ EXPORT void awe_WebView_resumeRendering(WebViewC webView) {
 	ptr->resumeRendering();
 }
 
+EXPORT void awe_WebView_setVisibility(WebViewC webView, int visibility) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	if(state->visibility == visibility)
+		return;
+	// occluded views keep running in the child process so they can be shown
+	// again without a stale frame, only hidden ones are paused
+	if(visibility == AWE_VISIBILITY_HIDDEN)
+		ptr->pauseRendering();
+	else if(state->visibility == AWE_VISIBILITY_HIDDEN)
+		ptr->resumeRendering();
+	state->visibility = visibility;
+}
+
+EXPORT int awe_WebView_getVisibility(WebViewC webView) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	return getWebViewState(ptr)->visibility;
+}
+
+EXPORT void awe_WebView_setMaxFps(WebViewC webView, int maxFps) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	getWebViewState(ptr)->maxFps = maxFps > 0?maxFps:0;
+}
+
+EXPORT void awe_WebView_setRenderPriority(WebViewC webView, int priority) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	getWebViewState(ptr)->renderPriority = priority;
+}
+
+EXPORT RenderBufferC awe_WebView_getRenderBuffer(WebViewC webView) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	return (RenderBufferC)getWebViewState(ptr)->renderBuffer;
+}
+
 EXPORT void awe_WebView_injectMouseMove(WebViewC webView, int x, int y) {
+	AWE_STATS_SCOPE("awe_WebView_injectMouseMove", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_MOUSE_MOVE, ptr, x, y);
 	ptr->injectMouseMove(x, y);
 }
 
+static void injectMouseButton(WebView* webView, int mouseButton, bool down) {
+	MouseButton button;
+	if(mouseButton == AWE_LEFT_BUTTON)
+		button = LEFT_MOUSE_BTN;
+	else if(mouseButton == AWE_RIGHT_BUTTON)
+		button = RIGHT_MOUSE_BTN;
+	else if(mouseButton == AWE_MIDDLE_BUTTON)
+		button = MIDDLE_MOUSE_BTN;
+	else
+		return;
+	if(down)
+		webView->injectMouseDown(button);
+	else
+		webView->injectMouseUp(button);
+}
+
 EXPORT void awe_WebView_injectMouseDown(WebViewC webView, int mouseButton) {
+	AWE_STATS_SCOPE("awe_WebView_injectMouseDown", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	if(mouseButton == AWE_LEFT_BUTTON)
-		ptr->injectMouseDown(LEFT_MOUSE_BTN);
-	if(mouseButton == AWE_RIGHT_BUTTON)
-		ptr->injectMouseDown(RIGHT_MOUSE_BTN);
-	if(mouseButton == AWE_MIDDLE_BUTTON)
-		ptr->injectMouseDown(MIDDLE_MOUSE_BTN);
+	recordTrace(AWE_TRACE_MOUSE_DOWN, ptr, mouseButton, 0);
+	injectMouseButton(ptr, mouseButton, true);
 }
 
 EXPORT void awe_WebView_injectMouseUp(WebViewC webView, int mouseButton) {
+	AWE_STATS_SCOPE("awe_WebView_injectMouseUp", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
-	if(mouseButton == AWE_LEFT_BUTTON)
-		ptr->injectMouseUp(LEFT_MOUSE_BTN);
-	if(mouseButton == AWE_RIGHT_BUTTON)
-		ptr->injectMouseUp(RIGHT_MOUSE_BTN);
-	if(mouseButton == AWE_MIDDLE_BUTTON)
-		ptr->injectMouseUp(MIDDLE_MOUSE_BTN);
+	recordTrace(AWE_TRACE_MOUSE_UP, ptr, mouseButton, 0);
+	injectMouseButton(ptr, mouseButton, false);
 }
 
 EXPORT void awe_WebView_injectMouseWheel(WebViewC webView, int scrollAmount) {
+	AWE_STATS_SCOPE("awe_WebView_injectMouseWheel", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_MOUSE_WHEEL, ptr, scrollAmount, 0);
 	ptr->injectMouseWheel(scrollAmount);
 }
 
-EXPORT void awe_WebView_injectKeyboardEvent(WebViewC webView, WebKeyboardEventC* keyboardEvent) {
-	WebView* ptr = static_cast<WebView*> (webView);
-	WebKeyboardEvent kevent;
+static void toWebKeyboardEvent(const WebKeyboardEventC* keyboardEvent, WebKeyboardEvent& kevent) {
 	kevent.isSystemKey = keyboardEvent->isSystemKey!=0?true:false;
 	memcpy(kevent.keyIdentifier, keyboardEvent->keyIdentifier, sizeof(char) * 20);
 	kevent.modifiers = keyboardEvent->modifiers;
@@ -453,12 +2887,30 @@ EXPORT void awe_WebView_injectKeyboardEvent(WebViewC webView, WebKeyboardEventC*
 	}
 	memcpy(kevent.unmodifiedText, keyboardEvent->unmodifiedText, sizeof(wchar_t)*4);
 	kevent.virtualKeyCode = keyboardEvent->virtualKeyCode;
+}
+
+static void injectCharacter(WebView* webView, unsigned int key) {
+	Awesomium::WebKeyboardEvent keyEvent;
+	keyEvent.text[0] = key;
+	keyEvent.unmodifiedText[0] = key;
+	keyEvent.type = Awesomium::WebKeyboardEvent::TYPE_CHAR;
+	keyEvent.virtualKeyCode = key;
+	keyEvent.nativeKeyCode = key;
+	webView->injectKeyboardEvent(keyEvent);
+}
 
-	printf("%d %d %d\n", kevent.virtualKeyCode, keyboardEvent->text[0], keyboardEvent->unmodifiedText[0]);
-	ptr->injectKeyboardEvent(kevent);	
+EXPORT void awe_WebView_injectKeyboardEvent(WebViewC webView, WebKeyboardEventC* keyboardEvent) {
+	AWE_STATS_SCOPE("awe_WebView_injectKeyboardEvent", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_KEYBOARD, ptr, 0, 0, keyboardEvent, sizeof(WebKeyboardEventC), 0, 0);
+	WebKeyboardEvent kevent;
+	toWebKeyboardEvent(keyboardEvent, kevent);
+	logMessage(AWE_LOG_VERBOSE, "injectKeyboardEvent %d %d %d", kevent.virtualKeyCode, keyboardEvent->text[0], keyboardEvent->unmodifiedText[0]);
+	ptr->injectKeyboardEvent(kevent);
 }
 
 EXPORT void awe_WebView_injectKeyboardEventArgs(WebViewC webView, int type, int modifiers, int virtualKeyCode, int nativeKeyCode, char* keyIdentifier, wchar_t* text, wchar_t* unmodifiedText, int isSystemKey) {
+	AWE_STATS_SCOPE("awe_WebView_injectKeyboardEventArgs", webView);
 	WebView* ptr = static_cast<WebView*> (webView);	
 	WebKeyboardEvent kevent;
 	switch(type) {
@@ -474,28 +2926,153 @@ EXPORT void awe_WebView_injectKeyboardEventArgs(WebViewC webView, int type, int
 	memcpy(kevent.text, text, sizeof(wchar_t)*4);
 	memcpy(kevent.unmodifiedText, unmodifiedText, sizeof(wchar_t)*4);
 	kevent.isSystemKey = isSystemKey!=0?true:false;
+	if(traceFile) {
+		WebKeyboardEventC keyboardEvent;
+		keyboardEvent.type = type;
+		keyboardEvent.modifiers = modifiers;
+		keyboardEvent.virtualKeyCode = virtualKeyCode;
+		keyboardEvent.nativeKeyCode = nativeKeyCode;
+		memcpy(keyboardEvent.keyIdentifier, keyIdentifier, 20);
+		memcpy(keyboardEvent.text, text, sizeof(wchar_t)*4);
+		memcpy(keyboardEvent.unmodifiedText, unmodifiedText, sizeof(wchar_t)*4);
+		keyboardEvent.isSystemKey = isSystemKey;
+		recordTrace(AWE_TRACE_KEYBOARD, ptr, 0, 0, &keyboardEvent, sizeof(WebKeyboardEventC), 0, 0);
+	}
 
+	logMessage(AWE_LOG_VERBOSE, "injectKeyboardEventArgs %d %d %d %d", kevent.virtualKeyCode, kevent.nativeKeyCode, kevent.text[0], kevent.unmodifiedText[0]);
 	ptr->injectKeyboardEvent(kevent);
-	printf("%d %d %d %d\n", kevent.virtualKeyCode, kevent.nativeKeyCode, kevent.text[0], kevent.unmodifiedText[0]);
 }
 
 EXPORT void awe_WebView_injectKeyboardEventCharacter(WebViewC webView, unsigned int key) {
+	AWE_STATS_SCOPE("awe_WebView_injectKeyboardEventCharacter", webView);
 	WebView* ptr = static_cast<WebView*> (webView);	
-	Awesomium::WebKeyboardEvent keyEvent;
-	keyEvent.text[0] = key;
-	keyEvent.unmodifiedText[0] = key;
-	keyEvent.type = Awesomium::WebKeyboardEvent::TYPE_CHAR;
-	keyEvent.virtualKeyCode = key;
-	keyEvent.nativeKeyCode = key;
-	ptr->injectKeyboardEvent(keyEvent);	
+	recordTrace(AWE_TRACE_CHARACTER, ptr, (int)key, 0);
+	injectCharacter(ptr, key);
+}
+
+// consecutive mouse moves only need their last position, consecutive wheel events are summed
+EXPORT int awe_WebView_injectEvents(WebViewC webView, const InputEventC* events, int count) {
+	AWE_STATS_SCOPE("awe_WebView_injectEvents", webView);
+	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_INPUT, ptr, count, 0, events, count * sizeof(InputEventC), 0, 0);
+	int injected = 0;
+	for(int i = 0; i < count; i++) {
+		const InputEventC& event = events[i];
+		switch(event.type) {
+			case AWE_INPUT_MOUSE_MOVE:
+				if(i + 1 < count && events[i + 1].type == AWE_INPUT_MOUSE_MOVE)
+					continue;
+				ptr->injectMouseMove(event.x, event.y);
+				break;
+			case AWE_INPUT_MOUSE_DOWN:
+				injectMouseButton(ptr, event.button, true);
+				break;
+			case AWE_INPUT_MOUSE_UP:
+				injectMouseButton(ptr, event.button, false);
+				break;
+			case AWE_INPUT_MOUSE_WHEEL: {
+				int scrollAmount = event.scrollAmount;
+				while(i + 1 < count && events[i + 1].type == AWE_INPUT_MOUSE_WHEEL)
+					scrollAmount += events[++i].scrollAmount;
+				ptr->injectMouseWheel(scrollAmount);
+				break;
+			}
+			case AWE_INPUT_KEYBOARD: {
+				WebKeyboardEvent kevent;
+				toWebKeyboardEvent(&event.keyboardEvent, kevent);
+				ptr->injectKeyboardEvent(kevent);
+				break;
+			}
+			case AWE_INPUT_CHARACTER:
+				injectCharacter(ptr, event.character);
+				break;
+			default:
+				continue;
+		}
+		injected++;
+	}
+	return injected;
 }
 
 EXPORT void awe_WebView_injectKeyboardEventWindows(WebViewC webView, int msg, WPARAM wparam, LPARAM lparam) {
+	AWE_STATS_SCOPE("awe_WebView_injectKeyboardEventWindows", webView);
 	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_KEYBOARD_WINDOWS, ptr, msg, (int)wparam, &lparam, sizeof(LPARAM), 0, 0);
 	WebKeyboardEvent keyEvent(msg, wparam, lparam);
 	ptr->injectKeyboardEvent(keyEvent);
 }
 
+EXPORT void awe_WebView_postLoadURL(WebViewC webView, const char* url, const wchar_t* frameName, const char* username, const char* password) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_LOAD_URL);
+	command->string = copyString(url);
+	command->frameName = copyString(frameName);
+	command->username = copyString(username);
+	command->password = copyString(password);
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postLoadURLW(WebViewC webView, const wchar_t* url, const wchar_t* frameName, const char* username, const char* password) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_LOAD_URL_W);
+	command->wideString = copyString(url);
+	command->frameName = copyString(frameName);
+	command->username = copyString(username);
+	command->password = copyString(password);
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postExecuteJavascript(WebViewC webView, const char* javascript, const wchar_t* frameName) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_EXECUTE_JAVASCRIPT);
+	command->string = copyString(javascript);
+	command->frameName = copyString(frameName);
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postExecuteJavascriptW(WebViewC webView, const wchar_t* javascript, const wchar_t* frameName) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_EXECUTE_JAVASCRIPT_W);
+	command->wideString = copyString(javascript);
+	command->frameName = copyString(frameName);
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postMouseMove(WebViewC webView, int x, int y) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_MOUSE_MOVE);
+	command->x = x;
+	command->y = y;
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postMouseDown(WebViewC webView, int mouseButton) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_MOUSE_DOWN);
+	command->x = mouseButton;
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postMouseUp(WebViewC webView, int mouseButton) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_MOUSE_UP);
+	command->x = mouseButton;
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postMouseWheel(WebViewC webView, int scrollAmount) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_MOUSE_WHEEL);
+	command->x = scrollAmount;
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postKeyboardEvent(WebViewC webView, WebKeyboardEventC* keyboardEvent) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_KEYBOARD_EVENT);
+	command->keyboardEvent = *keyboardEvent;
+	postCommand(command);
+}
+
+EXPORT void awe_WebView_postKeyboardEventWindows(WebViewC webView, int msg, WPARAM wparam, LPARAM lparam) {
+	WebViewCommand* command = new WebViewCommand(static_cast<WebView*> (webView), AWE_COMMAND_KEYBOARD_EVENT_WINDOWS);
+	command->x = msg;
+	command->wparam = wparam;
+	command->lparam = lparam;
+	postCommand(command);
+}
+
 EXPORT void awe_WebView_cut(WebViewC webView) {
 	WebView* ptr = static_cast<WebView*> (webView);
 	ptr->cut();
@@ -528,6 +3105,10 @@ EXPORT void awe_WebView_resetZoom(WebViewC webView) {
 
 EXPORT int awe_WebView_resize(WebViewC webView, int width, int height, int waitForRepaint, int repaintTimeoutMS) {
 	WebView* ptr = static_cast<WebView*> (webView);
+	recordTrace(AWE_TRACE_RESIZE, ptr, width, height);
+	WebViewState* state = getWebViewState(ptr);
+	state->width = width;
+	state->height = height;
 	bool result = ptr->resize(width, height, waitForRepaint!=0?true:false, repaintTimeoutMS);
 	return result?-1:0;
 }
@@ -537,6 +3118,31 @@ EXPORT int awe_WebView_isResizing(WebViewC webView) {
 	return ptr->isResizing()?-1:0;
 }
 
+EXPORT void awe_WebView_setResizeMode(WebViewC webView, int maxWidth, int maxHeight, int debounceMS) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	state->resizeDebounceMS = debounceMS > 0?debounceMS:0;
+	state->maxResizeWidth = maxWidth > 0?maxWidth:0;
+	state->maxResizeHeight = maxHeight > 0?maxHeight:0;
+	reserveResizeCapacity(state);
+}
+
+EXPORT void awe_WebView_resizeAsync(WebViewC webView, int width, int height) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	state->resizeWidth = width;
+	state->resizeHeight = height;
+	state->resizePending = true;
+	applyPendingResize(state, getTicks());
+}
+
+EXPORT void awe_WebView_setResizeCompleteCallback(WebViewC webView, ResizeCompleteCallbackC callback, void* userData) {
+	WebView* ptr = static_cast<WebView*> (webView);
+	WebViewState* state = getWebViewState(ptr);
+	state->resizeCallback = callback;
+	state->resizeCallbackUserData = userData;
+}
+
 EXPORT void awe_WebView_unfocus(WebViewC webView) {
 	WebView* ptr = static_cast<WebView*> (webView);
 	ptr->unfocus();
@@ -587,6 +3193,158 @@ EXPORT void awe_WebView_removeHeaderRewriteRulesByDefinitionName(WebViewC webVie
 	ptr->removeHeaderRewriteRulesByDefinitionName(std::string(name));
 }*/
 
+/*-----------------------------------------------------------------------------
+  WebView pool, keeps paused views around so acquiring one doesn't have to
+  wait for a new view to be created in the child process. An empty pool
+  returns 0 instead of creating a view synchronously, unless growing on
+  demand was enabled with awe_WebViewPool_setGrowOnDemand.
+-----------------------------------------------------------------------------*/
+struct PooledView {
+	WebView* webView;
+	int width;
+	int height;
+};
+
+struct WebViewPool {
+	WebCore* webCore;
+	int width;
+	int height;
+	bool growOnDemand;
+	std::vector<PooledView> idle;
+};
+
+// brings a released view back to the state of a freshly created one
+static void resetWebView(WebView* webView) {
+	WebViewState* state = getWebViewState(webView);
+	// the previous owner gave the view up, its script callbacks and posted commands must not run anymore
+	state->pendingScripts.clear();
+	EnterCriticalSection(&statesLock.lock);
+	state->generation = nextViewGeneration++;
+	LeaveCriticalSection(&statesLock.lock);
+	for(std::map<std::wstring, std::wstring>::iterator it = state->scriptBatches.begin(); it != state->scriptBatches.end(); it++)
+		it->second.clear();
+	for(size_t i = 0; i < state->objects.size(); i++)
+		webView->destroyObject(state->objects[i]);
+	state->objects.clear();
+	state->boundCallbacks.clear();
+	state->boundCallbackIds.clear();
+	state->propertyShadows.clear();
+	state->packedCallback = 0;
+	state->packedCallbackUserData = 0;
+
+	// the listener stays installed for the wrapper's own callbacks, this is
+	// also safe when releasing from inside a listener callback
+	WebViewListenerImpl* listener = dynamic_cast<WebViewListenerImpl*>(webView->getListener());
+	if(listener)
+		listener->setFuncs(0);
+	if(state->interceptor)
+		state->interceptor->setFuncs(0);
+	awe_WebView_setRenderTarget(webView, 0, 0, 0, 0);
+	awe_WebView_setDamageTracking(webView, 0);
+	awe_WebView_setScrollDetection(webView, 0);
+	awe_WebView_setSharedFrameExport(webView, 0, 0, 0, 0);
+	state->visibility = AWE_VISIBILITY_VISIBLE;
+	state->maxFps = 0;
+	state->lastRenderTicks = 0;
+	state->renderPriority = 0;
+	state->resizeWidth = 0;
+	state->resizeHeight = 0;
+	state->appliedWidth = 0;
+	state->appliedHeight = 0;
+	state->resizePending = false;
+	state->resizeApplied = false;
+	state->resizeDebounceMS = AWE_RESIZE_DEBOUNCE_MS;
+	state->lastResizeTicks = 0;
+	state->resizeCallback = 0;
+	state->resizeCallbackUserData = 0;
+	state->maxResizeWidth = 0;
+	state->maxResizeHeight = 0;
+	state->contentsChunkSize = AWE_CONTENTS_CHUNK_SIZE;
+	state->contentsEncoding = AWE_CONTENTS_UTF16;
+	std::vector<char>().swap(state->contentsBuffer);
+	state->contentsCallback = 0;
+	state->contentsCallbackUserData = 0;
+	state->userData = 0;
+
+	webView->stop();
+	webView->clearAllURLFilters();
+	webView->resetZoom();
+	webView->unfocus();
+	webView->loadURL(std::string("about:blank"), std::wstring(), std::string(), std::string());
+	webView->pauseRendering();
+}
+
+EXPORT WebViewPoolC awe_WebViewPool_new(WebCoreC webCore, int width, int height, int count) {
+	WebViewPool* pool = new WebViewPool();
+	pool->webCore = static_cast<WebCore*> (webCore);
+	pool->width = width;
+	pool->height = height;
+	pool->growOnDemand = false;
+	for(int i = 0; i < count; i++) {
+		PooledView view;
+		view.webView = static_cast<WebView*> (awe_WebCore_createWebView(webCore, width, height));
+		view.width = width;
+		view.height = height;
+		view.webView->pauseRendering();
+		pool->idle.push_back(view);
+	}
+	return pool;
+}
+
+EXPORT void awe_WebViewPool_delete(WebViewPoolC webViewPool) {
+	WebViewPool* pool = static_cast<WebViewPool*> (webViewPool);
+	for(size_t i = 0; i < pool->idle.size(); i++)
+		awe_WebView_destroy(pool->idle[i].webView);
+	delete pool;
+}
+
+EXPORT WebViewC awe_WebViewPool_acquire(WebViewPoolC webViewPool, int width, int height) {
+	WebViewPool* pool = static_cast<WebViewPool*> (webViewPool);
+	if(pool->idle.empty())
+		return pool->growOnDemand?awe_WebCore_createWebView(pool->webCore, width, height):0;
+
+	// prefer a view that already has the right size, resizing has to round trip to the child process
+	size_t index = pool->idle.size() - 1;
+	for(size_t i = 0; i < pool->idle.size(); i++) {
+		if(pool->idle[i].width == width && pool->idle[i].height == height) {
+			index = i;
+			break;
+		}
+	}
+	PooledView view = pool->idle[index];
+	pool->idle.erase(pool->idle.begin() + index);
+	if(view.width != width || view.height != height) {
+		view.webView->resize(width, height, false);
+		WebViewState* state = getWebViewState(view.webView);
+		state->width = width;
+		state->height = height;
+	}
+	view.webView->resumeRendering();
+	return view.webView;
+}
+
+EXPORT void awe_WebViewPool_release(WebViewPoolC webViewPool, WebViewC webView) {
+	WebViewPool* pool = static_cast<WebViewPool*> (webViewPool);
+	WebView* ptr = static_cast<WebView*> (webView);
+	resetWebView(ptr);
+	PooledView view;
+	view.webView = ptr;
+	WebViewState* state = getWebViewState(ptr);
+	view.width = state->width?state->width:pool->width;
+	view.height = state->height?state->height:pool->height;
+	pool->idle.push_back(view);
+}
+
+EXPORT void awe_WebViewPool_setGrowOnDemand(WebViewPoolC webViewPool, int growOnDemand) {
+	WebViewPool* pool = static_cast<WebViewPool*> (webViewPool);
+	pool->growOnDemand = growOnDemand != 0;
+}
+
+EXPORT int awe_WebViewPool_getIdleCount(WebViewPoolC webViewPool) {
+	WebViewPool* pool = static_cast<WebViewPool*> (webViewPool);
+	return (int)pool->idle.size();
+}
+
 /*-----------------------------------------------------------------------------
   RenderBuffer API
 -----------------------------------------------------------------------------*/
@@ -606,6 +3364,7 @@ EXPORT void awe_RenderBuffer_delete(RenderBufferC renderBuffer) {
 }
 
 EXPORT void awe_RenderBuffer_copyTo(RenderBufferC renderBuffer, unsigned char* destBuffer, int destRowSpan, int destDepth, int convertToRGBA) {
+	AWE_STATS_SCOPE("awe_RenderBuffer_copyTo", 0);
 	RenderBuffer* ptr = static_cast<RenderBuffer*>(renderBuffer);
 	ptr->copyTo(destBuffer, destRowSpan, destDepth, convertToRGBA!=0?true:false);
 }
@@ -675,52 +3434,261 @@ EXPORT int awe_RenderBuffer_ownsBuffer(RenderBufferC renderBuffer) {
 	return ptr->ownsBuffer?-1:0;
 }
 
+/*-----------------------------------------------------------------------------
+  ResourceResponse and resource cache API
+-----------------------------------------------------------------------------*/
+EXPORT ResourceResponseC awe_ResourceResponse_create(int numBytes, unsigned char* buffer, const char* mimeType) {
+	return ResourceResponse::Create(numBytes, buffer, std::string(mimeType));
+}
+
+EXPORT ResourceResponseC awe_ResourceResponse_createFromFile(const wchar_t* filePath) {
+	return ResourceResponse::Create(std::wstring(filePath));
+}
+
+EXPORT void awe_ResourceCache_setCapacity(int maxBytes) {
+	EnterCriticalSection(&resourceCache.lock);
+	resourceCache.capacity = maxBytes > 0?maxBytes:0;
+	resourceCache.evict();
+	LeaveCriticalSection(&resourceCache.lock);
+}
+
+EXPORT int awe_ResourceCache_getCapacity() {
+	EnterCriticalSection(&resourceCache.lock);
+	int capacity = (int)resourceCache.capacity;
+	LeaveCriticalSection(&resourceCache.lock);
+	return capacity;
+}
+
+EXPORT int awe_ResourceCache_getSize() {
+	EnterCriticalSection(&resourceCache.lock);
+	int size = (int)resourceCache.size;
+	LeaveCriticalSection(&resourceCache.lock);
+	return size;
+}
+
+EXPORT void awe_ResourceCache_setCacheFiles(int enable) {
+	EnterCriticalSection(&resourceCache.lock);
+	resourceCache.cacheFiles = enable?true:false;
+	LeaveCriticalSection(&resourceCache.lock);
+}
+
+EXPORT void awe_ResourceCache_put(const char* url, const unsigned char* buffer, int numBytes, const char* mimeType) {
+	resourceCache.put(std::string(url), buffer, numBytes, mimeType?std::string(mimeType):std::string(awe_guessMimeType(url)));
+}
+
+EXPORT void awe_ResourceCache_remove(const char* url) {
+	EnterCriticalSection(&resourceCache.lock);
+	std::map<std::string, std::list<CachedResource>::iterator>::iterator it = resourceCache.index.find(std::string(url));
+	if(it != resourceCache.index.end())
+		resourceCache.remove(it);
+	LeaveCriticalSection(&resourceCache.lock);
+}
+
+EXPORT void awe_ResourceCache_clear() {
+	EnterCriticalSection(&resourceCache.lock);
+	resourceCache.entries.clear();
+	resourceCache.index.clear();
+	resourceCache.size = 0;
+	LeaveCriticalSection(&resourceCache.lock);
+}
+
+/*-----------------------------------------------------------------------------
+  JSArena, per thread scoped allocation of JSValue, Object, Array and
+  JSArguments handles. Handles allocated inside a scope are destroyed by
+  awe_JSArena_end, calling the matching delete function on them is a no-op.
+-----------------------------------------------------------------------------*/
+#define AWE_ARENA_BLOCK_SIZE (16 * 1024)
+#define AWE_ARENA_ALIGNMENT 8
+
+struct ArenaDestructor {
+	void* handle;
+	void (*destroy) (void* handle);
+};
+
+struct ArenaMark {
+	size_t block;
+	size_t blockUsed;
+	size_t destructors;
+};
+
+struct JSArena {
+	std::vector<char*> blocks;
+	std::vector<size_t> blockSizes;
+	size_t block;
+	size_t blockUsed;
+	std::vector<ArenaDestructor> destructors;
+	std::vector<ArenaMark> marks;
+
+	JSArena() {
+		block = 0;
+		blockUsed = 0;
+	}
+
+	~JSArena() {
+		for(size_t i = 0; i < blocks.size(); i++)
+			delete[] blocks[i];
+	}
+
+	void* allocate(size_t size) {
+		size = (size + AWE_ARENA_ALIGNMENT - 1) & ~(size_t)(AWE_ARENA_ALIGNMENT - 1);
+		while(block < blocks.size() && blockUsed + size > blockSizes[block]) {
+			block++;
+			blockUsed = 0;
+		}
+		if(block == blocks.size()) {
+			size_t blockSize = size > AWE_ARENA_BLOCK_SIZE?size:AWE_ARENA_BLOCK_SIZE;
+			blocks.push_back(new char[blockSize]);
+			blockSizes.push_back(blockSize);
+			blockUsed = 0;
+		}
+		void* memory = blocks[block] + blockUsed;
+		blockUsed += size;
+		return memory;
+	}
+
+	bool contains(const void* handle) const {
+		const char* ptr = static_cast<const char*>(handle);
+		for(size_t i = 0; i < blocks.size(); i++)
+			if(ptr >= blocks[i] && ptr < blocks[i] + blockSizes[i])
+				return true;
+		return false;
+	}
+
+	void begin() {
+		ArenaMark mark;
+		mark.block = block;
+		mark.blockUsed = blockUsed;
+		mark.destructors = destructors.size();
+		marks.push_back(mark);
+	}
+
+	void end() {
+		if(marks.empty())
+			return;
+		ArenaMark mark = marks.back();
+		marks.pop_back();
+		// destroy in reverse so values go before the containers they were read from
+		while(destructors.size() > mark.destructors) {
+			ArenaDestructor destructor = destructors.back();
+			destructors.pop_back();
+			destructor.destroy(destructor.handle);
+		}
+		// blocks are kept for the next scope
+		block = mark.block;
+		blockUsed = mark.blockUsed;
+	}
+};
+
+static DWORD arenaTlsIndex = TLS_OUT_OF_INDEXES;
+
+static JSArena* getArena(bool create) {
+	if(arenaTlsIndex == TLS_OUT_OF_INDEXES) {
+		if(!create)
+			return 0;
+		DWORD index = TlsAlloc();
+		if(InterlockedCompareExchange((LONG volatile*)&arenaTlsIndex, (LONG)index, (LONG)TLS_OUT_OF_INDEXES) != (LONG)TLS_OUT_OF_INDEXES)
+			TlsFree(index);
+	}
+	JSArena* arena = static_cast<JSArena*>(TlsGetValue(arenaTlsIndex));
+	if(!arena && create) {
+		arena = new JSArena();
+		TlsSetValue(arenaTlsIndex, arena);
+	}
+	return arena;
+}
+
+template <class T>
+static void destroyHandle(void* handle) {
+	static_cast<T*>(handle)->~T();
+}
+
+template <class T>
+static T* newHandle(const T& value) {
+	JSArena* arena = getArena(false);
+	if(!arena || arena->marks.empty())
+		return new T(value);
+	T* handle = new(arena->allocate(sizeof(T))) T(value);
+	ArenaDestructor destructor;
+	destructor.handle = handle;
+	destructor.destroy = &destroyHandle<T>;
+	arena->destructors.push_back(destructor);
+	return handle;
+}
+
+template <class T>
+static void deleteHandle(T* handle) {
+	JSArena* arena = getArena(false);
+	if(arena && arena->contains(handle))
+		return;
+	delete handle;
+}
+
+EXPORT void awe_JSArena_begin() {
+	getArena(true)->begin();
+}
+
+EXPORT void awe_JSArena_end() {
+	JSArena* arena = getArena(false);
+	if(arena)
+		arena->end();
+}
+
+EXPORT void awe_JSArena_release() {
+	JSArena* arena = getArena(false);
+	if(!arena)
+		return;
+	while(!arena->marks.empty())
+		arena->end();
+	delete arena;
+	TlsSetValue(arenaTlsIndex, 0);
+}
+
 /*-----------------------------------------------------------------------------
   JSValue API
 -----------------------------------------------------------------------------*/
 EXPORT JSValueC awe_JSValue_newNull() {
-	JSValue* val = new JSValue();
+	JSValue* val = newHandle(JSValue());
 	return val;
 }
 
 EXPORT JSValueC awe_JSValue_newBool(int value) {
-	JSValue* val = new JSValue(value!=0?true:false);
+	JSValue* val = newHandle(JSValue(value!=0?true:false));
 	return val;
 }
 
 EXPORT JSValueC awe_JSValue_newInt(int value) {
-	JSValue* val = new JSValue(value);
+	JSValue* val = newHandle(JSValue(value));
 	return val;
 }
 
 EXPORT JSValueC awe_JSValue_newDouble(double value) {
-	JSValue* val = new JSValue(value);
+	JSValue* val = newHandle(JSValue(value));
 	return val;
 }
 
 EXPORT JSValueC awe_JSValue_newString(const char* value) {
-	JSValue* val = new JSValue(value);
+	JSValue* val = newHandle(JSValue(value));
 	return val;
 }
 
 EXPORT JSValueC awe_JSValue_newWString(const wchar_t* value) {
-	JSValue* val = new JSValue(value);
+	JSValue* val = newHandle(JSValue(value));
 	return val;
 }
 
 EXPORT JSValueC awe_JSValue_newObject(ObjectC value) {
-	JSValue* val = new JSValue(*(static_cast<JSValue::Object*>(value)));
+	JSValue* val = newHandle(JSValue(*(static_cast<JSValue::Object*>(value))));
 	return val;
 }
 
 EXPORT JSValueC awe_JSValue_newArray(ObjectC value) {
-	JSValue* val = new JSValue(*(static_cast<JSValue::Array*>(value)));
+	JSValue* val = newHandle(JSValue(*(static_cast<JSValue::Array*>(value))));
 	return val;
 }
 
 EXPORT void awe_JSValue_delete(JSValueC val) {
 	JSValue* ptr = static_cast<JSValue*>(val);
-	delete ptr;
+	deleteHandle(ptr);
 }
 
 EXPORT int awe_JSValue_isBoolean(JSValueC val) {
@@ -798,13 +3766,13 @@ EXPORT ObjectC awe_JSValue_getObject(JSValueC val) {
   JSValue::Object API
 -----------------------------------------------------------------------------*/
 EXPORT ObjectC awe_Object_new() {
-	JSValue::Object* obj = new JSValue::Object();
+	JSValue::Object* obj = newHandle(JSValue::Object());
 	return obj;
 }
 
 EXPORT void awe_Object_delete(ObjectC obj) {
 	JSValue::Object* ptr = static_cast<JSValue::Object*>(obj);
-	delete ptr;
+	deleteHandle(ptr);
 }
 
 EXPORT void awe_Object_put(ObjectC obj, wchar_t* key, JSValueC val) {
@@ -816,7 +3784,7 @@ EXPORT JSValueC awe_Object_get(ObjectC obj, wchar_t* key) {
 	JSValue::Object* ptr = static_cast<JSValue::Object*>(obj);
 	JSValue::Object::iterator result = ptr->find(std::wstring(key));
 	if(result != ptr->end())
-		return new JSValue(result->second);
+		return newHandle(result->second);
 	else
 		return 0;
 }
@@ -834,13 +3802,13 @@ EXPORT int awe_Object_contains(ObjectC obj, wchar_t* key) {
   JSValue::Array API
 -----------------------------------------------------------------------------*/
 EXPORT ArrayC awe_Array_new() {
-	JSValue::Array* arr = new JSValue::Array();
+	JSValue::Array* arr = newHandle(JSValue::Array());
 	return arr;
 }
 
 EXPORT void awe_Array_delete(ArrayC arr) {
 	JSValue::Array* ptr = static_cast<JSValue::Array*>(arr);
-	delete ptr;
+	deleteHandle(ptr);
 }
 
 EXPORT int awe_Array_size(ArrayC arr) {
@@ -850,7 +3818,7 @@ EXPORT int awe_Array_size(ArrayC arr) {
 
 EXPORT JSValueC awe_Array_get(ArrayC arr, int index) {
 	JSValue::Array* ptr = static_cast<JSValue::Array*>(arr);
-	return new JSValue(ptr[index]);
+	return newHandle((*ptr)[index]);
 }
 
 EXPORT void awe_Array_add(ArrayC arr, JSValueC val) {
@@ -860,13 +3828,13 @@ EXPORT void awe_Array_add(ArrayC arr, JSValueC val) {
 }
 
 EXPORT JSArgumentsC awe_JSArguments_new() {
-	JSArguments* args = new JSArguments();
+	JSArguments* args = newHandle(JSArguments());
 	return args;
 }
 
 EXPORT void awe_JSArguments_delete(JSArgumentsC args) {
 	JSArguments* ptr = static_cast<JSArguments*>(args);
-	delete ptr;
+	deleteHandle(ptr);
 }
 
 EXPORT int awe_JSArguments_size(JSArgumentsC args) {
@@ -887,4 +3855,9 @@ EXPORT void awe_JSArguments_add(JSArgumentsC args, JSValueC val) {
 
 EXPORT void awe_getKeyIdentifierFromVirtualKeyCode(int keyCode, char** identifier) {
 	Awesomium::getKeyIdentifierFromVirtualKeyCode(keyCode, identifier);
+}
+
+EXPORT void awe_setLogger(LoggerC newLogger, int level) {
+	logger = newLogger;
+	logLevel = level;
 }
\ No newline at end of file
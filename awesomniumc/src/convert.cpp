@@ -0,0 +1,321 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#define EXPORTS
+#include "awesomiumc.h"
+#include "RenderBuffer.h"
+#include <intrin.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+
+using namespace Awesomium;
+
+// converts a single row of pixels
+typedef void (*ConvertRowFunc) (const unsigned char* src, unsigned char* dest, int pixels);
+
+// in convert_avx2.cpp, the kernels convert the leading pixels of a row and return how many they converted
+bool detectAVX2();
+int bgraToRGBA_AVX2(const unsigned char* src, unsigned char* dest, int pixels);
+int bgraToRGB_AVX2(const unsigned char* src, unsigned char* dest, int pixels);
+int premultiply_AVX2(const unsigned char* src, unsigned char* dest, int pixels);
+int unpremultiply_AVX2(const unsigned char* src, unsigned char* dest, int pixels, const unsigned int* reciprocals);
+int forceOpaque_AVX2(const unsigned char* src, unsigned char* dest, int pixels);
+
+/*-----------------------------------------------------------------------------
+  Scalar kernels, also used for the tails of the SIMD kernels
+-----------------------------------------------------------------------------*/
+static void bgraToRGBA(const unsigned char* src, unsigned char* dest, int pixels) {
+	for(int i = 0; i < pixels; i++, src += 4, dest += 4) {
+		unsigned char b = src[0];
+		dest[0] = src[2];
+		dest[1] = src[1];
+		dest[2] = b;
+		dest[3] = src[3];
+	}
+}
+
+static void bgraToRGB(const unsigned char* src, unsigned char* dest, int pixels) {
+	for(int i = 0; i < pixels; i++, src += 4, dest += 3) {
+		dest[0] = src[2];
+		dest[1] = src[1];
+		dest[2] = src[0];
+	}
+}
+
+// (c * a + 127) / 255 without the division, exact for all 8-bit inputs
+static inline unsigned char mul255(unsigned int c, unsigned int a) {
+	unsigned int t = c * a + 128;
+	return (unsigned char)((t + (t >> 8)) >> 8);
+}
+
+static void premultiply(const unsigned char* src, unsigned char* dest, int pixels) {
+	for(int i = 0; i < pixels; i++, src += 4, dest += 4) {
+		unsigned int a = src[3];
+		dest[0] = mul255(src[0], a);
+		dest[1] = mul255(src[1], a);
+		dest[2] = mul255(src[2], a);
+		dest[3] = (unsigned char)a;
+	}
+}
+
+// 16.16 fixed point reciprocals of the alpha values, 255 * 65536 / a
+static unsigned int alphaReciprocals[256];
+
+static void initAlphaReciprocals() {
+	alphaReciprocals[0] = 0;
+	for(unsigned int a = 1; a < 256; a++)
+		alphaReciprocals[a] = (255 * 65536 + a / 2) / a;
+}
+
+static void unpremultiply(const unsigned char* src, unsigned char* dest, int pixels) {
+	for(int i = 0; i < pixels; i++, src += 4, dest += 4) {
+		unsigned int a = src[3];
+		unsigned int r = alphaReciprocals[a];
+		for(int c = 0; c < 3; c++) {
+			unsigned int v = (src[c] * r + 32768) >> 16;
+			dest[c] = (unsigned char)(v > 255?255:v);
+		}
+		dest[3] = (unsigned char)a;
+	}
+}
+
+static void forceOpaque(const unsigned char* src, unsigned char* dest, int pixels) {
+	for(int i = 0; i < pixels; i++, src += 4, dest += 4) {
+		dest[0] = src[0];
+		dest[1] = src[1];
+		dest[2] = src[2];
+		dest[3] = 255;
+	}
+}
+
+/*-----------------------------------------------------------------------------
+  SSE2 kernels
+-----------------------------------------------------------------------------*/
+static void bgraToRGBA_SSE2(const unsigned char* src, unsigned char* dest, int pixels) {
+	const __m128i maskAG = _mm_set1_epi32(0xff00ff00);
+	const __m128i maskB = _mm_set1_epi32(0x000000ff);
+	const __m128i maskR = _mm_set1_epi32(0x00ff0000);
+	int i = 0;
+	for(; i + 4 <= pixels; i += 4, src += 16, dest += 16) {
+		__m128i p = _mm_loadu_si128((const __m128i*)src);
+		__m128i ag = _mm_and_si128(p, maskAG);
+		__m128i b = _mm_slli_epi32(_mm_and_si128(p, maskB), 16);
+		__m128i r = _mm_srli_epi32(_mm_and_si128(p, maskR), 16);
+		_mm_storeu_si128((__m128i*)dest, _mm_or_si128(ag, _mm_or_si128(b, r)));
+	}
+	bgraToRGBA(src, dest, pixels - i);
+}
+
+static inline __m128i premultiply2_SSE2(__m128i p, __m128i alphaMask, __m128i alphaOne) {
+	// p holds two pixels as 16-bit lanes, broadcast alpha and replace it with 255 in the alpha lane
+	__m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(p, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+	a = _mm_or_si128(_mm_and_si128(a, alphaMask), alphaOne);
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(p, a), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static void premultiply_SSE2(const unsigned char* src, unsigned char* dest, int pixels) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alphaMask = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+	const __m128i alphaOne = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+	int i = 0;
+	for(; i + 4 <= pixels; i += 4, src += 16, dest += 16) {
+		__m128i p = _mm_loadu_si128((const __m128i*)src);
+		__m128i lo = premultiply2_SSE2(_mm_unpacklo_epi8(p, zero), alphaMask, alphaOne);
+		__m128i hi = premultiply2_SSE2(_mm_unpackhi_epi8(p, zero), alphaMask, alphaOne);
+		_mm_storeu_si128((__m128i*)dest, _mm_packus_epi16(lo, hi));
+	}
+	premultiply(src, dest, pixels - i);
+}
+
+// low 32 bits of the lane wise products, SSE2 only multiplies the even lanes
+static inline __m128i mullo32_SSE2(__m128i a, __m128i b) {
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// one channel of 4 pixels in 32-bit lanes, same rounding and clamping as the scalar kernel
+static inline __m128i unpremultiplyChannel_SSE2(__m128i c, __m128i r, __m128i round, __m128i max) {
+	__m128i v = _mm_srli_epi32(_mm_add_epi32(mullo32_SSE2(c, r), round), 16);
+	__m128i over = _mm_cmpgt_epi32(v, max);
+	return _mm_or_si128(_mm_andnot_si128(over, v), _mm_and_si128(over, max));
+}
+
+static void unpremultiply_SSE2(const unsigned char* src, unsigned char* dest, int pixels) {
+	const __m128i byteMask = _mm_set1_epi32(0xff);
+	const __m128i alphaMask = _mm_set1_epi32(0xff000000);
+	const __m128i round = _mm_set1_epi32(32768);
+	const __m128i max = _mm_set1_epi32(255);
+	int i = 0;
+	for(; i + 4 <= pixels; i += 4, src += 16, dest += 16) {
+		__m128i p = _mm_loadu_si128((const __m128i*)src);
+		__m128i r = _mm_setr_epi32(alphaReciprocals[src[3]], alphaReciprocals[src[7]], alphaReciprocals[src[11]], alphaReciprocals[src[15]]);
+		__m128i b = unpremultiplyChannel_SSE2(_mm_and_si128(p, byteMask), r, round, max);
+		__m128i g = unpremultiplyChannel_SSE2(_mm_and_si128(_mm_srli_epi32(p, 8), byteMask), r, round, max);
+		__m128i c = unpremultiplyChannel_SSE2(_mm_and_si128(_mm_srli_epi32(p, 16), byteMask), r, round, max);
+		__m128i result = _mm_or_si128(_mm_or_si128(b, _mm_slli_epi32(g, 8)), _mm_slli_epi32(c, 16));
+		_mm_storeu_si128((__m128i*)dest, _mm_or_si128(result, _mm_and_si128(p, alphaMask)));
+	}
+	unpremultiply(src, dest, pixels - i);
+}
+
+static void forceOpaque_SSE2(const unsigned char* src, unsigned char* dest, int pixels) {
+	const __m128i alpha = _mm_set1_epi32(0xff000000);
+	int i = 0;
+	for(; i + 4 <= pixels; i += 4, src += 16, dest += 16)
+		_mm_storeu_si128((__m128i*)dest, _mm_or_si128(_mm_loadu_si128((const __m128i*)src), alpha));
+	forceOpaque(src, dest, pixels - i);
+}
+
+/*-----------------------------------------------------------------------------
+  SSSE3 kernels
+-----------------------------------------------------------------------------*/
+static void bgraToRGBA_SSSE3(const unsigned char* src, unsigned char* dest, int pixels) {
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	int i = 0;
+	for(; i + 4 <= pixels; i += 4, src += 16, dest += 16)
+		_mm_storeu_si128((__m128i*)dest, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), shuffle));
+	bgraToRGBA(src, dest, pixels - i);
+}
+
+static void bgraToRGB_SSSE3(const unsigned char* src, unsigned char* dest, int pixels) {
+	// packs 4 pixels into the low 12 bytes, the 4 garbage bytes are overwritten
+	// by the next store, so stop while at least 6 pixels are left
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	int i = 0;
+	for(; i + 6 <= pixels; i += 4, src += 16, dest += 12)
+		_mm_storeu_si128((__m128i*)dest, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)src), shuffle));
+	bgraToRGB(src, dest, pixels - i);
+}
+
+/*-----------------------------------------------------------------------------
+  AVX2 kernels, the tails go to the SSE kernels
+-----------------------------------------------------------------------------*/
+static void bgraToRGBA_AVX2Row(const unsigned char* src, unsigned char* dest, int pixels) {
+	int done = bgraToRGBA_AVX2(src, dest, pixels);
+	bgraToRGBA_SSSE3(src + done * 4, dest + done * 4, pixels - done);
+}
+
+static void bgraToRGB_AVX2Row(const unsigned char* src, unsigned char* dest, int pixels) {
+	int done = bgraToRGB_AVX2(src, dest, pixels);
+	bgraToRGB_SSSE3(src + done * 4, dest + done * 3, pixels - done);
+}
+
+static void premultiply_AVX2Row(const unsigned char* src, unsigned char* dest, int pixels) {
+	int done = premultiply_AVX2(src, dest, pixels);
+	premultiply_SSE2(src + done * 4, dest + done * 4, pixels - done);
+}
+
+static void unpremultiply_AVX2Row(const unsigned char* src, unsigned char* dest, int pixels) {
+	int done = unpremultiply_AVX2(src, dest, pixels, alphaReciprocals);
+	unpremultiply_SSE2(src + done * 4, dest + done * 4, pixels - done);
+}
+
+static void forceOpaque_AVX2Row(const unsigned char* src, unsigned char* dest, int pixels) {
+	int done = forceOpaque_AVX2(src, dest, pixels);
+	forceOpaque_SSE2(src + done * 4, dest + done * 4, pixels - done);
+}
+
+/*-----------------------------------------------------------------------------
+  Runtime dispatch
+-----------------------------------------------------------------------------*/
+static int detectedLevel = -1;
+static int activeLevel = AWE_SIMD_NONE;
+static ConvertRowFunc kernels[AWE_CONVERT_FORCE_OPAQUE + 1];
+
+static int detectSIMDLevel() {
+	int info[4];
+	__cpuid(info, 1);
+	int level = AWE_SIMD_NONE;
+	if(info[3] & (1 << 26))
+		level = AWE_SIMD_SSE2;
+	if(level == AWE_SIMD_SSE2 && (info[2] & (1 << 9)))
+		level = AWE_SIMD_SSSE3;
+	if(level == AWE_SIMD_SSSE3 && detectAVX2())
+		level = AWE_SIMD_AVX2;
+	return level;
+}
+
+static void selectKernels(int level) {
+	kernels[AWE_CONVERT_BGRA_TO_RGBA] = bgraToRGBA;
+	kernels[AWE_CONVERT_BGRA_TO_RGB] = bgraToRGB;
+	kernels[AWE_CONVERT_PREMULTIPLY] = premultiply;
+	kernels[AWE_CONVERT_UNPREMULTIPLY] = unpremultiply;
+	kernels[AWE_CONVERT_FORCE_OPAQUE] = forceOpaque;
+	if(level >= AWE_SIMD_SSE2) {
+		kernels[AWE_CONVERT_BGRA_TO_RGBA] = bgraToRGBA_SSE2;
+		kernels[AWE_CONVERT_PREMULTIPLY] = premultiply_SSE2;
+		kernels[AWE_CONVERT_UNPREMULTIPLY] = unpremultiply_SSE2;
+		kernels[AWE_CONVERT_FORCE_OPAQUE] = forceOpaque_SSE2;
+	}
+	if(level >= AWE_SIMD_SSSE3) {
+		kernels[AWE_CONVERT_BGRA_TO_RGBA] = bgraToRGBA_SSSE3;
+		kernels[AWE_CONVERT_BGRA_TO_RGB] = bgraToRGB_SSSE3;
+	}
+	if(level >= AWE_SIMD_AVX2) {
+		kernels[AWE_CONVERT_BGRA_TO_RGBA] = bgraToRGBA_AVX2Row;
+		kernels[AWE_CONVERT_BGRA_TO_RGB] = bgraToRGB_AVX2Row;
+		kernels[AWE_CONVERT_PREMULTIPLY] = premultiply_AVX2Row;
+		kernels[AWE_CONVERT_UNPREMULTIPLY] = unpremultiply_AVX2Row;
+		kernels[AWE_CONVERT_FORCE_OPAQUE] = forceOpaque_AVX2Row;
+	}
+	activeLevel = level;
+}
+
+static void initKernels() {
+	if(detectedLevel >= 0)
+		return;
+	initAlphaReciprocals();
+	int level = detectSIMDLevel();
+	selectKernels(level);
+	detectedLevel = level;
+}
+
+/*-----------------------------------------------------------------------------
+  Conversion API
+-----------------------------------------------------------------------------*/
+EXPORT int awe_getSIMDLevel() {
+	initKernels();
+	return activeLevel;
+}
+
+EXPORT void awe_setSIMDLevel(int level) {
+	initKernels();
+	// can only go down from what the CPU supports
+	selectKernels(level > detectedLevel?detectedLevel:level);
+}
+
+EXPORT void awe_convertPixels(const unsigned char* src, int srcRowSpan, unsigned char* destBuffer, int destRowSpan, int width, int height, int conversion) {
+	if(conversion < AWE_CONVERT_BGRA_TO_RGBA || conversion > AWE_CONVERT_FORCE_OPAQUE || width <= 0)
+		return;
+	initKernels();
+	ConvertRowFunc kernel = kernels[conversion];
+	for(int y = 0; y < height; y++)
+		kernel(src + y * srcRowSpan, destBuffer + y * destRowSpan, width);
+}
+
+EXPORT void awe_RenderBuffer_convertArea(RenderBufferC renderBuffer, int x, int y, int width, int height, unsigned char* destBuffer, int destRowSpan, int conversion) {
+	RenderBuffer* ptr = static_cast<RenderBuffer*>(renderBuffer);
+	if(x < 0) { width += x; x = 0; }
+	if(y < 0) { height += y; y = 0; }
+	if(x + width > ptr->width) width = ptr->width - x;
+	if(y + height > ptr->height) height = ptr->height - y;
+	if(width <= 0 || height <= 0)
+		return;
+	awe_convertPixels(ptr->buffer + y * ptr->rowSpan + x * 4, ptr->rowSpan, destBuffer, destRowSpan, width, height, conversion);
+}
@@ -0,0 +1,146 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+/*-----------------------------------------------------------------------------
+  AVX2 kernels for convert.cpp. AVX2 intrinsics are only available starting
+  with Visual Studio 2013, older toolsets build this file without them and
+  convert.cpp never selects AWE_SIMD_AVX2. Every kernel converts the leading
+  pixels of a row and returns how many it converted, convert.cpp hands the
+  rest to the SSE kernels.
+-----------------------------------------------------------------------------*/
+#if defined(_MSC_VER) && _MSC_VER >= 1800
+#define AWE_HAVE_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef AWE_HAVE_AVX2
+// AVX2 also needs the OS to save the ymm registers on context switches
+bool detectAVX2() {
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	if(!osxsave || maxLeaf < 7 || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+}
+
+int bgraToRGBA_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+											 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+	int i = 0;
+	for(; i + 8 <= pixels; i += 8, src += 32, dest += 32)
+		_mm256_storeu_si256((__m256i*)dest, _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)src), shuffle));
+	return i;
+}
+
+int bgraToRGB_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	// packs 4 pixels into the low 12 bytes of each lane, then moves the two
+	// 12 byte runs next to each other. The 8 garbage bytes at the end are
+	// overwritten by the next store, so stop while at least 11 pixels are left.
+	const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+											 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+	int i = 0;
+	for(; i + 11 <= pixels; i += 8, src += 32, dest += 24) {
+		__m256i p = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)src), shuffle);
+		_mm256_storeu_si256((__m256i*)dest, _mm256_permutevar8x32_epi32(p, compact));
+	}
+	return i;
+}
+
+int premultiply_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	// broadcasts the alpha byte of each pixel into the 16-bit lanes of b, g and r
+	const __m256i alphaShuffle = _mm256_setr_epi8(6, -1, 6, -1, 6, -1, -1, -1, 14, -1, 14, -1, 14, -1, -1, -1,
+												  6, -1, 6, -1, 6, -1, -1, -1, 14, -1, 14, -1, 14, -1, -1, -1);
+	const __m256i alphaOne = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+	const __m256i round = _mm256_set1_epi16(128);
+	const __m256i zero = _mm256_setzero_si256();
+	int i = 0;
+	for(; i + 8 <= pixels; i += 8, src += 32, dest += 32) {
+		__m256i p = _mm256_loadu_si256((const __m256i*)src);
+		__m256i lo = _mm256_unpacklo_epi8(p, zero);
+		__m256i hi = _mm256_unpackhi_epi8(p, zero);
+		__m256i alo = _mm256_or_si256(_mm256_shuffle_epi8(lo, alphaShuffle), alphaOne);
+		__m256i ahi = _mm256_or_si256(_mm256_shuffle_epi8(hi, alphaShuffle), alphaOne);
+		__m256i tlo = _mm256_add_epi16(_mm256_mullo_epi16(lo, alo), round);
+		__m256i thi = _mm256_add_epi16(_mm256_mullo_epi16(hi, ahi), round);
+		tlo = _mm256_srli_epi16(_mm256_add_epi16(tlo, _mm256_srli_epi16(tlo, 8)), 8);
+		thi = _mm256_srli_epi16(_mm256_add_epi16(thi, _mm256_srli_epi16(thi, 8)), 8);
+		// unpack and pack work per 128-bit lane, so the order is preserved
+		_mm256_storeu_si256((__m256i*)dest, _mm256_packus_epi16(tlo, thi));
+	}
+	return i;
+}
+
+int unpremultiply_AVX2(const unsigned char* src, unsigned char* dest, int pixels, const unsigned int* reciprocals) {
+	const __m256i byteMask = _mm256_set1_epi32(0xff);
+	const __m256i alphaMask = _mm256_set1_epi32(0xff000000);
+	const __m256i round = _mm256_set1_epi32(32768);
+	const __m256i max = _mm256_set1_epi32(255);
+	int i = 0;
+	for(; i + 8 <= pixels; i += 8, src += 32, dest += 32) {
+		__m256i p = _mm256_loadu_si256((const __m256i*)src);
+		__m256i r = _mm256_i32gather_epi32((const int*)reciprocals, _mm256_srli_epi32(p, 24), 4);
+		__m256i b = _mm256_and_si256(p, byteMask);
+		__m256i g = _mm256_and_si256(_mm256_srli_epi32(p, 8), byteMask);
+		__m256i c = _mm256_and_si256(_mm256_srli_epi32(p, 16), byteMask);
+		b = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(b, r), round), 16), max);
+		g = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(g, r), round), 16), max);
+		c = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(c, r), round), 16), max);
+		__m256i result = _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)), _mm256_slli_epi32(c, 16));
+		_mm256_storeu_si256((__m256i*)dest, _mm256_or_si256(result, _mm256_and_si256(p, alphaMask)));
+	}
+	return i;
+}
+
+int forceOpaque_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	const __m256i alpha = _mm256_set1_epi32(0xff000000);
+	int i = 0;
+	for(; i + 8 <= pixels; i += 8, src += 32, dest += 32)
+		_mm256_storeu_si256((__m256i*)dest, _mm256_or_si256(_mm256_loadu_si256((const __m256i*)src), alpha));
+	return i;
+}
+#else
+bool detectAVX2() {
+	return false;
+}
+
+int bgraToRGBA_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	return 0;
+}
+
+int bgraToRGB_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	return 0;
+}
+
+int premultiply_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	return 0;
+}
+
+int unpremultiply_AVX2(const unsigned char* src, unsigned char* dest, int pixels, const unsigned int* reciprocals) {
+	return 0;
+}
+
+int forceOpaque_AVX2(const unsigned char* src, unsigned char* dest, int pixels) {
+	return 0;
+}
+#endif
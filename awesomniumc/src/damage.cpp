@@ -0,0 +1,121 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "internal.h"
+#include <string.h>
+
+RectC makeRect(int x, int y, int width, int height) {
+	RectC rect;
+	rect.x = x;
+	rect.y = y;
+	rect.width = width;
+	rect.height = height;
+	return rect;
+}
+
+// compares the tiles covered by the dirty bounds against the shadow copy,
+// updates the shadow and collects the changed tiles as a list of rects.
+// horizontally adjacent tiles are merged into runs, runs with the same
+// horizontal extent in consecutive tile rows are merged vertically.
+void trackDamage(DamageShadow& shadow, const unsigned char* pixels, int width, int height, int rowSpan, const RectC& dirty, std::vector<RectC>& dirtyRects) {
+	int shadowRowSpan = width * 4;
+	dirtyRects.clear();
+
+	if(shadow.width != width || shadow.height != height) {
+		shadow.pixels.resize(shadowRowSpan * height);
+		shadow.width = width;
+		shadow.height = height;
+		for(int y = 0; y < height; y++)
+			memcpy(&shadow.pixels[y * shadowRowSpan], pixels + y * rowSpan, shadowRowSpan);
+		dirtyRects.push_back(makeRect(0, 0, width, height));
+		return;
+	}
+	if(dirty.width == 0 || dirty.height == 0)
+		return;
+
+	int tx0 = dirty.x / AWE_DAMAGE_TILE_SIZE;
+	int ty0 = dirty.y / AWE_DAMAGE_TILE_SIZE;
+	int tx1 = (dirty.x + dirty.width - 1) / AWE_DAMAGE_TILE_SIZE;
+	int ty1 = (dirty.y + dirty.height - 1) / AWE_DAMAGE_TILE_SIZE;
+	for(int ty = ty0; ty <= ty1; ty++) {
+		int y = ty * AWE_DAMAGE_TILE_SIZE;
+		int tileHeight = y + AWE_DAMAGE_TILE_SIZE > height?height - y:AWE_DAMAGE_TILE_SIZE;
+		int runStart = -1;
+
+		for(int tx = tx0; tx <= tx1 + 1; tx++) {
+			bool changed = false;
+			if(tx <= tx1) {
+				int x = tx * AWE_DAMAGE_TILE_SIZE;
+				int tileBytes = (x + AWE_DAMAGE_TILE_SIZE > width?width - x:AWE_DAMAGE_TILE_SIZE) * 4;
+				int row = 0;
+				for(; row < tileHeight; row++) {
+					if(memcmp(pixels + (y + row) * rowSpan + x * 4, &shadow.pixels[(y + row) * shadowRowSpan + x * 4], tileBytes) != 0)
+						break;
+				}
+				changed = row < tileHeight;
+				for(; row < tileHeight; row++)
+					memcpy(&shadow.pixels[(y + row) * shadowRowSpan + x * 4], pixels + (y + row) * rowSpan + x * 4, tileBytes);
+			}
+
+			if(changed && runStart < 0)
+				runStart = tx;
+			if(!changed && runStart >= 0) {
+				int x = runStart * AWE_DAMAGE_TILE_SIZE;
+				int x1 = tx * AWE_DAMAGE_TILE_SIZE > width?width:tx * AWE_DAMAGE_TILE_SIZE;
+				bool merged = false;
+				for(size_t i = 0; i < dirtyRects.size(); i++) {
+					RectC& rect = dirtyRects[i];
+					if(rect.x == x && rect.width == x1 - x && rect.y + rect.height == y) {
+						rect.height += tileHeight;
+						merged = true;
+						break;
+					}
+				}
+				if(!merged)
+					dirtyRects.push_back(makeRect(x, y, x1 - x, tileHeight));
+				runStart = -1;
+			}
+		}
+	}
+}
+
+// copies up to maxRects rects, whatever does not fit is collapsed into the last slot
+int copyDirtyRects(const std::vector<RectC>& dirtyRects, RectC* rects, int maxRects) {
+	int count = (int)dirtyRects.size();
+	if(!rects)
+		return count;
+	if(maxRects <= 0)
+		return 0;
+
+	int written = count < maxRects?count:maxRects;
+	for(int i = 0; i < written; i++)
+		rects[i] = dirtyRects[i];
+	if(count > maxRects) {
+		RectC& last = rects[maxRects - 1];
+		int x1 = last.x + last.width, y1 = last.y + last.height;
+		for(int i = maxRects; i < count; i++) {
+			const RectC& rect = dirtyRects[i];
+			if(rect.x < last.x) last.x = rect.x;
+			if(rect.y < last.y) last.y = rect.y;
+			if(rect.x + rect.width > x1) x1 = rect.x + rect.width;
+			if(rect.y + rect.height > y1) y1 = rect.y + rect.height;
+		}
+		last.width = x1 - last.x;
+		last.height = y1 - last.y;
+	}
+	return written;
+}
@@ -0,0 +1,55 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef __awesomnium_internal_h_
+#define __awesomnium_internal_h_
+
+// helpers of the wrapper that don't depend on a WebCore, awesomniumc-tests
+// compiles their translation units into the unit tests
+#include "awesomiumc.h"
+#include "JSValue.h"
+#include <string>
+#include <vector>
+
+#define AWE_DAMAGE_TILE_SIZE 64
+
+// tightly packed copy of the last frame handed out
+struct DamageShadow {
+	std::vector<unsigned char> pixels;
+	int width;
+	int height;
+
+	DamageShadow() {
+		width = 0;
+		height = 0;
+	}
+};
+
+// damage.cpp
+RectC makeRect(int x, int y, int width, int height);
+void trackDamage(DamageShadow& shadow, const unsigned char* pixels, int width, int height, int rowSpan, const RectC& dirty, std::vector<RectC>& dirtyRects);
+int copyDirtyRects(const std::vector<RectC>& dirtyRects, RectC* rects, int maxRects);
+
+// utf8.cpp
+void encodeUTF8(std::vector<char>& out, const wchar_t* str, size_t length);
+size_t getChunkLength(const std::wstring& contents, size_t offset, size_t chunkSize);
+
+// jsvalues.cpp
+bool equalJSValues(const Awesomium::JSValue& a, const Awesomium::JSValue& b);
+
+#endif
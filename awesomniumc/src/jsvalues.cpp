@@ -0,0 +1,62 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "internal.h"
+
+using namespace Awesomium;
+
+// integers and doubles are both numbers to the page, so 1 and 1.0 are equal,
+// and NaN is equal to NaN so a NaN property is not sent again on every sync
+bool equalJSValues(const JSValue& a, const JSValue& b) {
+	if(a.isNull() || b.isNull())
+		return a.isNull() && b.isNull();
+	if(a.isBoolean())
+		return b.isBoolean() && a.toBoolean() == b.toBoolean();
+	if(a.isInteger() && b.isInteger())
+		return a.toInteger() == b.toInteger();
+	if(a.isInteger() || a.isDouble()) {
+		if(!b.isInteger() && !b.isDouble())
+			return false;
+		double x = a.toDouble(), y = b.toDouble();
+		return x == y || (x != x && y != y);
+	}
+	if(a.isString())
+		return b.isString() && a.toString() == b.toString();
+	if(a.isArray()) {
+		if(!b.isArray() || a.getArray().size() != b.getArray().size())
+			return false;
+		const JSValue::Array& arrayA = a.getArray();
+		const JSValue::Array& arrayB = b.getArray();
+		for(size_t i = 0; i < arrayA.size(); i++) {
+			if(!equalJSValues(arrayA[i], arrayB[i]))
+				return false;
+		}
+		return true;
+	}
+	if(a.isObject()) {
+		if(!b.isObject() || a.getObject().size() != b.getObject().size())
+			return false;
+		const JSValue::Object& objectA = a.getObject();
+		const JSValue::Object& objectB = b.getObject();
+		for(JSValue::Object::const_iterator itA = objectA.begin(), itB = objectB.begin(); itA != objectA.end(); itA++, itB++) {
+			if(itA->first != itB->first || !equalJSValues(itA->second, itB->second))
+				return false;
+		}
+		return true;
+	}
+	return false;
+}
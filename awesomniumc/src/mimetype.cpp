@@ -0,0 +1,51 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "awesomiumc_pack.h"
+#include <string.h>
+#include <ctype.h>
+
+const char* awe_guessMimeType(const char* path) {
+	static const char* types[][2] = {
+		{ ".html", "text/html" },
+		{ ".htm", "text/html" },
+		{ ".css", "text/css" },
+		{ ".js", "application/javascript" },
+		{ ".json", "application/json" },
+		{ ".xml", "text/xml" },
+		{ ".txt", "text/plain" },
+		{ ".png", "image/png" },
+		{ ".jpg", "image/jpeg" },
+		{ ".jpeg", "image/jpeg" },
+		{ ".gif", "image/gif" },
+		{ ".svg", "image/svg+xml" },
+		{ ".ico", "image/x-icon" },
+		{ ".ttf", "application/x-font-ttf" },
+		{ ".woff", "application/font-woff" },
+		{ ".swf", "application/x-shockwave-flash" }
+	};
+	const char* extension = strrchr(path, '.');
+	size_t i, j;
+	if(!extension)
+		return "application/octet-stream";
+	for(i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+		for(j = 0; extension[j] && tolower((unsigned char)extension[j]) == types[i][0][j]; j++);
+		if(!extension[j] && !types[i][0][j])
+			return types[i][1];
+	}
+	return "application/octet-stream";
+}
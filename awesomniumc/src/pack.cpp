@@ -0,0 +1,198 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#define EXPORTS
+#include "awesomiumc.h"
+#include "awesomiumc_pack.h"
+#include "ResourceInterceptor.h"
+#include <string>
+#include <vector>
+
+using namespace Awesomium;
+
+struct ResourcePack {
+	HANDLE file;
+	HANDLE mapping;
+	const unsigned char* base;
+	size_t size;
+	const ResourcePackEntryC* entries;
+	unsigned int entryCount;
+	std::string urlPrefix;
+};
+
+// mounted packs, searched by awe_ResourcePack_createResponse from any thread
+struct MountedPacks {
+	CRITICAL_SECTION lock;
+	std::vector<ResourcePack*> packs;
+
+	MountedPacks() {
+		InitializeCriticalSection(&lock);
+	}
+
+	~MountedPacks() {
+		DeleteCriticalSection(&lock);
+	}
+};
+
+static MountedPacks mountedPacks;
+
+static void closePack(ResourcePack* pack) {
+	if(pack->base)
+		UnmapViewOfFile(pack->base);
+	if(pack->mapping)
+		CloseHandle(pack->mapping);
+	if(pack->file != INVALID_HANDLE_VALUE)
+		CloseHandle(pack->file);
+	delete pack;
+}
+
+static bool isValidString(const ResourcePack* pack, unsigned int offset) {
+	return offset < pack->size && memchr(pack->base + offset, 0, pack->size - offset) != 0;
+}
+
+// checks every offset and the order of the paths once so lookups can trust the index
+static bool validatePack(ResourcePack* pack) {
+	if(pack->size < sizeof(ResourcePackHeaderC))
+		return false;
+	const ResourcePackHeaderC* header = reinterpret_cast<const ResourcePackHeaderC*>(pack->base);
+	if(header->magic != AWE_PACK_MAGIC || header->version != AWE_PACK_VERSION)
+		return false;
+	if((pack->size - sizeof(ResourcePackHeaderC)) / sizeof(ResourcePackEntryC) < header->entryCount)
+		return false;
+	pack->entries = reinterpret_cast<const ResourcePackEntryC*>(header + 1);
+	pack->entryCount = header->entryCount;
+	for(unsigned int i = 0; i < pack->entryCount; i++) {
+		const ResourcePackEntryC& entry = pack->entries[i];
+		if(!isValidString(pack, entry.pathOffset) || !isValidString(pack, entry.mimeTypeOffset))
+			return false;
+		if(entry.dataOffset > pack->size || entry.dataSize > pack->size - entry.dataOffset)
+			return false;
+		if(i > 0 && strcmp(reinterpret_cast<const char*>(pack->base + pack->entries[i - 1].pathOffset), reinterpret_cast<const char*>(pack->base + entry.pathOffset)) >= 0)
+			return false;
+	}
+	return true;
+}
+
+static const ResourcePackEntryC* findEntry(const ResourcePack* pack, const char* path) {
+	unsigned int low = 0;
+	unsigned int high = pack->entryCount;
+	while(low < high) {
+		unsigned int middle = low + (high - low) / 2;
+		int result = strcmp(reinterpret_cast<const char*>(pack->base + pack->entries[middle].pathOffset), path);
+		if(result == 0)
+			return &pack->entries[middle];
+		if(result < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return 0;
+}
+
+// strips the query and fragment and decodes %XX escapes
+static std::string getPackPath(const char* url) {
+	std::string path;
+	for(; *url && *url != '?' && *url != '#'; url++) {
+		if(url[0] == '%' && isxdigit((unsigned char)url[1]) && isxdigit((unsigned char)url[2])) {
+			char hex[3] = { url[1], url[2], 0 };
+			path += (char)strtol(hex, 0, 16);
+			url += 2;
+		}
+		else
+			path += *url;
+	}
+	return path;
+}
+
+EXPORT ResourcePackC awe_ResourcePack_open(const wchar_t* filePath, const char* urlPrefix) {
+	ResourcePack* pack = new ResourcePack();
+	pack->file = CreateFileW(filePath, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, 0);
+	pack->mapping = 0;
+	pack->base = 0;
+	pack->size = 0;
+	pack->entries = 0;
+	pack->entryCount = 0;
+	pack->urlPrefix = urlPrefix?urlPrefix:"";
+	if(pack->file == INVALID_HANDLE_VALUE) {
+		closePack(pack);
+		return 0;
+	}
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(pack->file, &size) || size.QuadPart == 0 || size.HighPart != 0) {
+		closePack(pack);
+		return 0;
+	}
+	pack->size = (size_t)size.QuadPart;
+	pack->mapping = CreateFileMappingW(pack->file, 0, PAGE_READONLY, 0, 0, 0);
+	if(pack->mapping)
+		pack->base = static_cast<const unsigned char*>(MapViewOfFile(pack->mapping, FILE_MAP_READ, 0, 0, 0));
+	if(!pack->base || !validatePack(pack)) {
+		closePack(pack);
+		return 0;
+	}
+
+	EnterCriticalSection(&mountedPacks.lock);
+	mountedPacks.packs.push_back(pack);
+	LeaveCriticalSection(&mountedPacks.lock);
+	return pack;
+}
+
+EXPORT void awe_ResourcePack_close(ResourcePackC resourcePack) {
+	ResourcePack* pack = static_cast<ResourcePack*>(resourcePack);
+	EnterCriticalSection(&mountedPacks.lock);
+	for(size_t i = 0; i < mountedPacks.packs.size(); i++) {
+		if(mountedPacks.packs[i] == pack) {
+			mountedPacks.packs.erase(mountedPacks.packs.begin() + i);
+			break;
+		}
+	}
+	LeaveCriticalSection(&mountedPacks.lock);
+	closePack(pack);
+}
+
+EXPORT int awe_ResourcePack_getEntryCount(ResourcePackC resourcePack) {
+	ResourcePack* pack = static_cast<ResourcePack*>(resourcePack);
+	return (int)pack->entryCount;
+}
+
+EXPORT int awe_ResourcePack_find(ResourcePackC resourcePack, const char* path, const unsigned char** buffer, int* numBytes, const char** mimeType) {
+	ResourcePack* pack = static_cast<ResourcePack*>(resourcePack);
+	const ResourcePackEntryC* entry = findEntry(pack, path);
+	if(!entry)
+		return 0;
+	*buffer = pack->base + entry->dataOffset;
+	*numBytes = (int)entry->dataSize;
+	if(mimeType)
+		*mimeType = reinterpret_cast<const char*>(pack->base + entry->mimeTypeOffset);
+	return -1;
+}
+
+EXPORT ResourceResponseC awe_ResourcePack_createResponse(const char* url) {
+	ResourceResponse* response = 0;
+	EnterCriticalSection(&mountedPacks.lock);
+	for(size_t i = 0; i < mountedPacks.packs.size() && !response; i++) {
+		const ResourcePack* pack = mountedPacks.packs[i];
+		if(strncmp(url, pack->urlPrefix.c_str(), pack->urlPrefix.size()) != 0)
+			continue;
+		const ResourcePackEntryC* entry = findEntry(pack, getPackPath(url + pack->urlPrefix.size()).c_str());
+		// Create copies the body out of the mapping
+		if(entry)
+			response = ResourceResponse::Create(entry->dataSize, const_cast<unsigned char*>(pack->base + entry->dataOffset), std::string(reinterpret_cast<const char*>(pack->base + entry->mimeTypeOffset)));
+	}
+	LeaveCriticalSection(&mountedPacks.lock);
+	return response;
+}
@@ -0,0 +1,369 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#define EXPORTS
+#include "awesomiumc.h"
+#include "awesomiumc_shard.h"
+#include "awesomiumc_shm.h"
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+
+/*-----------------------------------------------------------------------------
+  WebCore shards, spreads WebViews over awesomniumc-worker processes that each
+  run their own WebCore. Awesomium allows one WebCore per process, so this is
+  the only way to render pages on more than one core. Commands go down each
+  worker's stdin, events come back on its stdout and are dispatched from
+  awe_WebCoreShards_update, frames are read from the shared memory rings.
+-----------------------------------------------------------------------------*/
+#define AWE_SHARD_PIPE_SIZE (64 * 1024)
+
+struct WebCoreShards;
+
+struct ShardWorker {
+	HANDLE process;
+	HANDLE commands;
+	HANDLE events;
+	std::vector<char> received;
+	int viewCount;
+	bool alive;
+};
+
+struct RemoteWebView {
+	WebCoreShards* shards;
+	int worker;
+	int viewId;
+	int maxWidth;
+	int maxHeight;
+	SharedFramesReaderC reader;
+	SharedFrameC frame;
+};
+
+struct WebCoreShards {
+	std::vector<ShardWorker> workers;
+	std::map<int, RemoteWebView*> views;
+	int id;
+	int nextViewId;
+	ShardEventCallbackC callback;
+	void* userData;
+};
+
+// keeps the mapping names of shards in the same process apart
+static volatile LONG nextShardsId = 0;
+
+static bool startWorker(const wchar_t* workerPath, ShardWorker* worker) {
+	SECURITY_ATTRIBUTES security = { sizeof(SECURITY_ATTRIBUTES), 0, TRUE };
+	HANDLE childInput, childOutput;
+	if(!CreatePipe(&childInput, &worker->commands, &security, AWE_SHARD_PIPE_SIZE))
+		return false;
+	if(!CreatePipe(&worker->events, &childOutput, &security, AWE_SHARD_PIPE_SIZE)) {
+		CloseHandle(childInput);
+		CloseHandle(worker->commands);
+		return false;
+	}
+	// only the child's ends are inherited
+	SetHandleInformation(worker->commands, HANDLE_FLAG_INHERIT, 0);
+	SetHandleInformation(worker->events, HANDLE_FLAG_INHERIT, 0);
+
+	STARTUPINFOW startup;
+	memset(&startup, 0, sizeof(STARTUPINFOW));
+	startup.cb = sizeof(STARTUPINFOW);
+	startup.dwFlags = STARTF_USESTDHANDLES;
+	startup.hStdInput = childInput;
+	startup.hStdOutput = childOutput;
+	startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+	PROCESS_INFORMATION info;
+	std::wstring commandLine = std::wstring(L"\"") + workerPath + L"\"";
+	BOOL started = CreateProcessW(workerPath, &commandLine[0], 0, 0, TRUE, CREATE_NO_WINDOW, 0, 0, &startup, &info);
+	CloseHandle(childInput);
+	CloseHandle(childOutput);
+	if(!started) {
+		CloseHandle(worker->commands);
+		CloseHandle(worker->events);
+		return false;
+	}
+	CloseHandle(info.hThread);
+	worker->process = info.hProcess;
+	worker->viewCount = 0;
+	worker->alive = true;
+	return true;
+}
+
+static void notify(WebCoreShards* shards, RemoteWebView* view, int event) {
+	if(shards->callback)
+		shards->callback(view, event, shards->userData);
+}
+
+// the callback may destroy views, so they are collected before it is called
+static void workerExited(WebCoreShards* shards, int index) {
+	ShardWorker& worker = shards->workers[index];
+	worker.alive = false;
+	std::vector<int> viewIds;
+	for(std::map<int, RemoteWebView*>::iterator it = shards->views.begin(); it != shards->views.end(); it++) {
+		if(it->second->worker == index)
+			viewIds.push_back(it->first);
+	}
+	for(size_t i = 0; i < viewIds.size(); i++) {
+		std::map<int, RemoteWebView*>::iterator view = shards->views.find(viewIds[i]);
+		if(view != shards->views.end())
+			notify(shards, view->second, AWE_SHARD_EVENT_WORKER_EXITED);
+	}
+}
+
+static void sendCommand(RemoteWebView* view, int type, int a, int b, const void* payload, int payloadSize) {
+	WebCoreShards* shards = view->shards;
+	ShardWorker& worker = shards->workers[view->worker];
+	if(!worker.alive)
+		return;
+	if(!awe_ShardMessage_write(worker.commands, type, view->viewId, a, b, 0, 0, payload, payloadSize))
+		workerExited(shards, view->worker);
+}
+
+// a worker speaking another protocol version is treated as exited
+static void dispatchEvent(WebCoreShards* shards, int index, const ShardMessageC& message) {
+	if(message.type == AWE_SHARD_READY) {
+		if(message.a != AWE_SHARD_PROTOCOL_VERSION)
+			workerExited(shards, index);
+		return;
+	}
+	std::map<int, RemoteWebView*>::iterator view = shards->views.find(message.viewId);
+	if(view == shards->views.end())
+		return;
+	switch(message.type) {
+		case AWE_SHARD_FINISH_LOADING: notify(shards, view->second, AWE_SHARD_EVENT_FINISH_LOADING); break;
+		case AWE_SHARD_VIEW_CRASHED: notify(shards, view->second, AWE_SHARD_EVENT_CRASHED); break;
+		case AWE_SHARD_CREATE_FAILED: notify(shards, view->second, AWE_SHARD_EVENT_CREATE_FAILED); break;
+	}
+}
+
+// reads whatever the worker has written so far without blocking
+static void receiveEvents(WebCoreShards* shards, int index) {
+	ShardWorker& worker = shards->workers[index];
+	DWORD available = 0;
+	if(!PeekNamedPipe(worker.events, 0, 0, 0, &available, 0)) {
+		workerExited(shards, index);
+		return;
+	}
+	if(available == 0)
+		return;
+	size_t offset = worker.received.size();
+	worker.received.resize(offset + available);
+	DWORD read = 0;
+	if(!ReadFile(worker.events, &worker.received[offset], available, &read, 0)) {
+		workerExited(shards, index);
+		return;
+	}
+	worker.received.resize(offset + read);
+
+	size_t position = 0;
+	while(worker.alive && worker.received.size() - position >= sizeof(ShardMessageC)) {
+		ShardMessageC message;
+		memcpy(&message, &worker.received[position], sizeof(ShardMessageC));
+		if(message.payloadSize < 0) {
+			worker.received.clear();
+			workerExited(shards, index);
+			return;
+		}
+		if(worker.received.size() - position < sizeof(ShardMessageC) + message.payloadSize)
+			break;
+		position += sizeof(ShardMessageC) + message.payloadSize;
+		dispatchEvent(shards, index, message);
+	}
+	worker.received.erase(worker.received.begin(), worker.received.begin() + position);
+}
+
+EXPORT WebCoreShardsC awe_WebCoreShards_new(const wchar_t* workerPath, int workerCount) {
+	WebCoreShards* shards = new WebCoreShards();
+	shards->id = InterlockedIncrement(&nextShardsId);
+	shards->nextViewId = 1;
+	shards->callback = 0;
+	shards->userData = 0;
+	for(int i = 0; i < workerCount; i++) {
+		ShardWorker worker;
+		if(startWorker(workerPath, &worker))
+			shards->workers.push_back(worker);
+	}
+	if(shards->workers.empty()) {
+		delete shards;
+		return 0;
+	}
+	return shards;
+}
+
+EXPORT void awe_WebCoreShards_delete(WebCoreShardsC webCoreShards) {
+	WebCoreShards* shards = static_cast<WebCoreShards*> (webCoreShards);
+	for(std::map<int, RemoteWebView*>::iterator it = shards->views.begin(); it != shards->views.end(); it++) {
+		awe_SharedFrames_close(&it->second->reader);
+		delete it->second;
+	}
+	for(size_t i = 0; i < shards->workers.size(); i++) {
+		ShardWorker& worker = shards->workers[i];
+		if(worker.alive)
+			awe_ShardMessage_write(worker.commands, AWE_SHARD_SHUTDOWN, 0, 0, 0, 0, 0, 0, 0);
+		CloseHandle(worker.commands);
+	}
+	// workers shut their WebCore down cleanly, give them a moment before pulling the plug
+	for(size_t i = 0; i < shards->workers.size(); i++) {
+		ShardWorker& worker = shards->workers[i];
+		if(WaitForSingleObject(worker.process, 5000) != WAIT_OBJECT_0)
+			TerminateProcess(worker.process, 1);
+		CloseHandle(worker.process);
+		CloseHandle(worker.events);
+	}
+	delete shards;
+}
+
+EXPORT void awe_WebCoreShards_setCallback(WebCoreShardsC webCoreShards, ShardEventCallbackC callback, void* userData) {
+	WebCoreShards* shards = static_cast<WebCoreShards*> (webCoreShards);
+	shards->callback = callback;
+	shards->userData = userData;
+}
+
+EXPORT int awe_WebCoreShards_getWorkerCount(WebCoreShardsC webCoreShards) {
+	WebCoreShards* shards = static_cast<WebCoreShards*> (webCoreShards);
+	int count = 0;
+	for(size_t i = 0; i < shards->workers.size(); i++) {
+		if(shards->workers[i].alive)
+			count++;
+	}
+	return count;
+}
+
+EXPORT void awe_WebCoreShards_update(WebCoreShardsC webCoreShards) {
+	WebCoreShards* shards = static_cast<WebCoreShards*> (webCoreShards);
+	for(size_t i = 0; i < shards->workers.size(); i++) {
+		if(shards->workers[i].alive)
+			receiveEvents(shards, (int)i);
+	}
+}
+
+// new views go to the live worker with the fewest views
+EXPORT RemoteWebViewC awe_WebCoreShards_createWebView(WebCoreShardsC webCoreShards, int width, int height, int maxWidth, int maxHeight) {
+	WebCoreShards* shards = static_cast<WebCoreShards*> (webCoreShards);
+	int best = -1;
+	for(size_t i = 0; i < shards->workers.size(); i++) {
+		if(shards->workers[i].alive && (best < 0 || shards->workers[i].viewCount < shards->workers[best].viewCount))
+			best = (int)i;
+	}
+	if(best < 0)
+		return 0;
+
+	RemoteWebView* view = new RemoteWebView();
+	view->shards = shards;
+	view->worker = best;
+	view->viewId = shards->nextViewId++;
+	view->maxWidth = maxWidth > width?maxWidth:width;
+	view->maxHeight = maxHeight > height?maxHeight:height;
+	memset(&view->reader, 0, sizeof(SharedFramesReaderC));
+	memset(&view->frame, 0, sizeof(SharedFrameC));
+	wchar_t mappingName[64];
+	awe_ShardMessage_mappingName(mappingName, 64, GetCurrentProcessId(), shards->id, view->viewId);
+	if(!awe_ShardMessage_write(shards->workers[best].commands, AWE_SHARD_CREATE_VIEW, view->viewId, width, height, view->maxWidth, view->maxHeight,
+		mappingName, (int)(wcslen(mappingName) + 1) * sizeof(wchar_t))) {
+		workerExited(shards, best);
+		delete view;
+		return 0;
+	}
+	shards->workers[best].viewCount++;
+	shards->views[view->viewId] = view;
+	return view;
+}
+
+// the view is forgotten before the command is sent, so a failed send can't
+// report the view to a callback that destroys it again
+EXPORT void awe_RemoteWebView_destroy(RemoteWebViewC remoteWebView) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	view->shards->workers[view->worker].viewCount--;
+	view->shards->views.erase(view->viewId);
+	sendCommand(view, AWE_SHARD_DESTROY_VIEW, 0, 0, 0, 0);
+	awe_SharedFrames_close(&view->reader);
+	delete view;
+}
+
+EXPORT int awe_RemoteWebView_getWorker(RemoteWebViewC remoteWebView) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	return view->worker;
+}
+
+EXPORT void awe_RemoteWebView_loadURL(RemoteWebViewC remoteWebView, const char* url) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	sendCommand(view, AWE_SHARD_LOAD_URL, 0, 0, url, (int)strlen(url) + 1);
+}
+
+EXPORT void awe_RemoteWebView_loadHTML(RemoteWebViewC remoteWebView, const char* html) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	sendCommand(view, AWE_SHARD_LOAD_HTML, 0, 0, html, (int)strlen(html) + 1);
+}
+
+EXPORT void awe_RemoteWebView_executeJavascript(RemoteWebViewC remoteWebView, const char* javascript) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	sendCommand(view, AWE_SHARD_EXECUTE_JAVASCRIPT, 0, 0, javascript, (int)strlen(javascript) + 1);
+}
+
+// sizes above the maximum passed to awe_WebCoreShards_createWebView are cropped in the frames
+EXPORT void awe_RemoteWebView_resize(RemoteWebViewC remoteWebView, int width, int height) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	sendCommand(view, AWE_SHARD_RESIZE, width, height, 0, 0);
+}
+
+EXPORT void awe_RemoteWebView_injectEvents(RemoteWebViewC remoteWebView, const InputEventC* events, int count) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	if(count > 0)
+		sendCommand(view, AWE_SHARD_INPUT, 0, 0, events, count * sizeof(InputEventC));
+}
+
+// copies the latest frame into destBuffer if it is newer than the last one copied, only the
+// dirty area unless frames were skipped. The buffer has to hold the view's maximum size.
+EXPORT int awe_RemoteWebView_copyFrame(RemoteWebViewC remoteWebView, unsigned char* destBuffer, int destRowSpan, int* width, int* height, RectC* dirty) {
+	RemoteWebView* view = static_cast<RemoteWebView*> (remoteWebView);
+	if(!view->reader.base) {
+		// the worker creates the ring when it processes the create command
+		wchar_t mappingName[64];
+		awe_ShardMessage_mappingName(mappingName, 64, GetCurrentProcessId(), view->shards->id, view->viewId);
+		if(!awe_SharedFrames_open(&view->reader, mappingName))
+			return 0;
+	}
+	SharedFrameC frame = view->frame;
+	if(!awe_SharedFrames_acquireLatest(&view->reader, &frame))
+		return 0;
+
+	RectC area;
+	if(view->frame.sequence && frame.sequence == view->frame.sequence + 2) {
+		area.x = frame.dirtyX;
+		area.y = frame.dirtyY;
+		area.width = frame.dirtyWidth;
+		area.height = frame.dirtyHeight;
+	} else {
+		area.x = 0;
+		area.y = 0;
+		area.width = frame.width;
+		area.height = frame.height;
+	}
+	for(int y = area.y; y < area.y + area.height; y++)
+		memcpy(destBuffer + y * destRowSpan + area.x * 4, frame.buffer + y * frame.rowSpan + area.x * 4, area.width * 4);
+	// the slot was reused while copying, the next call copies the whole frame
+	if(!awe_SharedFrames_validate(&view->reader, &frame)) {
+		view->frame.sequence = 0;
+		return 0;
+	}
+	view->frame = frame;
+	*width = frame.width;
+	*height = frame.height;
+	*dirty = area;
+	return -1;
+}
@@ -0,0 +1,123 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#define EXPORTS
+#include "awesomiumc.h"
+#include "awesomiumc_stats.h"
+#include <string.h>
+#include <map>
+
+#ifdef AWE_ENABLE_STATS
+struct StatsKey {
+	const char* name;
+	void* webView;
+
+	bool operator<(const StatsKey& other) const {
+		if(name != other.name)
+			return name < other.name;
+		return webView < other.webView;
+	}
+};
+
+// calls are recorded from the update thread and the resource interceptor
+// threads as well as the host thread
+struct Stats {
+	CRITICAL_SECTION lock;
+	std::map<StatsKey, StatsEntryC> entries;
+	double msPerTick;
+
+	Stats() {
+		InitializeCriticalSection(&lock);
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		msPerTick = 1000.0 / frequency.QuadPart;
+	}
+
+	~Stats() {
+		DeleteCriticalSection(&lock);
+	}
+};
+
+static Stats stats;
+
+// bucket 0 holds calls under 1 microsecond, bucket i those under 2^i, the last one everything slower
+static int getStatsBucket(double ms) {
+	double us = ms * 1000;
+	int bucket = 0;
+	while(bucket < AWE_STATS_BUCKETS - 1 && us >= 1) {
+		us /= 2;
+		bucket++;
+	}
+	return bucket;
+}
+
+void awe_recordStat(const char* name, void* webView, LONGLONG ticks) {
+	StatsKey key;
+	key.name = name;
+	key.webView = webView;
+	double ms = ticks * stats.msPerTick;
+	EnterCriticalSection(&stats.lock);
+	std::map<StatsKey, StatsEntryC>::iterator it = stats.entries.find(key);
+	if(it == stats.entries.end()) {
+		StatsEntryC entry;
+		memset(&entry, 0, sizeof(StatsEntryC));
+		entry.name = name;
+		entry.webView = webView;
+		it = stats.entries.insert(std::make_pair(key, entry)).first;
+	}
+	StatsEntryC& entry = it->second;
+	entry.count++;
+	entry.totalMs += ms;
+	if(ms > entry.maxMs)
+		entry.maxMs = ms;
+	entry.histogram[getStatsBucket(ms)]++;
+	LeaveCriticalSection(&stats.lock);
+}
+#endif
+
+/*-----------------------------------------------------------------------------
+  Stats API
+-----------------------------------------------------------------------------*/
+EXPORT int awe_Stats_isEnabled() {
+#ifdef AWE_ENABLE_STATS
+	return -1;
+#else
+	return 0;
+#endif
+}
+
+EXPORT int awe_Stats_snapshot(StatsEntryC* entries, int maxEntries) {
+#ifdef AWE_ENABLE_STATS
+	EnterCriticalSection(&stats.lock);
+	int count = (int)stats.entries.size();
+	int i = 0;
+	for(std::map<StatsKey, StatsEntryC>::iterator it = stats.entries.begin(); it != stats.entries.end() && i < maxEntries; it++, i++)
+		entries[i] = it->second;
+	LeaveCriticalSection(&stats.lock);
+	return count;
+#else
+	return 0;
+#endif
+}
+
+EXPORT void awe_Stats_reset() {
+#ifdef AWE_ENABLE_STATS
+	EnterCriticalSection(&stats.lock);
+	stats.entries.clear();
+	LeaveCriticalSection(&stats.lock);
+#endif
+}
@@ -0,0 +1,747 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#define EXPORTS
+#include "awesomiumc.h"
+#include <gdiplus.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <list>
+
+/*-----------------------------------------------------------------------------
+  Thumbnail pipeline, loads jobs into a fixed set of WebViews from
+  awe_ThumbnailPipeline_update on the host thread and hands the captured
+  pixels to worker threads for scaling and encoding. Results are delivered
+  back on the host thread by the next update.
+-----------------------------------------------------------------------------*/
+// time given to the page to paint after onFinishLoading
+#define AWE_THUMBNAIL_SETTLE_MS 250
+#define AWE_THUMBNAIL_RESET_URL "about:blank"
+#define AWE_THUMBNAIL_JPEG_QUALITY 85
+
+struct ThumbnailJob {
+	int id;
+	std::string source;
+	bool isHTML;
+	int width;
+	int height;
+	int format;
+	int quality;
+	std::vector<unsigned char> pixels;
+	int sourceWidth;
+	int sourceHeight;
+	bool succeeded;
+	std::vector<unsigned char> encoded;
+};
+
+// a view whose job timed out loads about:blank and is only reused once that
+// has finished, so a late onFinishLoading of the abandoned page can't be
+// taken for the next job's. Events before about:blank begins loading belong
+// to the abandoned page.
+struct ThumbnailView {
+	WebViewC webView;
+	ThumbnailJob* job;
+	bool finishedLoading;
+	bool resetting;
+	bool resetStarted;
+	DWORD startTime;
+	DWORD finishTime;
+};
+
+struct ThumbnailPipeline {
+	WebCoreC webCore;
+	WebViewListenerC listener;
+	std::vector<ThumbnailView> views;
+	std::list<ThumbnailJob*> waiting;
+	int nextId;
+	int outstanding;
+	int timeoutMS;
+	int jpegQuality;
+	// 0 if GDI+ couldn't be started, JPEG jobs are refused then
+	ULONG_PTR gdiplusToken;
+	ThumbnailCallbackC callback;
+	void* userData;
+
+	// shared with the worker threads
+	CRITICAL_SECTION lock;
+	HANDLE jobsAvailable;
+	std::list<ThumbnailJob*> encodeQueue;
+	std::list<ThumbnailJob*> doneQueue;
+	std::vector<HANDLE> workers;
+	volatile LONG running;
+};
+
+// the listener has no user data, every view carries its ThumbnailView as the view's user data
+static void AWE_CALLBACK onThumbnailBeginLoading(WebViewC webView, const char* url, const wchar_t* frameName, int statusCode, const wchar_t* mimeType) {
+	ThumbnailView* view = static_cast<ThumbnailView*> (awe_WebView_getUserData(webView));
+	if(view && view->resetting && strcmp(url, AWE_THUMBNAIL_RESET_URL) == 0)
+		view->resetStarted = true;
+}
+
+static void AWE_CALLBACK onThumbnailFinishLoading(WebViewC webView) {
+	ThumbnailView* view = static_cast<ThumbnailView*> (awe_WebView_getUserData(webView));
+	if(!view)
+		return;
+	if(view->resetting) {
+		if(view->resetStarted)
+			view->resetting = false;
+		return;
+	}
+	if(!view->job)
+		return;
+	view->finishedLoading = true;
+	view->finishTime = GetTickCount();
+}
+
+/*-----------------------------------------------------------------------------
+  Encoding
+-----------------------------------------------------------------------------*/
+// box filter from BGRA to RGBA, every destination pixel averages the source pixels it covers
+static void scaleToRGBA(const ThumbnailJob* job, int width, int height, std::vector<unsigned char>& rgba) {
+	rgba.resize(width * height * 4);
+	const unsigned char* src = &job->pixels[0];
+	int srcRowSpan = job->sourceWidth * 4;
+	for(int y = 0; y < height; y++) {
+		int y0 = y * job->sourceHeight / height;
+		int y1 = (y + 1) * job->sourceHeight / height;
+		if(y1 <= y0)
+			y1 = y0 + 1;
+		for(int x = 0; x < width; x++) {
+			int x0 = x * job->sourceWidth / width;
+			int x1 = (x + 1) * job->sourceWidth / width;
+			if(x1 <= x0)
+				x1 = x0 + 1;
+			unsigned int sum[4] = { 0, 0, 0, 0 };
+			for(int sy = y0; sy < y1; sy++) {
+				const unsigned char* row = src + sy * srcRowSpan;
+				for(int sx = x0; sx < x1; sx++) {
+					sum[0] += row[sx * 4 + 2];
+					sum[1] += row[sx * 4 + 1];
+					sum[2] += row[sx * 4];
+					sum[3] += row[sx * 4 + 3];
+				}
+			}
+			unsigned int count = (y1 - y0) * (x1 - x0);
+			unsigned char* dst = &rgba[(y * width + x) * 4];
+			for(int c = 0; c < 4; c++)
+				dst[c] = (unsigned char)(sum[c] / count);
+		}
+	}
+}
+
+static void appendBigEndian(std::vector<unsigned char>& out, unsigned int value) {
+	out.push_back((unsigned char)(value >> 24));
+	out.push_back((unsigned char)(value >> 16));
+	out.push_back((unsigned char)(value >> 8));
+	out.push_back((unsigned char)value);
+}
+
+static void appendLittleEndian(std::vector<unsigned char>& out, unsigned int value, int bytes) {
+	for(int i = 0; i < bytes; i++)
+		out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+static unsigned int crcTable[256];
+static bool crcTableReady = false;
+
+// called from awe_ThumbnailPipeline_new before any worker thread starts
+static void initCRCTable() {
+	if(crcTableReady)
+		return;
+	for(unsigned int i = 0; i < 256; i++) {
+		unsigned int c = i;
+		for(int k = 0; k < 8; k++)
+			c = (c & 1)?0xEDB88320u ^ (c >> 1):c >> 1;
+		crcTable[i] = c;
+	}
+	crcTableReady = true;
+}
+
+static unsigned int crc32(const unsigned char* data, size_t length) {
+	unsigned int crc = 0xFFFFFFFFu;
+	for(size_t i = 0; i < length; i++)
+		crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFFu;
+}
+
+static void appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+	appendBigEndian(out, (unsigned int)data.size());
+	size_t start = out.size();
+	out.insert(out.end(), type, type + 4);
+	out.insert(out.end(), data.begin(), data.end());
+	appendBigEndian(out, crc32(&out[start], out.size() - start));
+}
+
+struct BitWriter {
+	std::vector<unsigned char>& out;
+	unsigned int bits;
+	int count;
+
+	BitWriter(std::vector<unsigned char>& out) : out(out), bits(0), count(0) {
+	}
+
+	// deflate packs bits starting at the least significant one
+	void put(unsigned int value, int length) {
+		bits |= value << count;
+		count += length;
+		while(count >= 8) {
+			out.push_back((unsigned char)bits);
+			bits >>= 8;
+			count -= 8;
+		}
+	}
+
+	// Huffman codes are stored starting at their most significant bit
+	void putCode(unsigned int code, int length) {
+		unsigned int reversed = 0;
+		for(int i = 0; i < length; i++)
+			reversed |= ((code >> i) & 1) << (length - 1 - i);
+		put(reversed, length);
+	}
+
+	void flush() {
+		if(count > 0)
+			out.push_back((unsigned char)bits);
+		bits = 0;
+		count = 0;
+	}
+};
+
+static const int lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const int distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// the fixed literal/length code of RFC 1951 3.2.6
+static void putLiteral(BitWriter& writer, int symbol) {
+	if(symbol < 144)
+		writer.putCode(0x30 + symbol, 8);
+	else if(symbol < 256)
+		writer.putCode(0x190 + symbol - 144, 9);
+	else if(symbol < 280)
+		writer.putCode(symbol - 256, 7);
+	else
+		writer.putCode(0xC0 + symbol - 280, 8);
+}
+
+static void putMatch(BitWriter& writer, int length, int distance) {
+	int i = 28;
+	while(lengthBase[i] > length)
+		i--;
+	putLiteral(writer, 257 + i);
+	writer.put(length - lengthBase[i], lengthExtra[i]);
+	int j = 29;
+	while(distanceBase[j] > distance)
+		j--;
+	writer.putCode(j, 5);
+	writer.put(distance - distanceBase[j], distanceExtra[j]);
+}
+
+#define AWE_DEFLATE_WINDOW 32768
+#define AWE_DEFLATE_HASH_BITS 15
+#define AWE_DEFLATE_MAX_CHAIN 32
+#define AWE_DEFLATE_MAX_MATCH 258
+
+// one block with the fixed Huffman codes, matches are found through hash
+// chains of 3 byte sequences. Rendered pages are mostly flat areas, which this
+// compresses well without the cost of building dynamic codes.
+static void deflate(const std::vector<unsigned char>& data, std::vector<unsigned char>& out) {
+	BitWriter writer(out);
+	writer.put(1, 1);
+	writer.put(1, 2);
+
+	std::vector<int> head(1 << AWE_DEFLATE_HASH_BITS, -1);
+	std::vector<int> previous(AWE_DEFLATE_WINDOW, -1);
+	int size = (int)data.size();
+	int i = 0;
+	while(i < size) {
+		int bestLength = 0;
+		int bestDistance = 0;
+		if(i + 3 <= size) {
+			unsigned int hash = ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & ((1 << AWE_DEFLATE_HASH_BITS) - 1);
+			int maxLength = size - i < AWE_DEFLATE_MAX_MATCH?size - i:AWE_DEFLATE_MAX_MATCH;
+			int candidate = head[hash];
+			for(int chain = 0; candidate >= 0 && i - candidate <= AWE_DEFLATE_WINDOW && chain < AWE_DEFLATE_MAX_CHAIN; chain++) {
+				if(data[candidate + bestLength] == data[i + bestLength]) {
+					int length = 0;
+					while(length < maxLength && data[candidate + length] == data[i + length])
+						length++;
+					if(length > bestLength) {
+						bestLength = length;
+						bestDistance = i - candidate;
+						if(length == maxLength)
+							break;
+					}
+				}
+				candidate = previous[candidate & (AWE_DEFLATE_WINDOW - 1)];
+			}
+		}
+
+		int advance = 1;
+		if(bestLength >= 3) {
+			putMatch(writer, bestLength, bestDistance);
+			advance = bestLength;
+		} else {
+			putLiteral(writer, data[i]);
+		}
+		for(int end = i + advance; i < end; i++) {
+			if(i + 3 > size)
+				continue;
+			unsigned int hash = ((data[i] << 10) ^ (data[i + 1] << 5) ^ data[i + 2]) & ((1 << AWE_DEFLATE_HASH_BITS) - 1);
+			previous[i & (AWE_DEFLATE_WINDOW - 1)] = head[hash];
+			head[hash] = i;
+		}
+	}
+	putLiteral(writer, 256);
+	writer.flush();
+}
+
+static unsigned char paeth(int a, int b, int c) {
+	int p = a + b - c;
+	int pa = abs(p - a);
+	int pb = abs(p - b);
+	int pc = abs(p - c);
+	if(pa <= pb && pa <= pc)
+		return (unsigned char)a;
+	return (unsigned char)(pb <= pc?b:c);
+}
+
+// picks the filter with the smallest sum of absolute differences for every row
+static void filterRows(const std::vector<unsigned char>& rgba, int width, int height, std::vector<unsigned char>& out) {
+	int rowSpan = width * 4;
+	std::vector<unsigned char> candidates[4];
+	for(int f = 0; f < 4; f++)
+		candidates[f].resize(rowSpan);
+	out.reserve((rowSpan + 1) * height);
+	for(int y = 0; y < height; y++) {
+		const unsigned char* row = &rgba[y * rowSpan];
+		const unsigned char* above = y > 0?row - rowSpan:0;
+		unsigned int bestSum = 0xFFFFFFFFu;
+		int best = 0;
+		for(int f = 0; f < 4; f++) {
+			unsigned int sum = 0;
+			for(int x = 0; x < rowSpan; x++) {
+				int left = x >= 4?row[x - 4]:0;
+				int up = above?above[x]:0;
+				int upLeft = above && x >= 4?above[x - 4]:0;
+				unsigned char value;
+				if(f == 0)
+					value = row[x];
+				else if(f == 1)
+					value = (unsigned char)(row[x] - left);
+				else if(f == 2)
+					value = (unsigned char)(row[x] - up);
+				else
+					value = (unsigned char)(row[x] - paeth(left, up, upLeft));
+				candidates[f][x] = value;
+				sum += value < 128?value:256 - value;
+			}
+			if(sum < bestSum) {
+				bestSum = sum;
+				best = f;
+			}
+		}
+		// PNG numbers Paeth 4, Average (3) isn't tried
+		out.push_back((unsigned char)(best == 3?4:best));
+		out.insert(out.end(), candidates[best].begin(), candidates[best].end());
+	}
+}
+
+static void encodePNG(const std::vector<unsigned char>& rgba, int width, int height, std::vector<unsigned char>& out) {
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	out.assign(signature, signature + 8);
+
+	std::vector<unsigned char> header;
+	appendBigEndian(header, width);
+	appendBigEndian(header, height);
+	header.push_back(8);
+	header.push_back(6);
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);
+	appendChunk(out, "IHDR", header);
+
+	std::vector<unsigned char> raw;
+	filterRows(rgba, width, height, raw);
+
+	std::vector<unsigned char> image;
+	image.push_back(0x78);
+	image.push_back(0x01);
+	deflate(raw, image);
+	unsigned int a = 1, b = 0;
+	for(size_t i = 0; i < raw.size(); i++) {
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	appendBigEndian(image, (b << 16) | a);
+	appendChunk(out, "IDAT", image);
+	appendChunk(out, "IEND", std::vector<unsigned char>());
+}
+
+// 24 bit bottom up rows padded to 4 bytes
+static void encodeBMP(const std::vector<unsigned char>& rgba, int width, int height, std::vector<unsigned char>& out) {
+	int rowSpan = (width * 3 + 3) & ~3;
+	unsigned int imageSize = rowSpan * height;
+	out.clear();
+	out.reserve(54 + imageSize);
+	out.push_back('B');
+	out.push_back('M');
+	appendLittleEndian(out, 54 + imageSize, 4);
+	appendLittleEndian(out, 0, 4);
+	appendLittleEndian(out, 54, 4);
+	appendLittleEndian(out, 40, 4);
+	appendLittleEndian(out, width, 4);
+	appendLittleEndian(out, height, 4);
+	appendLittleEndian(out, 1, 2);
+	appendLittleEndian(out, 24, 2);
+	appendLittleEndian(out, 0, 4);
+	appendLittleEndian(out, imageSize, 4);
+	appendLittleEndian(out, 2835, 4);
+	appendLittleEndian(out, 2835, 4);
+	appendLittleEndian(out, 0, 4);
+	appendLittleEndian(out, 0, 4);
+	for(int y = height - 1; y >= 0; y--) {
+		const unsigned char* row = &rgba[y * width * 4];
+		for(int x = 0; x < width; x++) {
+			out.push_back(row[x * 4 + 2]);
+			out.push_back(row[x * 4 + 1]);
+			out.push_back(row[x * 4]);
+		}
+		for(int i = width * 3; i < rowSpan; i++)
+			out.push_back(0);
+	}
+}
+
+static CLSID jpegEncoder;
+static bool jpegEncoderFound = false;
+
+// called from awe_ThumbnailPipeline_new once GDI+ is running, before any worker thread starts
+static void findJPEGEncoder() {
+	if(jpegEncoderFound)
+		return;
+	UINT count = 0;
+	UINT size = 0;
+	if(Gdiplus::GetImageEncodersSize(&count, &size) != Gdiplus::Ok || size == 0)
+		return;
+	std::vector<unsigned char> buffer(size);
+	Gdiplus::ImageCodecInfo* encoders = reinterpret_cast<Gdiplus::ImageCodecInfo*> (&buffer[0]);
+	if(Gdiplus::GetImageEncoders(count, size, encoders) != Gdiplus::Ok)
+		return;
+	for(UINT i = 0; i < count; i++) {
+		if(wcscmp(encoders[i].MimeType, L"image/jpeg") == 0) {
+			jpegEncoder = encoders[i].Clsid;
+			jpegEncoderFound = true;
+			return;
+		}
+	}
+}
+
+// GDI+ writes into a memory stream, its bitmaps take BGRA in memory order
+static bool encodeJPEG(const std::vector<unsigned char>& rgba, int width, int height, int quality, std::vector<unsigned char>& out) {
+	std::vector<unsigned char> bgra(rgba.size());
+	for(size_t i = 0; i < rgba.size(); i += 4) {
+		bgra[i] = rgba[i + 2];
+		bgra[i + 1] = rgba[i + 1];
+		bgra[i + 2] = rgba[i];
+		bgra[i + 3] = 255;
+	}
+	IStream* stream = 0;
+	if(CreateStreamOnHGlobal(0, TRUE, &stream) != S_OK)
+		return false;
+
+	bool succeeded = false;
+	{
+		Gdiplus::Bitmap bitmap(width, height, width * 4, PixelFormat32bppRGB, &bgra[0]);
+		ULONG value = quality;
+		Gdiplus::EncoderParameters parameters;
+		parameters.Count = 1;
+		parameters.Parameter[0].Guid = Gdiplus::EncoderQuality;
+		parameters.Parameter[0].Type = Gdiplus::EncoderParameterValueTypeLong;
+		parameters.Parameter[0].NumberOfValues = 1;
+		parameters.Parameter[0].Value = &value;
+		HGLOBAL memory = 0;
+		STATSTG stat;
+		if(bitmap.Save(stream, &jpegEncoder, &parameters) == Gdiplus::Ok
+			&& GetHGlobalFromStream(stream, &memory) == S_OK
+			&& stream->Stat(&stat, STATFLAG_NONAME) == S_OK) {
+			const unsigned char* data = static_cast<const unsigned char*> (GlobalLock(memory));
+			if(data) {
+				out.assign(data, data + (size_t)stat.cbSize.QuadPart);
+				GlobalUnlock(memory);
+				succeeded = true;
+			}
+		}
+	}
+	stream->Release();
+	return succeeded;
+}
+
+static void encodeThumbnail(ThumbnailJob* job) {
+	int width = job->width;
+	int height = job->height;
+	// a missing dimension keeps the aspect ratio of the captured page, addJob refuses jobs without any
+	if(width <= 0) {
+		width = job->sourceWidth * height / job->sourceHeight;
+	} else if(height <= 0) {
+		height = job->sourceHeight * width / job->sourceWidth;
+	}
+	if(width < 1)
+		width = 1;
+	if(height < 1)
+		height = 1;
+
+	std::vector<unsigned char> rgba;
+	scaleToRGBA(job, width, height, rgba);
+	if(job->format == AWE_THUMBNAIL_JPEG)
+		job->succeeded = encodeJPEG(rgba, width, height, job->quality, job->encoded);
+	else if(job->format == AWE_THUMBNAIL_BMP) {
+		encodeBMP(rgba, width, height, job->encoded);
+		job->succeeded = true;
+	} else {
+		encodePNG(rgba, width, height, job->encoded);
+		job->succeeded = true;
+	}
+	std::vector<unsigned char>().swap(job->pixels);
+}
+
+static DWORD WINAPI thumbnailWorkerMain(LPVOID param) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*>(param);
+	while(true) {
+		WaitForSingleObject(pipeline->jobsAvailable, INFINITE);
+		if(!pipeline->running)
+			break;
+		EnterCriticalSection(&pipeline->lock);
+		ThumbnailJob* job = pipeline->encodeQueue.front();
+		pipeline->encodeQueue.pop_front();
+		LeaveCriticalSection(&pipeline->lock);
+
+		encodeThumbnail(job);
+
+		EnterCriticalSection(&pipeline->lock);
+		pipeline->doneQueue.push_back(job);
+		LeaveCriticalSection(&pipeline->lock);
+	}
+	return 0;
+}
+
+/*-----------------------------------------------------------------------------
+  Host side
+-----------------------------------------------------------------------------*/
+static void finishJob(ThumbnailPipeline* pipeline, ThumbnailJob* job) {
+	EnterCriticalSection(&pipeline->lock);
+	pipeline->doneQueue.push_back(job);
+	LeaveCriticalSection(&pipeline->lock);
+}
+
+static void startJob(ThumbnailPipeline* pipeline, ThumbnailView& view) {
+	ThumbnailJob* job = pipeline->waiting.front();
+	pipeline->waiting.pop_front();
+	view.job = job;
+	view.finishedLoading = false;
+	view.startTime = GetTickCount();
+	if(job->isHTML)
+		awe_WebView_loadHTML(view.webView, job->source.c_str(), L"");
+	else
+		awe_WebView_loadURL(view.webView, job->source.c_str(), L"", "", "");
+}
+
+static void captureJob(ThumbnailPipeline* pipeline, ThumbnailView& view) {
+	ThumbnailJob* job = view.job;
+	view.job = 0;
+	RenderBufferC renderBuffer = awe_WebView_render(view.webView);
+	if(!renderBuffer) {
+		finishJob(pipeline, job);
+		return;
+	}
+	job->sourceWidth = awe_RenderBuffer_width(renderBuffer);
+	job->sourceHeight = awe_RenderBuffer_height(renderBuffer);
+	job->pixels.resize(job->sourceWidth * job->sourceHeight * 4);
+	awe_RenderBuffer_copyTo(renderBuffer, &job->pixels[0], job->sourceWidth * 4, 4, 0);
+
+	if(pipeline->workers.empty()) {
+		encodeThumbnail(job);
+		finishJob(pipeline, job);
+		return;
+	}
+	EnterCriticalSection(&pipeline->lock);
+	pipeline->encodeQueue.push_back(job);
+	LeaveCriticalSection(&pipeline->lock);
+	ReleaseSemaphore(pipeline->jobsAvailable, 1, 0);
+}
+
+// returns 0 for jobs that could never succeed
+static int addJob(ThumbnailPipeline* pipeline, const char* source, bool isHTML, int width, int height, int format) {
+	if(width <= 0 && height <= 0)
+		return 0;
+	if(format != AWE_THUMBNAIL_PNG && format != AWE_THUMBNAIL_BMP && format != AWE_THUMBNAIL_JPEG)
+		return 0;
+	if(format == AWE_THUMBNAIL_JPEG && !(pipeline->gdiplusToken && jpegEncoderFound))
+		return 0;
+	ThumbnailJob* job = new ThumbnailJob();
+	job->id = pipeline->nextId++;
+	job->source = source;
+	job->isHTML = isHTML;
+	job->width = width;
+	job->height = height;
+	job->format = format;
+	job->quality = pipeline->jpegQuality;
+	job->sourceWidth = 0;
+	job->sourceHeight = 0;
+	job->succeeded = false;
+	pipeline->waiting.push_back(job);
+	pipeline->outstanding++;
+	return job->id;
+}
+
+EXPORT ThumbnailPipelineC awe_ThumbnailPipeline_new(WebCoreC webCore, int viewWidth, int viewHeight, int concurrentViews, int workerThreads) {
+	initCRCTable();
+	ThumbnailPipeline* pipeline = new ThumbnailPipeline();
+	pipeline->webCore = webCore;
+	pipeline->nextId = 1;
+	pipeline->outstanding = 0;
+	pipeline->timeoutMS = 30000;
+	pipeline->jpegQuality = AWE_THUMBNAIL_JPEG_QUALITY;
+	pipeline->callback = 0;
+	pipeline->userData = 0;
+	memset(&pipeline->listener, 0, sizeof(WebViewListenerC));
+	pipeline->listener.onBeginLoading = onThumbnailBeginLoading;
+	pipeline->listener.onFinishLoading = onThumbnailFinishLoading;
+
+	Gdiplus::GdiplusStartupInput startupInput;
+	pipeline->gdiplusToken = 0;
+	if(Gdiplus::GdiplusStartup(&pipeline->gdiplusToken, &startupInput, 0) == Gdiplus::Ok)
+		findJPEGEncoder();
+	else
+		pipeline->gdiplusToken = 0;
+
+	// the views vector is never resized, the views' user data points into it
+	pipeline->views.resize(concurrentViews > 0?concurrentViews:1);
+	for(size_t i = 0; i < pipeline->views.size(); i++) {
+		ThumbnailView& view = pipeline->views[i];
+		view.webView = awe_WebCore_createWebView(webCore, viewWidth, viewHeight);
+		view.job = 0;
+		view.finishedLoading = false;
+		view.resetting = false;
+		view.resetStarted = false;
+		view.startTime = 0;
+		view.finishTime = 0;
+		awe_WebView_setUserData(view.webView, &view);
+		awe_WebView_setListener(view.webView, &pipeline->listener);
+	}
+
+	InitializeCriticalSection(&pipeline->lock);
+	pipeline->jobsAvailable = CreateSemaphore(0, 0, 0x7FFFFFFF, 0);
+	pipeline->running = 1;
+	for(int i = 0; i < workerThreads; i++) {
+		HANDLE worker = CreateThread(0, 0, thumbnailWorkerMain, pipeline, 0, 0);
+		if(worker)
+			pipeline->workers.push_back(worker);
+	}
+	return pipeline;
+}
+
+EXPORT void awe_ThumbnailPipeline_delete(ThumbnailPipelineC thumbnailPipeline) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*> (thumbnailPipeline);
+	InterlockedExchange(&pipeline->running, 0);
+	ReleaseSemaphore(pipeline->jobsAvailable, (LONG)pipeline->workers.size(), 0);
+	for(size_t i = 0; i < pipeline->workers.size(); i++) {
+		WaitForSingleObject(pipeline->workers[i], INFINITE);
+		CloseHandle(pipeline->workers[i]);
+	}
+	CloseHandle(pipeline->jobsAvailable);
+	DeleteCriticalSection(&pipeline->lock);
+
+	for(size_t i = 0; i < pipeline->views.size(); i++) {
+		awe_WebView_destroy(pipeline->views[i].webView);
+		delete pipeline->views[i].job;
+	}
+	for(std::list<ThumbnailJob*>::iterator it = pipeline->waiting.begin(); it != pipeline->waiting.end(); it++)
+		delete *it;
+	for(std::list<ThumbnailJob*>::iterator it = pipeline->encodeQueue.begin(); it != pipeline->encodeQueue.end(); it++)
+		delete *it;
+	for(std::list<ThumbnailJob*>::iterator it = pipeline->doneQueue.begin(); it != pipeline->doneQueue.end(); it++)
+		delete *it;
+	if(pipeline->gdiplusToken)
+		Gdiplus::GdiplusShutdown(pipeline->gdiplusToken);
+	delete pipeline;
+}
+
+EXPORT void awe_ThumbnailPipeline_setCallback(ThumbnailPipelineC thumbnailPipeline, ThumbnailCallbackC callback, void* userData) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*> (thumbnailPipeline);
+	pipeline->callback = callback;
+	pipeline->userData = userData;
+}
+
+EXPORT void awe_ThumbnailPipeline_setTimeout(ThumbnailPipelineC thumbnailPipeline, int timeoutMS) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*> (thumbnailPipeline);
+	pipeline->timeoutMS = timeoutMS;
+}
+
+EXPORT void awe_ThumbnailPipeline_setJPEGQuality(ThumbnailPipelineC thumbnailPipeline, int quality) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*> (thumbnailPipeline);
+	pipeline->jpegQuality = quality < 0?0:(quality > 100?100:quality);
+}
+
+EXPORT int awe_ThumbnailPipeline_addURL(ThumbnailPipelineC thumbnailPipeline, const char* url, int width, int height, int format) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*> (thumbnailPipeline);
+	return addJob(pipeline, url, false, width, height, format);
+}
+
+EXPORT int awe_ThumbnailPipeline_addHTML(ThumbnailPipelineC thumbnailPipeline, const char* html, int width, int height, int format) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*> (thumbnailPipeline);
+	return addJob(pipeline, html, true, width, height, format);
+}
+
+EXPORT int awe_ThumbnailPipeline_update(ThumbnailPipelineC thumbnailPipeline) {
+	ThumbnailPipeline* pipeline = static_cast<ThumbnailPipeline*> (thumbnailPipeline);
+	DWORD now = GetTickCount();
+	for(size_t i = 0; i < pipeline->views.size(); i++) {
+		ThumbnailView& view = pipeline->views[i];
+		if(view.job && view.finishedLoading && now - view.finishTime >= AWE_THUMBNAIL_SETTLE_MS) {
+			captureJob(pipeline, view);
+		} else if(view.job && pipeline->timeoutMS > 0 && now - view.startTime >= (DWORD)pipeline->timeoutMS) {
+			awe_WebView_stop(view.webView);
+			finishJob(pipeline, view.job);
+			view.job = 0;
+			view.resetting = true;
+			view.resetStarted = false;
+			view.startTime = now;
+			awe_WebView_loadURL(view.webView, AWE_THUMBNAIL_RESET_URL, L"", "", "");
+		} else if(view.resetting && pipeline->timeoutMS > 0 && now - view.startTime >= (DWORD)pipeline->timeoutMS) {
+			// about:blank never finished either, give up on a clean handover
+			view.resetting = false;
+		}
+		if(!view.job && !view.resetting && !pipeline->waiting.empty())
+			startJob(pipeline, view);
+	}
+
+	std::list<ThumbnailJob*> done;
+	EnterCriticalSection(&pipeline->lock);
+	done.swap(pipeline->doneQueue);
+	LeaveCriticalSection(&pipeline->lock);
+	for(std::list<ThumbnailJob*>::iterator it = done.begin(); it != done.end(); it++) {
+		ThumbnailJob* job = *it;
+		if(pipeline->callback)
+			pipeline->callback(job->id, job->isHTML?0:job->source.c_str(), job->succeeded?-1:0,
+				job->encoded.empty()?0:&job->encoded[0], (int)job->encoded.size(), pipeline->userData);
+		delete job;
+		pipeline->outstanding--;
+	}
+	return pipeline->outstanding;
+}
@@ -0,0 +1,58 @@
+/**
+	This file is part of Awesomiumc.
+    Copyright (C) 2010  Mario Zechner
+
+    Awesomiumc is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Awesomiumc is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+**/
+#include "internal.h"
+
+// appends UTF-16 units as UTF-8, unpaired surrogates become U+FFFD
+void encodeUTF8(std::vector<char>& out, const wchar_t* str, size_t length) {
+	for(size_t i = 0; i < length; i++) {
+		unsigned int c = (unsigned short)str[i];
+		if(c >= 0xD800 && c <= 0xDBFF && i + 1 < length && (unsigned short)str[i + 1] >= 0xDC00 && (unsigned short)str[i + 1] <= 0xDFFF) {
+			c = 0x10000 + ((c - 0xD800) << 10) + ((unsigned short)str[++i] - 0xDC00);
+		} else if(c >= 0xD800 && c <= 0xDFFF) {
+			c = 0xFFFD;
+		}
+		if(c < 0x80) {
+			out.push_back((char)c);
+		} else if(c < 0x800) {
+			out.push_back((char)(0xC0 | (c >> 6)));
+			out.push_back((char)(0x80 | (c & 0x3F)));
+		} else if(c < 0x10000) {
+			out.push_back((char)(0xE0 | (c >> 12)));
+			out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+			out.push_back((char)(0x80 | (c & 0x3F)));
+		} else {
+			out.push_back((char)(0xF0 | (c >> 18)));
+			out.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+			out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+			out.push_back((char)(0x80 | (c & 0x3F)));
+		}
+	}
+}
+
+// length of the chunk starting at offset, chunks never split a surrogate pair
+// so every UTF-8 chunk holds whole code points. chunkSize must be at least 2.
+size_t getChunkLength(const std::wstring& contents, size_t offset, size_t chunkSize) {
+	size_t length = contents.size() - offset;
+	if(length > chunkSize) {
+		length = chunkSize;
+		wchar_t last = contents[offset + length - 1];
+		if(last >= 0xD800 && last <= 0xDBFF)
+			length--;
+	}
+	return length;
+}
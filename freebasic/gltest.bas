@@ -15,6 +15,8 @@ Using fb '' constants and structures are stored in the FB namespace in lang fb
 dim shared webCore as any ptr
 dim shared webView as any ptr
 dim shared texture as GLuint
+dim shared textureWidth as integer
+dim shared textureHeight as integer
 dim shared callbacks as WebViewListenerC
 
 ''
@@ -162,31 +164,35 @@ end sub
 
 ''
 '' updates the texture based on the latest content
-'' of the WebView
+'' of the WebView. the first upload allocates the
+'' texture storage, after that only the dirty region
+'' is uploaded via glTexSubImage2D
 ''
 sub updateTexture()
 	dim renderBuffer as any ptr
+	dim dirty as RectC
 	dim pixels as ubyte ptr
 	dim w as integer
 	dim h as integer
 	dim r as integer
 	
-	renderBuffer = awe_WebView_render(webView)		
+	renderBuffer = awe_WebView_renderDirtyRegion(webView, @dirty, @pixels, @r)
 	
 	if(renderBuffer <> 0) then
-		pixels = awe_RenderBuffer_buffer(renderBuffer)
 		w = awe_RenderBuffer_width(renderBuffer)
 		h = awe_RenderBuffer_height(renderBuffer)
-		r = awe_RenderBuffer_rowSpan(renderBuffer)
 	
-		if(r <> w * 4) then
-			info "rowspan != width * 4"
-			return
-		end if
-		
-		info "updating texture"
 		glBindTexture(GL_TEXTURE_2D, texture)
-		glTexImage2D(GL_TEXTURE_2D, 0, 4, w, h, 0, GL_BGRA, GL_UNSIGNED_BYTE, pixels)
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, r \ 4)
+		if(w <> textureWidth or h <> textureHeight) then
+			info "allocating texture"
+			glTexImage2D(GL_TEXTURE_2D, 0, 4, w, h, 0, GL_BGRA, GL_UNSIGNED_BYTE, awe_RenderBuffer_buffer(renderBuffer))
+			textureWidth = w
+			textureHeight = h
+		elseif(pixels <> 0) then
+			glTexSubImage2D(GL_TEXTURE_2D, 0, dirty.x, dirty.y, dirty.width, dirty.height, GL_BGRA, GL_UNSIGNED_BYTE, pixels)
+		end if
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0)
 		glBindTexture(GL_TEXTURE_2D, 0)
 	end if
 end sub